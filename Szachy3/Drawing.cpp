@@ -1,6 +1,7 @@
 
 #include "Drawing.h"
 #include "board.h"
+#include "trace.h"
 #include <algorithm>
 #include <vector>
 #include <cmath>
@@ -44,8 +45,6 @@ namespace {
 	
 	// indexing goes from A1 to H1 are 0-7, A2 to H2 are 8-15, etc.
 
-	vector<pair<int, char>> positionToPieceMap;
-
 
 	
 }
@@ -77,8 +76,8 @@ void DrawingChessboardInterface::unsetPickedFigure() {
 	isPicked = FALSE;
 }
 
-void DrawingChessboardInterface::setPositionToPieceMap(const vector<pair<int, char>>& map) {
-	positionToPieceMap = map;
+void DrawingChessboardInterface::setPosition(const BoardSnapshot& snapshot) {
+	position = snapshot;
 }
 
 void DrawingChessboardInterface::changeTurn() {
@@ -134,6 +133,13 @@ void DrawingChessboardInterface::calculateChessboardRects(RECT client_rect) {
 		}
 		
 	}
+	if (d2d_render_target) {
+		d2d_render_target->Resize(SizeU(wnd_width, wnd_height));
+	}
+	if (atlas && d2d_render_target && atlas->nearestLevel(static_cast<int>(tile_width)) != atlasLevel) {
+		load_bitmaps_from_atlas();
+	}
+	fullRedraw = TRUE;
 }
 
 
@@ -270,7 +276,70 @@ HRESULT LoadBitmapFromFile(
 	return hr;
 }
 
+HRESULT DrawingChessboardInterface::load_bitmaps_from_atlas() {
+	TRACE_SCOPE("DrawingChessboardInterface::load_bitmaps_from_atlas");
+	if (!atlas) {
+		try {
+			atlas = std::make_unique<SpriteAtlas>(atlas_file_name);
+		}
+		catch (const std::exception&) {
+			return E_FAIL; // no usable atlas, the caller decodes the image files
+		}
+	}
+	size_t level = atlas->nearestLevel(static_cast<int>(tile_width));
+	auto create_bitmap = [&](LPCWSTR file_name, ID2D1Bitmap** bitmap) -> HRESULT {
+		// sprites are named by the file name without its extension
+		std::string path;
+		for (const WCHAR* c = file_name; *c != L'\0'; ++c) {
+			path.push_back(static_cast<char>(*c));
+		}
+		int index = atlas->find(path.substr(0, path.find('.')));
+		if (index < 0) {
+			return E_FAIL;
+		}
+		// an image edited since the atlas was packed; without the file the atlas is all there is
+		uint64_t hash = hashSpriteSource(path);
+		if (hash != 0 && hash != atlas->sourceHash(static_cast<size_t>(index))) {
+			return E_FAIL;
+		}
+		SpriteAtlas::Sprite sprite = atlas->sprite(level, index);
+		return d2d_render_target->CreateBitmap(
+			SizeU(sprite.size, sprite.size),
+			sprite.pixels,
+			static_cast<UINT32>(sprite.stride),
+			D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)),
+			bitmap);
+	};
+
+	ID2D1Bitmap* pieces[12]{};
+	ID2D1Bitmap* tiles[3]{};
+	HRESULT result = S_OK;
+	for (UINT i = 0; i < 12 && SUCCEEDED(result); ++i) {
+		result = create_bitmap(pieces_file_names[i], &pieces[i]);
+	}
+	for (UINT i = 0; i < 3 && SUCCEEDED(result); ++i) {
+		result = create_bitmap(tiles_file_names[i], &tiles[i]);
+	}
+	for (UINT i = 0; i < 12; ++i) {
+		SafeRelease(SUCCEEDED(result) ? &PieceBitmaps[i] : &pieces[i]);
+	}
+	for (UINT i = 0; i < 3; ++i) {
+		SafeRelease(SUCCEEDED(result) ? &TileBitmaps[i] : &tiles[i]);
+	}
+	if (FAILED(result)) {
+		atlas.reset(); // stale atlas, missing or out of date sprites
+		return result;
+	}
+	std::copy(std::begin(pieces), std::end(pieces), PieceBitmaps);
+	std::copy(std::begin(tiles), std::end(tiles), TileBitmaps);
+	atlasLevel = level;
+	return S_OK;
+}
+
 HRESULT DrawingChessboardInterface::load_pieces_and_tiles_bitmaps() {
+	if (SUCCEEDED(load_bitmaps_from_atlas())) {
+		return S_OK;
+	}
 	 // Ensure `hr` is declared properly
 	for (UINT i = 0; i < 12; ++i) {
 		hr = LoadBitmapFromFile(d2d_render_target, wic_factory, pieces_file_names[i], 100, 100, &PieceBitmaps[i]);
@@ -316,7 +385,8 @@ HRESULT DrawingChessboardInterface::initialize() {
 				static_cast<UINT32>(rc.left),
 				static_cast<UINT32>(rc.bottom) -
 				static_cast<UINT32>(rc.top)
-			)),
+			),
+			D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS), // frames only redraw what changed
 		&d2d_render_target);
 	if (FAILED(hr)) {
 		MessageBox(hwnd, L"Failed to create render target", L"Error", MB_OK);
@@ -331,6 +401,49 @@ HRESULT DrawingChessboardInterface::initialize() {
 		MessageBox(hwnd, L"Failed to create write factory", L"Error", MB_OK);
 		return 1;
 	}
+
+	// device independent, so they live as long as the window
+	hr = write_factory->CreateTextFormat(
+		L"Verdana",
+		nullptr,
+		DWRITE_FONT_WEIGHT_NORMAL,
+		DWRITE_FONT_STYLE_NORMAL,
+		DWRITE_FONT_STRETCH_NORMAL,
+		80.0f,
+		L"en-us",
+		&text_format
+	);
+	if (SUCCEEDED(hr)) {
+		hr = write_factory->CreateTextFormat(
+			L"Impact",
+			nullptr,
+			DWRITE_FONT_WEIGHT_NORMAL,
+			DWRITE_FONT_STYLE_NORMAL,
+			DWRITE_FONT_STRETCH_NORMAL,
+			30.0f,
+			L"en-us",
+			&text_format2);
+	}
+	if (FAILED(hr)) {
+		MessageBox(hwnd, L"Failed to create text format", L"Error", MB_OK);
+		return 1;
+	}
+	hr = d2d_factory->CreateStrokeStyle(
+		StrokeStyleProperties(
+			D2D1_CAP_STYLE_ROUND,
+			D2D1_CAP_STYLE_ROUND,
+			D2D1_CAP_STYLE_ROUND,
+			D2D1_LINE_JOIN_MITER,
+			10.0f,
+			D2D1_DASH_STYLE_SOLID,
+			0.0f),
+		nullptr,
+		0,
+		&brush_style);
+	if (FAILED(hr)) {
+		MessageBox(hwnd, L"Failed to create brush style", L"Error", MB_OK);
+		return 1;
+	}
 	
 	hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
 	if (FAILED(hr)) {
@@ -349,16 +462,16 @@ HRESULT DrawingChessboardInterface::initialize() {
 		return 1;
 	}
 
-	hr = load_pieces_and_tiles_bitmaps();
+	calculateChessboardRects(rc); // the atlas level is chosen by the tile size
 
-	calculateChessboardRects(rc);
+	hr = load_pieces_and_tiles_bitmaps();
 
 	return S_OK;
 
 }
 
 
-HRESULT DrawingChessboardInterface::createRenderResources(HWND hwnd, ID2D1Factory7* d2d_factory, ID2D1HwndRenderTarget* d2d_render_target) {
+HRESULT DrawingChessboardInterface::createRenderResources() {
 	hr = S_OK;
 	if (d2d_render_target == nullptr) {
 		RECT rc;
@@ -375,149 +488,133 @@ HRESULT DrawingChessboardInterface::createRenderResources(HWND hwnd, ID2D1Factor
 					static_cast<UINT32>(rc.left),
 					static_cast<UINT32>(rc.bottom) -
 					static_cast<UINT32>(rc.top)
-				)),
+				),
+				D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS),
 			&d2d_render_target);
 		if (FAILED(hr)) {
 			MessageBox(hwnd, L"Failed to create render target", L"Error", MB_OK);
+			return hr;
 		}
 		calculateChessboardRects(rc);
+		// bitmaps belong to the old render target
+		for (UINT i = 0; i < 12; ++i) {
+			SafeRelease(&PieceBitmaps[i]);
+		}
+		for (UINT i = 0; i < 3; ++i) {
+			SafeRelease(&TileBitmaps[i]);
+		}
+		atlasLevel = SIZE_MAX;
+		hr = load_pieces_and_tiles_bitmaps();
+		if (FAILED(hr)) {
+			return hr;
+		}
+	}
+	if (brush == nullptr) {
+		hr = d2d_render_target->CreateSolidColorBrush(black_color, &brush);
+		if (FAILED(hr)) {
+			MessageBox(hwnd, L"Failed to create brush", L"Error", MB_OK);
+		}
 	}
-	
 	return hr;
 }
 
+BoardSceneState DrawingChessboardInterface::sceneState() const {
+	BoardSceneState state;
+	state.position = position;
+	for (size_t i = 0; i < chessboard.size() && i < state.squares.size(); ++i) {
+		state.squares[i] = { chessboard[i].left, chessboard[i].top, chessboard[i].right, chessboard[i].bottom };
+	}
+	state.picked = isPicked ? pickedFigure : -1;
+	state.mouseX = mouse_x;
+	state.mouseY = mouse_y;
+	state.pulsing = pulsing ? pulsing_index : -1;
+	state.pulse = pulse_value;
+	state.message = currentMessage;
+	return state;
+}
 
-HRESULT DrawingChessboardInterface::drawChessboard() {
-
-	hr = createRenderResources(hwnd, d2d_factory, d2d_render_target);
-	if (FAILED(hr)) {
-		MessageBox(hwnd, L"Failed to get client rect", L"Error", MB_OK);
-		return hr;
+void DrawingChessboardInterface::drawCommand(const SceneCommand& command) {
+	D2D1_RECT_F target = RectF(command.target.left, command.target.top, command.target.right, command.target.bottom);
+	if (command.type == SceneCommandType::TEXT) {
+		// clipped, so the text never leaves the bounds the scene diff assumes
+		d2d_render_target->DrawText(
+			command.text.data(), static_cast<UINT32>(command.text.size()),
+			command.font == SceneFont::MESSAGE ? text_format : text_format2,
+			target,
+			brush,
+			D2D1_DRAW_TEXT_OPTIONS_CLIP
+		);
+		return;
 	}
-	hr = d2d_render_target->CreateSolidColorBrush(black_color, &brush);
-	if (FAILED(hr)) {
-		MessageBox(hwnd, L"Failed to create brush", L"Error", MB_OK);
-		SafeRelease(&brush);
-		return hr;
+	ID2D1Bitmap* bitmap = command.bitmap >= scene_tile_bitmaps
+		? TileBitmaps[command.bitmap - scene_tile_bitmaps]
+		: PieceBitmaps[command.bitmap - scene_piece_bitmaps];
+	if (bitmap == nullptr) {
+		return;
 	}
-	hr = d2d_factory->CreateStrokeStyle(
-		StrokeStyleProperties(
-			D2D1_CAP_STYLE_ROUND,
-			D2D1_CAP_STYLE_ROUND,
-			D2D1_CAP_STYLE_ROUND,
-			D2D1_LINE_JOIN_MITER,
-			10.0f,
-			D2D1_DASH_STYLE_SOLID,
-			0.0f),
-		nullptr,
-		0,
-		&brush_style);
-	if (FAILED(hr)) {
-		MessageBox(hwnd, L"Failed to create brush style", L"Error", MB_OK);
-		SafeRelease(&brush);
-		SafeRelease(&brush_style);
-		return hr;
+	bool scaled = command.scaleX != 1.0f || command.scaleY != 1.0f;
+	if (scaled) {
+		d2d_render_target->SetTransform(D2D1::Matrix3x2F::Scale(command.scaleX, command.scaleY,
+			Point2F((target.left + target.right) / 2.0f, (target.top + target.bottom) / 2.0f)));
 	}
-	
-	hr = write_factory->CreateTextFormat(
-		L"Verdana",
-		nullptr,
-		DWRITE_FONT_WEIGHT_NORMAL,
-		DWRITE_FONT_STYLE_NORMAL,
-		DWRITE_FONT_STRETCH_NORMAL,
-		80.0f,
-		L"en-us",
-		&text_format
-	);
+	d2d_render_target->DrawBitmap(bitmap, target);
+	if (scaled) {
+		d2d_render_target->SetTransform(D2D1::Matrix3x2F::Identity());
+	}
+}
 
-	hr = write_factory->CreateTextFormat(
-		L"Impact",
-		nullptr,
-		DWRITE_FONT_WEIGHT_NORMAL,
-		DWRITE_FONT_STYLE_NORMAL,
-		DWRITE_FONT_STRETCH_NORMAL,
-		30.0f,
-		L"en-us",
-		&text_format2);
+HRESULT DrawingChessboardInterface::drawChessboard() {
+	TRACE_SCOPE("DrawingChessboardInterface::drawChessboard");
 
+	hr = createRenderResources();
 	if (FAILED(hr)) {
-		MessageBox(hwnd, L"Failed to create text format", L"Error", MB_OK);
-		SafeRelease(&brush);
-		SafeRelease(&brush_style);
 		return hr;
 	}
 
-
-	d2d_render_target->BeginDraw();
-
-	d2d_render_target->Clear(D2D1::ColorF(D2D1::ColorF::LightCyan));
-	
-	for (int i{ 0 }; i < 8; ++i) {
-		for (int j{ 0 }; j < 8; ++j) {
-			d2d_render_target->DrawBitmap(TileBitmaps[(i + j) % 2], chessboard[i * 8 + j]);
-		}
-	}
-	for (int i{ 0 }; i < 8; ++i) {
-		d2d_render_target->DrawText(
-			numbers[i], wcslen(numbers[i]),
-			text_format2,
-			D2D1::RectF(chessboard[i * 8].left - tile_height / 2.5f, chessboard[i * 8].top + tile_height / 3, chessboard[i * 8].left, chessboard[i * 8].bottom),
-			brush
-		);
-	}
-
-	// write letters
-	for (int i{ 0 }; i < 8; ++i) {
-		d2d_render_target->DrawText(
-			letters[i], wcslen(letters[i]),
-			text_format2,
-			D2D1::RectF(chessboard[i].left + tile_height / 2.50f, chessboard[i].bottom , chessboard[i].right, chessboard[i].bottom + tile_height ),
-			brush
-		);
+	// redraw only the parts of the window where this frame differs from the last one
+	scene.build(sceneState());
+	D2D1_SIZE_F size = d2d_render_target->GetSize();
+	SceneRect viewport{ 0.0f, 0.0f, size.width, size.height };
+	vector<SceneRect> dirty = fullRedraw ? vector<SceneRect>{ viewport } : diffScenes(lastScene, scene, viewport);
+	if (dirty.empty()) {
+		return S_OK;
 	}
 
-	
-	char picked_symbol;
-	for (auto& [index, symbol] : positionToPieceMap) {
-		if (index != pickedFigure) {
-			if (pulsing && index == pulsing_index) {
-				d2d_render_target->SetTransform(D2D1::Matrix3x2F::Scale(1.0f + 0.5f * sin(pulse_value), 0.5f * 1.0f + sin(pulse_value), Point2F(chessboard[index].left + tile_width / 2.0f, chessboard[index].top + tile_height / 2.0f)));
-				d2d_render_target->DrawBitmap(PieceBitmaps[symbolToBitmap[symbol]], chessboard[index]);
-				d2d_render_target->SetTransform(D2D1::Matrix3x2F::Identity());
+	d2d_render_target->BeginDraw();
+	for (const SceneRect& area : dirty) {
+		d2d_render_target->PushAxisAlignedClip(RectF(area.left, area.top, area.right, area.bottom), D2D1_ANTIALIAS_MODE_ALIASED);
+		d2d_render_target->Clear(D2D1::ColorF(D2D1::ColorF::LightCyan));
+		for (const SceneCommand& command : scene.getCommands()) {
+			if (command.bounds().intersects(area)) {
+				drawCommand(command);
 			}
-			else
-			d2d_render_target->DrawBitmap(PieceBitmaps[symbolToBitmap[symbol]], chessboard[index]);
-		}
-		else {
-			picked_symbol = symbol;
 		}
+		d2d_render_target->PopAxisAlignedClip();
 	}
-	if (isPicked) {
-		d2d_render_target->DrawBitmap(PieceBitmaps[symbolToBitmap[picked_symbol]], D2D1::RectF(mouse_x - tile_width / 2.0f, mouse_y - tile_width / 2.0f, mouse_x + tile_width / 2.0f, mouse_y + tile_width / 2.0f));
-	}
-
-	d2d_render_target->DrawText(
-		currentMessage, wcslen(currentMessage),
-		text_format,
-		D2D1::RectF(100.0f, 100.0f, 1000.0f, 1000.0f),
-		brush
-	);
-
-	
-
-		d2d_render_target->EndDraw();
+	hr = d2d_render_target->EndDraw();
 
-	
-	if (FAILED(hr || hr == D2DERR_RECREATE_TARGET)) {
+	if (hr == D2DERR_RECREATE_TARGET) {
 		SafeRelease(&brush);
 		SafeRelease(&d2d_render_target);
-		return hr;
+		fullRedraw = TRUE;
+		return S_OK; // recreated on the next paint
 	}
-
+	std::swap(lastScene, scene);
+	fullRedraw = FAILED(hr);
 	return hr;
 }
 
 void DrawingChessboardInterface::cleanup() {
-	d2d_render_target->Release();
-	d2d_factory->Release();
+	for (UINT i = 0; i < 12; ++i) {
+		SafeRelease(&PieceBitmaps[i]);
+	}
+	for (UINT i = 0; i < 3; ++i) {
+		SafeRelease(&TileBitmaps[i]);
+	}
+	SafeRelease(&brush);
+	SafeRelease(&brush_style);
+	SafeRelease(&text_format);
+	SafeRelease(&text_format2);
+	SafeRelease(&d2d_render_target);
+	SafeRelease(&d2d_factory);
 }
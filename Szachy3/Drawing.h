@@ -3,6 +3,10 @@
 
 #include <d2d1_3.h>
 #include <dwrite_3.h>
+#include "board_snapshot.h"
+#include "render_scene.h"
+#include "sprite_atlas.h"
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -32,19 +36,22 @@ private:
 	static const UINT bishop_index = 3;
 	static const UINT queen_index = 4;
 	static const UINT king_index = 5;
-	ID2D1Bitmap* PieceBitmaps[12]; // for example, use: PieceBitmaps[white_index + pawn_index] if you want to access white pawn bitmap
-	ID2D1Bitmap* TileBitmaps[3]; // for example, use: TileBitmaps[white_index] if you want to access white tile bitmap
+	ID2D1Bitmap* PieceBitmaps[12]{}; // for example, use: PieceBitmaps[white_index + pawn_index] if you want to access white pawn bitmap
+	ID2D1Bitmap* TileBitmaps[3]{}; // for example, use: TileBitmaps[white_index] if you want to access white tile bitmap
 	LPCWSTR pieces_file_names[12] = { L"white-pawn.png", L"white-rook.png",
 		L"white-knight.png", L"white-bishop.png", L"white-queen.png", L"white-king.png", L"black-pawn.png",
 		L"black-rook.png", L"black-knight.png", L"black-bishop.png", L"black-queen.png", L"black-king.png" };
 	LPCWSTR tiles_file_names[3] = { L"white-tile.bmp", L"black-tile.bmp", L"transparent_red_for_check.bmp" };
+	const char* atlas_file_name = "sprites.atlas"; // made by tools/pack_atlas from the files above
+	std::unique_ptr<SpriteAtlas> atlas;
+	size_t atlasLevel{ SIZE_MAX }; // atlas level the bitmaps were created from
 	HWND hwnd;
 	bool isPicked = FALSE;
 	int pickedFigure = -1;
 
 	FLOAT tile_width{ 0.0 };
 	FLOAT tile_height{ 0.0 };
-	vector<pair<int, char>> positionToPieceMap;
+	BoardSnapshot position;
 
 	ID2D1SolidColorBrush* brush{ nullptr };
 	ID2D1RadialGradientBrush* radial_brush{ nullptr };
@@ -75,6 +82,12 @@ private:
 	int pulsing_index = -1; // piece bitmap index
 	float pulse_value = 0.0f;
 	float pulse_increase = 0.01f;
+	RenderScene scene; // commands of the frame being drawn
+	RenderScene lastScene; // commands of the frame on screen
+	BOOL fullRedraw = TRUE; // the screen no longer matches lastScene
+
+	BoardSceneState sceneState() const;
+	void drawCommand(const SceneCommand& command);
 
 	
 
@@ -104,11 +117,12 @@ public:
 	void unsetPickedFigure();
 	void setCurrentMessage(const WCHAR* m);
 	void changeTurn();
-	void setPositionToPieceMap(const std::vector<std::pair<int, char>>& map);
+	void setPosition(const BoardSnapshot& snapshot);
 	HRESULT initialize();
 	HRESULT drawChessboard();
-	HRESULT createRenderResources(HWND hwnd, ID2D1Factory7* d2d_factory, ID2D1HwndRenderTarget* d2d_render_target);
+	HRESULT createRenderResources();
 	HRESULT load_pieces_and_tiles_bitmaps();
+	HRESULT load_bitmaps_from_atlas();
 	void cleanup();
 	void calculateChessboardRects(RECT client_rect);
 	int isMouseOnTile();
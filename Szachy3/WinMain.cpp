@@ -1,9 +1,14 @@
 #include "WinMain.h"
 #include "Drawing.h"
+#include "analysis_session.h"
 #include "board.h"
 #include "board_exceptions.h"
+#include "game_record.h"
+#include "trace.h"
 #include <d2d1_3.h>
 #include <dwrite_3.h>
+#include <cstdlib>
+#include <cwchar>
 
 
 
@@ -19,13 +24,50 @@ namespace {
 	BOOL FIGURE_PICKED = FALSE;
 	INT picked_figure = -1;
 	std::shared_ptr<Board> board;
+	unique_ptr<GameRecord> record;
 	INT from = -1;
 	INT to = -1;
-	vector<pair<int, char>> indexToPiece;
+	BoardSnapshot snapshot;
 	unique_ptr<DrawingChessboardInterface> dci;
 	bool pulsing = FALSE;
 	int pulse_index = -1;
 	int aux = 0;
+	// posted by the analysis thread when it has a new update
+	constexpr UINT WM_ANALYSIS = WM_APP + 1;
+	// F2 toggles the analysis, shown in the window title
+	unique_ptr<AnalysisSession> analysis;
+	constexpr const WCHAR* window_title = L"Let's play!";
+
+	void Reanalyze() {
+		if (analysis) {
+			analysis->analyze(*board);
+		}
+	}
+
+	void ShowAnalysis(HWND hwnd) {
+		AnalysisUpdate update;
+		if (!analysis || !analysis->latest(update) || update.lines.empty()) {
+			SetWindowText(hwnd, window_title);
+			return;
+		}
+		const SearchLine& best = update.lines.front();
+		int white_score = (update.sideToMove == WHITE) ? best.score : -best.score;
+		WCHAR title[256];
+		int length;
+		if (isMateScore(best.score)) {
+			int moves = (mate_score - std::abs(best.score) + 1) / 2;
+			length = swprintf(title, 256, L"%ls - depth %d, mate in %d for %ls, ", window_title, update.depth, moves,
+				(white_score > 0) ? L"white" : L"black");
+		}
+		else {
+			length = swprintf(title, 256, L"%ls - depth %d, %+.2f, ", window_title, update.depth, white_score / 100.0);
+		}
+		for (size_t i = 0; i < best.pv.size() && i < 8 && length > 0 && length < 240; ++i) {
+			string move = Board::moveToString(best.pv[i]);
+			length += swprintf(title + length, 256 - length, L"%hs ", move.c_str());
+		}
+		SetWindowText(hwnd, title);
+	}
 }
 
 
@@ -39,7 +81,10 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		InitTimer(hwnd);
 		board = std::make_shared<Board>();
 		board->init();
-		dci->setPositionToPieceMap(board->indexToPieceMap());
+		record = std::make_unique<GameRecord>(board);
+		if (board->snapshots().read(snapshot)) {
+			dci->setPosition(snapshot);
+		}
 		return hr;
 
 	case WM_CLOSE:
@@ -50,6 +95,7 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		return 0;
 
 	case WM_DESTROY:
+		analysis.reset();
 		dci->cleanup();
 		PostQuitMessage(0);
 
@@ -88,31 +134,31 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		dci->set_mouse_position(LOWORD(lParam), HIWORD(lParam));
 		to = dci->isMouseOnTile();
 		if (to != -1 && FIGURE_PICKED) {
-						try {
-							board->move(from, to);
-							if (board->isChecked(WHITE)) {
-								MessageBox(hwnd, L"White is checked", TEXT("Warning"), MB_OK);
-							}
-							if (board->isChecked(BLACK)) {
-								MessageBox(hwnd, L"Black is checked", TEXT("Warning"), MB_OK);
-							}
-							dci->changeTurn();
-							dci->unsetPickedFigure();
-							FIGURE_PICKED = FALSE;
-							pulsing = FALSE;
-							pulse_index = -1;
-							dci->unsetPulsingIndex();
-
-						}
-						catch (const InvalidMoveException& e) {
-							dci->setCurrentMessage(invalidMove);
-						}
-						catch (const std::exception& e) {
-						}
-
+			// after stepping back with the arrow keys, a move replaces the rest of the game
+			MoveStatus status = record->play({ from, to });
+			if (status == MoveStatus::OK) {
+				if (board->isChecked(WHITE)) {
+					MessageBox(hwnd, L"White is checked", TEXT("Warning"), MB_OK);
+				}
+				if (board->isChecked(BLACK)) {
+					MessageBox(hwnd, L"Black is checked", TEXT("Warning"), MB_OK);
+				}
+				dci->changeTurn();
+				dci->unsetPickedFigure();
+				FIGURE_PICKED = FALSE;
+				pulsing = FALSE;
+				pulse_index = -1;
+				dci->unsetPulsingIndex();
+				Reanalyze();
+			}
+			else if (status == MoveStatus::INVALID_MOVE || status == MoveStatus::KING_IN_CHECK) {
+				dci->setCurrentMessage(invalidMove);
+			}
 		}
 		dci->unsetPickedFigure();
-		dci->setPositionToPieceMap(board->indexToPieceMap());
+		if (board->snapshots().read(snapshot)) {
+			dci->setPosition(snapshot);
+		}
 		InvalidateRect(hwnd, nullptr, FALSE);
 		return hr;
 	case WM_MOUSEMOVE:
@@ -140,6 +186,52 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 		}
 		InvalidateRect(hwnd, nullptr, FALSE);
 		return hr;
+	case WM_KEYDOWN:
+#ifdef SZACHY_TRACE
+		// F12 starts recording a trace, pressing it again saves it
+		if (wParam == VK_F12) {
+			if (!trace::isEnabled()) {
+				trace::clear();
+				trace::setEnabled(true);
+			}
+			else {
+				trace::setEnabled(false);
+				trace::writeChromeTrace("szachy_trace.json");
+			}
+		}
+#endif
+		// Left/Right step through the game, Home/End jump to its start and end
+		if (wParam == VK_LEFT || wParam == VK_RIGHT || wParam == VK_HOME || wParam == VK_END) {
+			int ply = record->ply();
+			int target = (wParam == VK_LEFT) ? ply - 1 : (wParam == VK_RIGHT) ? ply + 1 : (wParam == VK_HOME) ? 0 : record->length();
+			if (target >= 0 && target <= record->length() && target != ply) {
+				record->seek(target);
+				if ((target - ply) % 2 != 0) {
+					dci->changeTurn();
+				}
+				if (board->snapshots().read(snapshot)) {
+					dci->setPosition(snapshot);
+				}
+				Reanalyze();
+				InvalidateRect(hwnd, nullptr, FALSE);
+			}
+		}
+		if (wParam == VK_F2) {
+			if (analysis) {
+				analysis.reset();
+			}
+			else {
+				analysis = std::make_unique<AnalysisSession>([hwnd](const AnalysisUpdate&) {
+					PostMessage(hwnd, WM_ANALYSIS, 0, 0);
+				});
+				Reanalyze();
+			}
+			ShowAnalysis(hwnd);
+		}
+		return 0;
+	case WM_ANALYSIS:
+		ShowAnalysis(hwnd);
+		return 0;
 	case WM_SIZE:
 		dci->calculateChessboardRects({ 0, 0, LOWORD(lParam), HIWORD(lParam) });
 		InvalidateRect(hwnd, nullptr, FALSE);
@@ -181,7 +273,7 @@ INT WINAPI wWinMain(
 	HWND hwnd = CreateWindowEx(
 		0,
 		TEXT("WindowClass"),
-		TEXT("Let's play!"),
+		window_title,
 		WS_OVERLAPPEDWINDOW,
 		wr.left,                        // Adjusted x-coordinate
 		wr.top,                         // Adjusted y-coordinate
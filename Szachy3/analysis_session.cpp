@@ -0,0 +1,101 @@
+#include "analysis_session.h"
+#include <stdexcept>
+
+AnalysisSession::AnalysisSession(UpdateCallback on_update, const SearchLimits& limits, const SearchOptions& options)
+        : limits(limits), onUpdate(std::move(on_update)), searcher(options),
+          worker([this](std::stop_token shutdown) { run(shutdown); }) {}
+
+AnalysisSession::~AnalysisSession() {
+    {
+        std::lock_guard lock(mutex);
+        current.request_stop();
+    }
+    worker.request_stop(); // also wakes the worker waiting for a position
+    worker.join();
+}
+
+uint64_t AnalysisSession::analyze(const Board& board) {
+    string fen = board.toFen();
+    std::lock_guard lock(mutex);
+    current.request_stop();
+    current = std::stop_source{};
+    pendingFen = std::move(fen);
+    latestUpdate.reset();
+    ++positionNumber;
+    wakeUp.notify_one();
+    return positionNumber;
+}
+
+uint64_t AnalysisSession::analyze(string_view fen) {
+    auto board = std::make_shared<Board>();
+    board->initFromFen(fen);
+    return analyze(*board);
+}
+
+void AnalysisSession::cancel() {
+    std::lock_guard lock(mutex);
+    current.request_stop();
+    pendingFen.reset();
+    latestUpdate.reset();
+    ++positionNumber; // updates still on their way belong to no position
+}
+
+bool AnalysisSession::latest(AnalysisUpdate& out) const {
+    std::lock_guard lock(mutex);
+    if (!latestUpdate) {
+        return false;
+    }
+    out = *latestUpdate;
+    return true;
+}
+
+void AnalysisSession::publish(uint64_t position, Color side, const SearchResult& result,
+                              std::chrono::steady_clock::time_point start, bool finished) {
+    AnalysisUpdate update;
+    update.position = position;
+    update.sideToMove = side;
+    update.depth = result.depth;
+    update.score = result.score;
+    update.nodes = result.nodes;
+    update.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    update.lines = result.lines;
+    update.finished = finished;
+    {
+        std::lock_guard lock(mutex);
+        if (position != positionNumber) {
+            return;
+        }
+        latestUpdate = update;
+    }
+    if (onUpdate) {
+        onUpdate(update);
+    }
+}
+
+void AnalysisSession::run(std::stop_token shutdown) {
+    auto board = std::make_shared<Board>();
+    while (true) {
+        string fen;
+        uint64_t position;
+        SearchLimits position_limits = limits;
+        {
+            std::unique_lock lock(mutex);
+            if (!wakeUp.wait(lock, shutdown, [this] { return pendingFen.has_value(); })) {
+                return;
+            }
+            fen = std::move(*pendingFen);
+            pendingFen.reset();
+            position = positionNumber;
+            position_limits.stopToken = current.get_token();
+        }
+        board->initFromFen(fen); // written by toFen, so it loads
+        Color side = board->getTurn();
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = searcher.search(*board, position_limits, [&](const SearchResult& r) {
+            publish(position, side, r, start, false);
+        });
+        if (!position_limits.stopToken.stop_requested()) {
+            publish(position, side, result, start, true);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef ANALYSIS_SESSION_H
+#define ANALYSIS_SESSION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "search.h"
+
+// One iteration of the analysis of one position.
+struct AnalysisUpdate {
+    uint64_t position{0}; // which analyze() call it answers, counted from 1
+    Color sideToMove{WHITE}; // the scores are from its point of view
+    int depth{0};
+    int score{0};
+    uint64_t nodes{0};
+    std::chrono::milliseconds elapsed{0};
+    vector<SearchLine> lines; // best first, see SearchLimits::multiPv
+    bool finished{false}; // the search ended by itself: depth or node limit, mate found, no legal move
+};
+
+// Analyses positions on a background thread for an interactive front-end.
+// analyze() copies the position and returns at once; the previous analysis
+// is cancelled through a stop token and the new one starts as soon as the
+// search notices. Updates of a cancelled position are never delivered.
+// The hash table is kept from position to position, so analysing the game
+// move by move reuses most of the work.
+class AnalysisSession {
+public:
+    // Called on the background thread after every iteration; it should only
+    // hand the update over (e.g. post a window message), the search waits.
+    using UpdateCallback = std::function<void(const AnalysisUpdate&)>;
+private:
+    SearchLimits limits;
+    UpdateCallback onUpdate;
+    Searcher searcher; // used by the background thread only
+    mutable std::mutex mutex;
+    std::condition_variable_any wakeUp;
+    std::optional<string> pendingFen;
+    uint64_t positionNumber{0};
+    std::stop_source current; // cancels the analysis of positionNumber
+    std::optional<AnalysisUpdate> latestUpdate;
+    std::jthread worker; // last, so it starts after everything it uses
+
+    void run(std::stop_token shutdown);
+    void publish(uint64_t position, Color side, const SearchResult& result, std::chrono::steady_clock::time_point start,
+                 bool finished);
+public:
+    // Limits of each position's analysis; the default depth runs until the
+    // next analyze() or cancel().
+    explicit AnalysisSession(UpdateCallback on_update, const SearchLimits& limits = {}, const SearchOptions& options = {});
+    ~AnalysisSession();
+    AnalysisSession(const AnalysisSession&) = delete;
+    AnalysisSession& operator=(const AnalysisSession&) = delete;
+
+    // Starts analysing the position of board, cancelling the previous one.
+    // Returns the number that the updates of this position carry.
+    uint64_t analyze(const Board& board);
+    // Same, for a FEN; throws std::invalid_argument when it cannot be loaded.
+    uint64_t analyze(string_view fen);
+    // Cancels the current analysis without starting another.
+    void cancel();
+    // Copies the newest update of the current position; false if there is none yet.
+    bool latest(AnalysisUpdate& out) const;
+};
+
+#endif // ANALYSIS_SESSION_H
@@ -0,0 +1,267 @@
+#include "attack_map.h"
+#include "board.h"
+#include <algorithm>
+#include <bit>
+
+namespace {
+    // Directions 0-3 go to higher square indices, 4-7 to lower ones.
+    constexpr int direction_rows[8] = {1, 1, 0, 1, -1, -1, 0, -1};
+    constexpr int direction_cols[8] = {0, 1, 1, -1, 0, -1, -1, 1};
+    constexpr int rook_directions[4] = {0, 2, 4, 6};
+    constexpr int bishop_directions[4] = {1, 3, 5, 7};
+    constexpr int piece_values[6] = {1, 5, 3, 3, 9, 100}; // PieceType order
+
+    struct Tables {
+        uint64_t rays[64][8]{}; // every square in a direction up to the edge
+        uint64_t knight[64]{};
+        uint64_t king[64]{};
+        uint64_t pawn[2][64]{};
+
+        constexpr Tables() {
+            auto bit = [](int row, int col) {
+                return (row >= 0 && row < 8 && col >= 0 && col < 8) ? uint64_t{1} << (row * 8 + col) : 0;
+            };
+            for (int square{0}; square < 64; ++square) {
+                int row = square / 8;
+                int col = square % 8;
+                for (int d{0}; d < 8; ++d) {
+                    for (int r{row + direction_rows[d]}, c{col + direction_cols[d]}; bit(r, c) != 0;
+                         r += direction_rows[d], c += direction_cols[d]) {
+                        rays[square][d] |= bit(r, c);
+                    }
+                    king[square] |= bit(row + direction_rows[d], col + direction_cols[d]);
+                }
+                for (int dr : {-2, -1, 1, 2}) {
+                    int dc = (dr == 2 || dr == -2) ? 1 : 2;
+                    knight[square] |= bit(row + dr, col + dc) | bit(row + dr, col - dc);
+                }
+                pawn[0][square] = bit(row + 1, col - 1) | bit(row + 1, col + 1);
+                pawn[1][square] = bit(row - 1, col - 1) | bit(row - 1, col + 1);
+            }
+        }
+    };
+
+    constexpr Tables tables;
+
+    // The ray up to and including the first occupied square.
+    uint64_t ray(int square, int direction, uint64_t occupancy) {
+        uint64_t full = tables.rays[square][direction];
+        uint64_t blockers = full & occupancy;
+        if (blockers == 0) {
+            return full;
+        }
+        int first = (direction < 4) ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers);
+        return full ^ tables.rays[first][direction];
+    }
+}
+
+AttackMap::AttackMap() {
+    clear();
+}
+
+void AttackMap::clear() {
+    pieces.fill(empty_square);
+    occupied = {};
+    attacksFrom = {};
+    attackersTo = {};
+    counts = {};
+    attacked = {};
+}
+
+uint64_t AttackMap::computeAttacks(int square) const {
+    int color = pieces[square] >> 3;
+    uint64_t occupancy = occupied[0] | occupied[1];
+    uint64_t attacks{0};
+    switch (static_cast<PieceType>(pieces[square] & 7)) {
+        case PAWN:
+            return tables.pawn[color][square];
+        case KNIGHT:
+            return tables.knight[square];
+        case KING:
+            return tables.king[square];
+        case ROOK:
+            for (int d : rook_directions) {
+                attacks |= ray(square, d, occupancy);
+            }
+            return attacks;
+        case BISHOP:
+            for (int d : bishop_directions) {
+                attacks |= ray(square, d, occupancy);
+            }
+            return attacks;
+        case QUEEN:
+            for (int d{0}; d < 8; ++d) {
+                attacks |= ray(square, d, occupancy);
+            }
+            return attacks;
+        default:
+            return 0;
+    }
+}
+
+void AttackMap::setAttacks(int square, uint64_t attacks) {
+    int color = pieces[square] >> 3;
+    uint64_t from = uint64_t{1} << square;
+    uint64_t old = attacksFrom[square];
+    for (uint64_t lost = old & ~attacks; lost != 0; lost &= lost - 1) {
+        int target = std::countr_zero(lost);
+        attackersTo[target] &= ~from;
+        if (--counts[color][target] == 0) {
+            attacked[color] &= ~(uint64_t{1} << target);
+        }
+    }
+    for (uint64_t gained = attacks & ~old; gained != 0; gained &= gained - 1) {
+        int target = std::countr_zero(gained);
+        attackersTo[target] |= from;
+        ++counts[color][target];
+        attacked[color] |= uint64_t{1} << target;
+    }
+    attacksFrom[square] = attacks;
+}
+
+void AttackMap::updateRays(int square) {
+    uint64_t occupancy = occupied[0] | occupied[1];
+    uint64_t target = uint64_t{1} << square;
+    for (uint64_t attackers = attackersTo[square]; attackers != 0; attackers &= attackers - 1) {
+        int from = std::countr_zero(attackers);
+        auto type = static_cast<PieceType>(pieces[from] & 7);
+        if (type != ROOK && type != BISHOP && type != QUEEN) {
+            continue;
+        }
+        for (int d{0}; d < 8; ++d) {
+            uint64_t full = tables.rays[from][d];
+            if (full & target) {
+                setAttacks(from, (attacksFrom[from] & ~full) | ray(from, d, occupancy));
+                break;
+            }
+        }
+    }
+}
+
+void AttackMap::add(int square, Color color, PieceType type) {
+    pieces[square] = static_cast<uint8_t>(static_cast<int>(color) << 3 | static_cast<int>(type));
+    occupied[static_cast<int>(color)] |= uint64_t{1} << square;
+    updateRays(square);
+    setAttacks(square, computeAttacks(square));
+}
+
+void AttackMap::remove(int square) {
+    setAttacks(square, 0);
+    occupied[pieces[square] >> 3] &= ~(uint64_t{1} << square);
+    pieces[square] = empty_square;
+    updateRays(square);
+}
+
+void AttackMap::replace(int square, Color color, PieceType type) {
+    setAttacks(square, 0);
+    occupied[pieces[square] >> 3] &= ~(uint64_t{1} << square);
+    pieces[square] = static_cast<uint8_t>(static_cast<int>(color) << 3 | static_cast<int>(type));
+    occupied[static_cast<int>(color)] |= uint64_t{1} << square;
+    setAttacks(square, computeAttacks(square));
+}
+
+uint64_t AttackMap::attackersOf(int square, Color color) const {
+    return attackersTo[square] & occupied[static_cast<int>(color)];
+}
+
+int AttackMap::attackerCount(int square, Color color) const {
+    return counts[static_cast<int>(color)][square];
+}
+
+bool AttackMap::isSquareAttacked(int square, Color by) const {
+    return counts[static_cast<int>(by)][square] != 0;
+}
+
+uint64_t AttackMap::attackedSquares(Color by) const {
+    return attacked[static_cast<int>(by)];
+}
+
+uint64_t AttackMap::attacksOf(int square) const {
+    return attacksFrom[square];
+}
+
+uint64_t AttackMap::hangingPieces(Color color) const {
+    int own = static_cast<int>(color);
+    uint64_t hanging{0};
+    for (uint64_t squares = occupied[own] & attacked[own ^ 1]; squares != 0; squares &= squares - 1) {
+        int square = std::countr_zero(squares);
+        if (static_cast<PieceType>(pieces[square] & 7) == KING) {
+            continue;
+        }
+        int value = piece_values[pieces[square] & 7];
+        bool cheaper{false};
+        for (uint64_t attackers = attackersTo[square] & occupied[own ^ 1]; attackers != 0 && !cheaper; attackers &= attackers - 1) {
+            cheaper = piece_values[pieces[std::countr_zero(attackers)] & 7] < value;
+        }
+        if (counts[own][square] == 0 || cheaper) {
+            hanging |= uint64_t{1} << square;
+        }
+    }
+    return hanging;
+}
+
+int AttackMap::staticExchange(int from, int to) const {
+    std::array<uint64_t, 6> by_type{}; // both colors
+    for (uint64_t squares = occupied[0] | occupied[1]; squares != 0; squares &= squares - 1) {
+        int square = std::countr_zero(squares);
+        by_type[pieces[square] & 7] |= uint64_t{1} << square;
+    }
+    uint64_t diagonal = by_type[static_cast<int>(BISHOP)] | by_type[static_cast<int>(QUEEN)];
+    uint64_t straight = by_type[static_cast<int>(ROOK)] | by_type[static_cast<int>(QUEEN)];
+    uint64_t occupancy = occupied[0] | occupied[1];
+    auto attackers_of_to = [&] {
+        uint64_t rook_rays{0};
+        uint64_t bishop_rays{0};
+        for (int d : rook_directions) {
+            rook_rays |= ray(to, d, occupancy);
+        }
+        for (int d : bishop_directions) {
+            bishop_rays |= ray(to, d, occupancy);
+        }
+        uint64_t pawns = by_type[static_cast<int>(PAWN)];
+        return ((rook_rays & straight) | (bishop_rays & diagonal) | (tables.knight[to] & by_type[static_cast<int>(KNIGHT)]) |
+                (tables.king[to] & by_type[static_cast<int>(KING)]) | (tables.pawn[1][to] & pawns & occupied[0]) |
+                (tables.pawn[0][to] & pawns & occupied[1])) & occupancy;
+    };
+
+    // gains[i]: material of the side making capture i if the exchange stopped after it
+    std::array<int, 33> gains{};
+    int depth{0};
+    gains[0] = (pieces[to] == empty_square) ? 0 : piece_values[pieces[to] & 7];
+    int side = pieces[from] >> 3;
+    int on_square = piece_values[pieces[from] & 7]; // value of the piece that just captured
+    uint64_t capturer = uint64_t{1} << from;
+    while (depth + 1 < static_cast<int>(gains.size())) {
+        occupancy &= ~capturer;
+        side ^= 1;
+        uint64_t attackers = attackers_of_to() & occupied[side];
+        if (attackers == 0) {
+            break;
+        }
+        for (PieceType type : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+            if (uint64_t of_type = attackers & by_type[static_cast<int>(type)]) {
+                capturer = of_type & (~of_type + 1);
+                ++depth;
+                gains[depth] = on_square - gains[depth - 1];
+                on_square = piece_values[static_cast<int>(type)];
+                break;
+            }
+        }
+    }
+    while (depth > 0) {
+        gains[depth - 1] = -std::max(-gains[depth - 1], gains[depth]);
+        --depth;
+    }
+    return gains[0];
+}
+
+uint64_t AttackMap::kingEscapes(Color color) const {
+    int own = static_cast<int>(color);
+    for (uint64_t squares = occupied[own]; squares != 0; squares &= squares - 1) {
+        int square = std::countr_zero(squares);
+        if (static_cast<PieceType>(pieces[square] & 7) == KING) {
+            return tables.king[square] & ~occupied[own] & ~attacked[own ^ 1];
+        }
+    }
+    return 0;
+}
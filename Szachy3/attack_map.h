@@ -0,0 +1,59 @@
+#ifndef ATTACK_MAP_H
+#define ATTACK_MAP_H
+
+#include <array>
+#include <cstdint>
+
+enum class PieceType;
+enum class Color;
+
+// Squares attacked by every piece of a position, kept up to date piece by
+// piece. Board feeds it the same changes it makes to its position map; a
+// placed or lifted piece only makes the sliders whose ray ends on its square
+// recompute that one ray. Attacks include squares of the attacker's own
+// pieces, so attackers of such a square are its defenders.
+class AttackMap {
+private:
+    static constexpr uint8_t empty_square{0xFF};
+    std::array<uint8_t, 64> pieces{}; // color << 3 | type, or empty_square
+    std::array<uint64_t, 2> occupied{};
+    std::array<uint64_t, 64> attacksFrom{}; // squares attacked by the piece on a square
+    std::array<uint64_t, 64> attackersTo{}; // squares of the pieces attacking a square
+    std::array<std::array<uint8_t, 64>, 2> counts{}; // attackers of a square, by color
+    std::array<uint64_t, 2> attacked{}; // squares with a nonzero count, by color
+
+    void setAttacks(int square, uint64_t attacks);
+    // Re-extends or cuts short the sliders' rays that end on square.
+    void updateRays(int square);
+    [[nodiscard]] uint64_t computeAttacks(int square) const;
+public:
+    AttackMap();
+    void clear();
+    // square must be empty
+    void add(int square, Color color, PieceType type);
+    // square must be occupied
+    void remove(int square);
+    // A capture: the piece on square is replaced without changing any ray.
+    void replace(int square, Color color, PieceType type);
+
+    // Squares of color's pieces attacking square, as a bit mask.
+    [[nodiscard]] uint64_t attackersOf(int square, Color color) const;
+    [[nodiscard]] int attackerCount(int square, Color color) const;
+    [[nodiscard]] bool isSquareAttacked(int square, Color by) const;
+    [[nodiscard]] uint64_t attackedSquares(Color by) const;
+    // Squares attacked by the piece on square, 0 when it is empty.
+    [[nodiscard]] uint64_t attacksOf(int square) const;
+    // color's pieces, other than the king, that are attacked and either not
+    // defended or attacked by a cheaper piece.
+    [[nodiscard]] uint64_t hangingPieces(Color color) const;
+    // Material won (negative when lost), in pawns, by the side moving from
+    // from to to when both sides then keep recapturing on to with their
+    // cheapest piece, each free to stop; sliders behind a capturer join in.
+    [[nodiscard]] int staticExchange(int from, int to) const;
+    // Empty or enemy squares next to color's king that the other side does
+    // not attack. Rays through the king are not extended, so a square behind
+    // it on a checker's line still counts as an escape.
+    [[nodiscard]] uint64_t kingEscapes(Color color) const;
+};
+
+#endif // ATTACK_MAP_H
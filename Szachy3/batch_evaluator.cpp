@@ -0,0 +1,65 @@
+#include "batch_evaluator.h"
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+BatchEvaluator::BatchEvaluator(const BatchOptions& options, size_t threads) : options(options), pool(threads) {
+    if (this->options.chunkSize == 0) {
+        throw std::invalid_argument("Batch chunk size must be positive");
+    }
+    scratch.resize(pool.size());
+    for (Scratch& s : scratch) {
+        s.board = std::make_shared<Board>();
+        s.searcher = std::make_unique<Searcher>(options.search);
+    }
+}
+
+size_t BatchEvaluator::threadCount() const {
+    return pool.size();
+}
+
+void BatchEvaluator::run(size_t count, const Loader& load, std::span<BatchScore> out,
+                         const std::function<void(size_t, size_t)>& on_progress) {
+    if (out.size() < count) {
+        throw std::invalid_argument("Batch output shorter than its input");
+    }
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.nodes = options.nodes;
+    std::mutex progress_mutex;
+    size_t done{0};
+    for (size_t first{0}; first < count; first += options.chunkSize) {
+        size_t last = std::min(count, first + options.chunkSize);
+        pool.submit([&, first, last] {
+            Scratch& s = scratch[static_cast<size_t>(ThreadPool::currentWorker())];
+            for (size_t i{first}; i < last; ++i) {
+                out[i] = BatchScore{};
+                try {
+                    load(*s.board, i);
+                } catch (const std::exception&) {
+                    continue; // left invalid
+                }
+                if (options.freshHash) {
+                    s.searcher->newGame();
+                }
+                SearchResult result = s.searcher->search(*s.board, limits);
+                out[i] = {result.score, result.bestMove, result.depth, result.nodes, true};
+            }
+            std::lock_guard lock(progress_mutex);
+            done += last - first;
+            if (on_progress) {
+                on_progress(done, count);
+            }
+        });
+    }
+    pool.wait();
+}
+
+void BatchEvaluator::evaluate(std::span<const string> fens, std::span<BatchScore> out, const ProgressCallback& on_progress) {
+    run(fens.size(), [fens](Board& board, size_t i) { board.initFromFen(fens[i]); }, out, on_progress);
+}
+
+void BatchEvaluator::evaluate(std::span<const CompactBoard> positions, std::span<BatchScore> out,
+                              const ProgressCallback& on_progress) {
+    run(positions.size(), [positions](Board& board, size_t i) { board.initFromCompact(positions[i]); }, out, on_progress);
+}
@@ -0,0 +1,64 @@
+#ifndef BATCH_EVALUATOR_H
+#define BATCH_EVALUATOR_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "search.h"
+#include "thread_pool.h"
+
+struct BatchOptions {
+    int depth{4};
+    uint64_t nodes{0}; // per position, 0 - unlimited
+    SearchOptions search{.hashMegabytes = 2};
+    // Clears the worker's hash table and move ordering state before every
+    // position, so a score does not depend on which positions the same
+    // worker scored before.
+    bool freshHash{true};
+    size_t chunkSize{32}; // positions per task; workers steal whole chunks
+};
+
+struct BatchScore {
+    int score{0}; // from the side to move's point of view
+    Move bestMove; // null when the position has no legal move
+    int depth{0};
+    uint64_t nodes{0};
+    bool valid{false}; // false when the position could not be loaded
+};
+
+// Scores lists of positions with a fixed-depth search on a work-stealing
+// ThreadPool. Every worker keeps its own Board and Searcher (with its hash
+// table) for all the batches, so a batch only costs the searches themselves.
+class BatchEvaluator {
+private:
+    struct Scratch {
+        std::shared_ptr<Board> board;
+        std::unique_ptr<Searcher> searcher;
+    };
+
+    BatchOptions options;
+    ThreadPool pool;
+    vector<Scratch> scratch; // one per worker
+
+    using Loader = std::function<void(Board&, size_t)>;
+    void run(size_t count, const Loader& load, std::span<BatchScore> out,
+             const std::function<void(size_t, size_t)>& on_progress);
+public:
+    explicit BatchEvaluator(const BatchOptions& options = {}, size_t threads = std::thread::hardware_concurrency());
+
+    // Called after every chunk, from a worker thread but never concurrently,
+    // with the number of positions done so far and the batch size.
+    using ProgressCallback = std::function<void(size_t done, size_t total)>;
+
+    // out[i] receives the score of positions[i]; out must be at least as long.
+    void evaluate(std::span<const string> fens, std::span<BatchScore> out, const ProgressCallback& on_progress = {});
+    void evaluate(std::span<const CompactBoard> positions, std::span<BatchScore> out,
+                  const ProgressCallback& on_progress = {});
+    [[nodiscard]] size_t threadCount() const;
+};
+
+#endif // BATCH_EVALUATOR_H
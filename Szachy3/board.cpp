@@ -3,13 +3,18 @@
 //
 
 #include <cassert>
+#include <cctype>
 #include <stdexcept>
 #include "board.h"
 #include "board_exceptions.h"
+#include "zobrist.h"
+#include "search_stats.h"
+#include "trace.h"
 #include <string_view>
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <bit>
 #include <iostream>
 using std::invalid_argument;
 using std::vector;
@@ -60,7 +65,7 @@ void Board::init() {
     if (count != 1) {
         throw invalid_argument("Exactly one king should be present!");
     }
-    auto self = shared_from_this();
+    clearPieces();
     // Create pawns
     for (int col{0}; col < board_width; ++col) {
         position_map[getPositionIndex(white_pawns_row_index, col)] = std::make_unique<Pawn>(white_pawns_row_index, col, WHITE);
@@ -96,9 +101,208 @@ void Board::init() {
 
         }
     }
+    turn = WHITE;
+    attachPieces();
+    history.reset(positionKey);
+    publishSnapshot();
+}
+
+void Board::clearPieces() {
+    position_map.clear();
+    position_map.reserve(board_width * board_height);
+}
+
+void Board::attachPieces() {
+    auto self = shared_from_this();
+    pawnKey = 0;
+    positionKey = (turn == BLACK) ? zobrist::sideKey() : 0;
+    attacks.clear();
     for (auto& [index, piece] : position_map) {
         piece->setBoard(self);
+        attacks.add(index, piece->getColor(), piece->getType());
+        positionKey ^= zobrist::pieceKey(piece->getColor(), piece->getType(), index);
+        if (piece->getType() == PAWN) {
+            pawnKey ^= zobrist::pieceKey(piece->getColor(), PAWN, index);
+        }
+    }
+}
+
+PieceType Board::pieceTypeFromSymbol(char symbol) {
+    switch (std::toupper(static_cast<unsigned char>(symbol))) {
+        case 'P':
+            return PAWN;
+        case 'R':
+            return ROOK;
+        case 'N':
+            return KNIGHT;
+        case 'B':
+            return BISHOP;
+        case 'Q':
+            return QUEEN;
+        case 'K':
+            return KING;
+        default:
+            return NO_PIECE;
+    }
+}
+
+void Board::placePiece(PieceType type, Color color, int row, int col) {
+    unique_ptr<Piece> piece;
+    switch (type) {
+        case PAWN:
+            piece = std::make_unique<Pawn>(row, col, color);
+            // pawns cannot move back, so one off its first row has moved
+            piece->setHasMoved(row != ((color == WHITE) ? white_pawns_row_index : black_pawns_row_index));
+            break;
+        case ROOK:
+            piece = std::make_unique<Rook>(row, col, color);
+            break;
+        case KNIGHT:
+            piece = std::make_unique<Knight>(row, col, color);
+            break;
+        case BISHOP:
+            piece = std::make_unique<Bishop>(row, col, color);
+            break;
+        case QUEEN:
+            piece = std::make_unique<Queen>(row, col, color);
+            break;
+        case KING:
+            piece = std::make_unique<King>(row, col, color);
+            ((color == WHITE) ? whiteKingPosition : blackKingPosition) = {row, col};
+            break;
+        default:
+            throw invalid_argument("Unknown figure!");
+    }
+    position_map[getPositionIndex(row, col)] = std::move(piece);
+}
+
+void Board::initFromFen(string_view fen) {
+    clearPieces();
+    int row{board_height - 1};
+    int col{0};
+    size_t i{0};
+    int kings[2]{0, 0};
+    for (; i < fen.size() && fen[i] != ' '; ++i) {
+        char c = fen[i];
+        if (c == '/') {
+            if (col != board_width || row == 0) {
+                throw invalid_argument("Invalid FEN rank: " + string(fen));
+            }
+            --row;
+            col = 0;
+            continue;
+        }
+        if (c >= '1' && c <= '9') {
+            col += c - '0';
+            continue;
+        }
+        if (col >= board_width) {
+            throw invalid_argument("Invalid FEN rank: " + string(fen));
+        }
+        Color color = std::isupper(static_cast<unsigned char>(c)) ? WHITE : BLACK;
+        PieceType type = pieceTypeFromSymbol(c);
+        if (type == NO_PIECE) {
+            throw invalid_argument("Unknown figure in FEN: " + string(1, c));
+        }
+        if (type == KING) {
+            ++kings[static_cast<int>(color)];
+        }
+        placePiece(type, color, row, col);
+        ++col;
+    }
+    if (row != 0 || col != board_width) {
+        throw invalid_argument("Invalid FEN placement: " + string(fen));
+    }
+    if (kings[0] != 1 || kings[1] != 1) {
+        throw invalid_argument("Exactly one king should be present!");
+    }
+    turn = (i + 1 < fen.size() && fen[i + 1] == 'b') ? BLACK : WHITE;
+    // the halfmove clock is the fifth field, after castling and en passant
+    int halfmove_clock{0};
+    size_t field{0};
+    for (size_t j{i}; j < fen.size(); ++j) {
+        if (fen[j] == ' ') {
+            continue;
+        }
+        if (++field == 4) {
+            for (; j < fen.size() && std::isdigit(static_cast<unsigned char>(fen[j])); ++j) {
+                halfmove_clock = std::min(halfmove_clock * 10 + (fen[j] - '0'), 9999);
+            }
+            break;
+        }
+        while (j + 1 < fen.size() && fen[j + 1] != ' ') {
+            ++j;
+        }
+    }
+    gameEnded = false;
+    winner = NO_COLOR;
+    attachPieces();
+    history.reset(positionKey, halfmove_clock);
+    whiteChecked = checkIfChecked(WHITE);
+    blackChecked = checkIfChecked(BLACK);
+    publishSnapshot();
+}
+
+CompactBoard Board::toCompact() const {
+    CompactBoard compact;
+    for (auto& [index, piece] : position_map) {
+        compact.occupancy |= uint64_t{1} << index;
+    }
+    int n{0};
+    for (uint64_t squares = compact.occupancy; squares != 0; squares &= squares - 1, ++n) {
+        const auto& piece = position_map.at(std::countr_zero(squares));
+        uint8_t code = static_cast<uint8_t>(static_cast<int>(piece->getColor()) << 3 | static_cast<int>(piece->getType()));
+        compact.pieces[n / 2] |= (n % 2 == 0) ? code : static_cast<uint8_t>(code << 4);
     }
+    compact.flags = static_cast<uint8_t>((turn == BLACK ? 1 : 0) | (whiteChecked ? 2 : 0) | (blackChecked ? 4 : 0));
+    return compact;
+}
+
+void Board::initFromCompact(const CompactBoard& compact) {
+    clearPieces();
+    int n{0};
+    for (uint64_t squares = compact.occupancy; squares != 0; squares &= squares - 1, ++n) {
+        auto [row, col] = getPosition(std::countr_zero(squares));
+        uint8_t code = (compact.pieces[n / 2] >> ((n % 2) * 4)) & 0xF;
+        placePiece(static_cast<PieceType>(code & 7), (code & 8) ? BLACK : WHITE, row, col);
+    }
+    turn = (compact.flags & 1) ? BLACK : WHITE;
+    whiteChecked = (compact.flags & 2) != 0;
+    blackChecked = (compact.flags & 4) != 0;
+    gameEnded = false;
+    winner = NO_COLOR;
+    attachPieces();
+    history.reset(positionKey);
+    publishSnapshot();
+}
+
+string Board::toFen() const {
+    string fen;
+    for (int row{board_height - 1}; row >= 0; --row) {
+        int empty{0};
+        for (int col{0}; col < board_width; ++col) {
+            auto it = position_map.find(getPositionIndex(row, col));
+            if (it == position_map.end()) {
+                ++empty;
+                continue;
+            }
+            if (empty > 0) {
+                fen += std::to_string(empty);
+                empty = 0;
+            }
+            char symbol = it->second->getSymbol();
+            fen += (it->second->getColor() == WHITE) ? symbol : static_cast<char>(std::tolower(symbol));
+        }
+        if (empty > 0) {
+            fen += std::to_string(empty);
+        }
+        if (row > 0) {
+            fen += '/';
+        }
+    }
+    fen += (turn == WHITE) ? " w - - " : " b - - ";
+    fen += std::to_string(history.halfmoveClock()) + " 1";
+    return fen;
 }
 
 bool Board::isPositionOccupied(int index) const {
@@ -126,56 +330,46 @@ void Piece::setCaptured(bool c) {
 }
 
 string Board::boardString() {
-    string board_str;
-    for (int row{board_height - 1}; row >= 0; --row) {
-        board_str += std::to_string(row + 1) + " ";
-        for (int col{0}; col < board_width; ++col) {
-            auto index = getPositionIndex(row, col);
-            if (position_map.find(index) == position_map.end()) {
-                board_str += '.';
-            } else {
-                board_str += (position_map[index]->getColor() == WHITE) ? std::tolower(position_map[index]->getSymbol()) : position_map[index]->getSymbol();
-            }
-        }
-        board_str += '\n';
-    }
-    string columns;
-    for (int col{0}; col < board_width; ++col) {
-        columns += 'A' + col;
-    }
-    board_str += "  " + columns + '\n';
+    string board_str(board_text_size, '\0');
+    board_str.resize(writeBoardString(board_str));
     return board_str;
 }
 
 string Board::boardStringWithPossibleMoves(int from) {
-    if (!isPositionOccupied(from)) {
+    string board_str(board_text_size, '\0');
+    board_str.resize(writeBoardStringWithPossibleMoves(from, board_str));
+    return board_str;
+}
+
+TextCells Board::textCells() const {
+    TextCells cells;
+    cells.fill('.');
+    for (auto& [index, piece] : position_map) {
+        char symbol = piece->getSymbol();
+        cells[index] = (piece->getColor() == WHITE) ? static_cast<char>(std::tolower(symbol)) : symbol;
+    }
+    return cells;
+}
+
+size_t Board::writeBoardString(std::span<char> out) const {
+    return writeBoardText(textCells(), out);
+}
+
+size_t Board::writeBoardStringWithPossibleMoves(int from, std::span<char> out) const {
+    auto it = position_map.find(from);
+    if (it == position_map.end()) {
         throw NoPieceAtPositionException(getNotation(from));
     }
-    vector<int> possible_moves = getPiece(from)->getPossibleMoves(from);
-    string board_str;
-    for (int row{ board_height - 1 }; row >= 0; --row) {
-        board_str += std::to_string(row + 1) + " ";
-        for (int col{ 0 }; col < board_width; ++col) {
-            auto index = getPositionIndex(row, col);
-            if (position_map.find(index) == position_map.end()) {
-                if (std::find(possible_moves.begin(), possible_moves.end(), index) != possible_moves.end()) {
-                    board_str += 'x';
-                }
-                else {
-                    board_str += '.';
-                }
-            }
-            else {
-                board_str += (position_map[index]->getColor() == WHITE) ? std::tolower(position_map[index]->getSymbol()) : position_map[index]->getSymbol();
-            }
+    // empty squares the piece can move to are marked with 'x'
+    TextCells cells = textCells();
+    for (int index{0}; index < board_width * board_height; ++index) {
+        if (cells[index] == '.' && it->second->canMove(index)) {
+            cells[index] = 'x';
         }
-        board_str += '\n';
     }
-    return board_str;
+    return writeBoardText(cells, out, false);
 }
 
-
-
 bool Board::isPawnAttacking(int position_index, int target, Color c) {
     auto [row, col] = Board::getPosition(position_index);
     auto [target_row, target_col] = Board::getPosition(target);
@@ -187,6 +381,34 @@ bool Board::isPawnAttacking(int position_index, int target, Color c) {
 }
 
 
+char Piece::getSymbol() const {
+    return '?';
+}
+
+char Pawn::getSymbol() const {
+    return symbol;
+}
+
+char Rook::getSymbol() const {
+    return symbol;
+}
+
+char Knight::getSymbol() const {
+    return symbol;
+}
+
+char Bishop::getSymbol() const {
+    return symbol;
+}
+
+char Queen::getSymbol() const {
+    return symbol;
+}
+
+char King::getSymbol() const {
+    return symbol;
+}
+
 bool Pawn::amIAttacking(int index) const {
     return board.lock()->isPawnAttacking(Board::getPositionIndex(row, column), index, color);
 }
@@ -236,7 +458,7 @@ bool Knight::amIAttacking(int index) const {
 bool Board::isBishopAttacking(int position_index, int target) const {
     auto [row, col] = Board::getPosition(position_index);
     auto [target_row, target_col] = Board::getPosition(target);
-    if (std::abs(row - target_row) != std::abs(col - target_col)) {
+    if (std::abs(row - target_row) != std::abs(col - target_col) || position_index == target) {
         return false;
     }
     int row_step = (row < target_row) ? 1 : -1;
@@ -322,6 +544,10 @@ void Piece::setHasMoved(bool h) {
     this->hasMoved = h;
 }
 
+bool Piece::getHasMoved() const {
+    return hasMoved;
+}
+
 bool Piece::canMove(int index) const {
     bool occupied = this->board.lock()->isPositionOccupied(index);
     if (occupied && this->board.lock()->getPiece(index)->getColor() == this->color) {
@@ -332,78 +558,433 @@ bool Piece::canMove(int index) const {
 
 
 bool Board::checkIfChecked(Color c) {
+    STATS_INC(LEGALITY_CHECKS);
+    STATS_PHASE(LEGALITY);
+    TRACE_SCOPE("Board::checkIfChecked");
     auto king_position = (c == WHITE) ? whiteKingPosition : blackKingPosition;
-    for (auto& [index, piece] : position_map) {
-        if (!piece->isCaptured()  && piece->getColor() != c && piece->amIAttacking(Board::getPositionIndex(king_position.first, king_position.second))) {
-            return true;
-        }
-    }
-    return false;
+    return attacks.isSquareAttacked(getPositionIndex(king_position.first, king_position.second), (c == WHITE) ? BLACK : WHITE);
+}
+
+uint64_t Board::attackersOf(int square, Color c) const {
+    return attacks.attackersOf(square, c);
+}
+
+int Board::attackerCount(int square, Color c) const {
+    return attacks.attackerCount(square, c);
+}
+
+bool Board::isSquareAttacked(int square, Color by) const {
+    return attacks.isSquareAttacked(square, by);
+}
+
+uint64_t Board::attackedSquares(Color by) const {
+    return attacks.attackedSquares(by);
+}
+
+uint64_t Board::hangingPieces(Color c) const {
+    return attacks.hangingPieces(c);
+}
+
+int Board::staticExchange(Move m) const {
+    return attacks.staticExchange(m.from, m.to);
 }
 
-bool Board::isChecked(Color c) {
+uint64_t Board::kingEscapes(Color c) const {
+    return attacks.kingEscapes(c);
+}
+
+bool Board::isChecked(Color c) const {
     return (c == WHITE) ? whiteChecked : blackChecked;
 }
 
 void Board::move(int from, int to) {
-    if (!isPositionOccupied(from)) {
-        throw NoPieceAtPositionException(getNotation(from));
+    switch (tryMove({from, to})) {
+        case MoveStatus::OK:
+            return;
+        case MoveStatus::NO_PIECE:
+        case MoveStatus::OFF_BOARD:
+            throw NoPieceAtPositionException(getNotation(from));
+        case MoveStatus::NOT_YOUR_TURN:
+            throw NotYourTurnException(turn);
+        case MoveStatus::KING_IN_CHECK:
+            throw InvalidMoveException(getNotation(from) +"king checked when moving to" + getNotation(to));
+        default:
+            throw InvalidMoveException(getNotation(from) + getNotation(to));
+    }
+}
+
+MoveStatus Board::tryMove(Move m) {
+    STATS_INC(MOVES);
+    TRACE_SCOPE("Board::move");
+    if (m.from < 0 || m.from >= board_width * board_height || m.to < 0 || m.to >= board_width * board_height) {
+        return MoveStatus::OFF_BOARD;
     }
-    auto& piece = getPiece(from);
+    if (!isPositionOccupied(m.from)) {
+        return MoveStatus::NO_PIECE;
+    }
+    auto& piece = getPiece(m.from);
     if (piece->getColor() != turn) {
-        throw NotYourTurnException(turn);
+        return MoveStatus::NOT_YOUR_TURN;
     }
 
-    if(!piece->canMove(to)) {
-        throw InvalidMoveException(getNotation(from) + getNotation(to));
+    if(!piece->canMove(m.to)) {
+        return MoveStatus::INVALID_MOVE;
     }
 
-    if (isPositionOccupied(to)) {
-        auto& target = getPiece(to);
-        if (getPiece(to)->getColor() == piece->getColor()) {
-            throw InvalidMoveException(getNotation(from) + getNotation(to));
+    if (isPositionOccupied(m.to) && getPiece(m.to)->getColor() == piece->getColor()) {
+        return MoveStatus::INVALID_MOVE;
+    }
+
+    Color mover = turn;
+    MoveUndo undo;
+    makeMove(m, undo);
+    if (checkIfChecked(mover)) {
+        unmakeMove(undo);
+        return MoveStatus::KING_IN_CHECK;
+    }
+
+    if (mover == WHITE) {
+        whiteChecked = false;
+        blackChecked = checkIfChecked(BLACK);
+    } else {
+        blackChecked = false;
+        whiteChecked = checkIfChecked(WHITE);
+    }
+    publishSnapshot();
+    return MoveStatus::OK;
+}
+
+uint64_t Board::pinnedPieces(Color c) const {
+    auto [king_row, king_col] = (c == WHITE) ? whiteKingPosition : blackKingPosition;
+    uint64_t pinned{0};
+    for (auto& [index, piece] : position_map) {
+        PieceType type = piece->getType();
+        if (piece->getColor() == c || (type != ROOK && type != BISHOP && type != QUEEN)) {
+            continue;
         }
-        target->setCaptured(true);
-        auto [row, col] = getPosition(to);
-        piece->setRow(row);
-        piece->setColumn(col);
-        if (checkIfChecked(turn)) {
-            target->setCaptured(false);
-            piece->setRow(getPosition(from).first);
-            piece->setColumn(getPosition(from).second);
-            throw InvalidMoveException(getNotation(from) +"king checked when moving to" + getNotation(to));
+        auto [row, col] = getPosition(index);
+        int dr = row - king_row;
+        int dc = col - king_col;
+        bool straight = dr == 0 || dc == 0;
+        bool diagonal = dr == dc || dr == -dc;
+        if ((!straight && !diagonal) || (straight && type == BISHOP) || (diagonal && type == ROOK)) {
+            continue;
         }
-        position_map.erase(to);
-        position_map[to] = std::move(piece);
-        position_map.erase(from);
-    } else {
-        auto [row, col] = getPosition(to);
-        piece->setRow(row);
-        piece->setColumn(col);
-        if (checkIfChecked(turn)) {
-            piece->setRow(getPosition(from).first);
-            piece->setColumn(getPosition(from).second);
-            throw InvalidMoveException(getNotation(from) +"king checked when moving to" + getNotation(to));
+        int step_r = (dr > 0) - (dr < 0);
+        int step_c = (dc > 0) - (dc < 0);
+        int blockers{0};
+        int blocker{-1};
+        for (int r{king_row + step_r}, cc{king_col + step_c}; r != row || cc != col; r += step_r, cc += step_c) {
+            auto it = position_map.find(getPositionIndex(r, cc));
+            if (it != position_map.end()) {
+                ++blockers;
+                blocker = it->first;
+                if (blockers > 1 || it->second->getColor() != c) {
+                    break;
+                }
+            }
+        }
+        if (blockers == 1 && position_map.at(blocker)->getColor() == c) {
+            pinned |= uint64_t{1} << blocker;
         }
-        position_map[to] = std::move(piece);
-        position_map.erase(from);
     }
-    position_map[to]->setHasMoved(true);
-    turn = (turn == WHITE) ? BLACK : WHITE;
+    return pinned;
+}
+
+void Board::validateMoves(std::span<const Move> moves, std::span<MoveStatus> statuses) {
+    if (statuses.size() != moves.size()) {
+        throw invalid_argument("validateMoves needs one status per move");
+    }
+    // Without check, a pseudo-legal move of a piece other than the king that
+    // is not pinned is legal, so only the rest is made and unmade.
+    bool prepared{false};
+    bool in_check{false};
+    uint64_t pinned{0};
+    for (size_t i{0}; i < moves.size(); ++i) {
+        Move m = moves[i];
+        if (m.from < 0 || m.from >= board_width * board_height || m.to < 0 || m.to >= board_width * board_height) {
+            statuses[i] = MoveStatus::OFF_BOARD;
+            continue;
+        }
+        auto it = position_map.find(m.from);
+        if (it == position_map.end()) {
+            statuses[i] = MoveStatus::NO_PIECE;
+            continue;
+        }
+        if (it->second->getColor() != turn) {
+            statuses[i] = MoveStatus::NOT_YOUR_TURN;
+            continue;
+        }
+        if (!isPseudoLegal(m.from, m.to)) {
+            statuses[i] = MoveStatus::INVALID_MOVE;
+            continue;
+        }
+        if (!prepared) {
+            in_check = checkIfChecked(turn);
+            pinned = pinnedPieces(turn);
+            prepared = true;
+        }
+        if (!in_check && it->second->getType() != KING && !(pinned & (uint64_t{1} << m.from))) {
+            statuses[i] = MoveStatus::OK;
+            continue;
+        }
+        Color mover = turn;
+        MoveUndo undo;
+        makeMove(m, undo);
+        statuses[i] = checkIfChecked(mover) ? MoveStatus::KING_IN_CHECK : MoveStatus::OK;
+        unmakeMove(undo);
+    }
+}
 
-    if (checkIfChecked(turn)) {
-        if (turn == WHITE) {
-            whiteChecked = true;
-        } else {
-            blackChecked = true;
+void Board::makeMove(Move m, MoveUndo& undo) {
+    auto& piece = position_map.find(m.from)->second;
+    Color color = piece->getColor();
+    PieceType type = piece->getType();
+    undo.move = m;
+    undo.movedBefore = piece->getHasMoved();
+    undo.whiteChecked = whiteChecked;
+    undo.blackChecked = blackChecked;
+    undo.pawnKey = pawnKey;
+    undo.positionKey = positionKey;
+
+    auto target = position_map.find(m.to);
+    if (target != position_map.end()) {
+        PieceType captured_type = target->second->getType();
+        positionKey ^= zobrist::pieceKey(target->second->getColor(), captured_type, m.to);
+        if (captured_type == PAWN) {
+            pawnKey ^= zobrist::pieceKey(target->second->getColor(), PAWN, m.to);
         }
+        target->second->setCaptured(true);
+        undo.captured = position_map.extract(target);
+    }
+    attacks.remove(m.from);
+    if (undo.captured) {
+        attacks.replace(m.to, color, type);
     } else {
-        if (turn == WHITE) {
-            whiteChecked = false;
-        } else {
-            blackChecked = false;
+        attacks.add(m.to, color, type);
+    }
+
+    uint64_t moved = zobrist::pieceKey(color, type, m.from) ^ zobrist::pieceKey(color, type, m.to);
+    positionKey ^= moved ^ zobrist::sideKey();
+    if (type == PAWN) {
+        pawnKey ^= moved;
+    }
+    auto [row, col] = getPosition(m.to);
+    piece->setRow(row);
+    piece->setColumn(col);
+    piece->setHasMoved(true);
+    if (type == KING) {
+        ((color == WHITE) ? whiteKingPosition : blackKingPosition) = {row, col};
+    }
+    auto node = position_map.extract(m.from);
+    node.key() = m.to;
+    position_map.insert(std::move(node));
+    turn = (turn == WHITE) ? BLACK : WHITE;
+    history.push(positionKey, undo.captured || type == PAWN);
+}
+
+void Board::unmakeMove(MoveUndo& undo) {
+    Move m = undo.move;
+    auto& piece = position_map.find(m.to)->second;
+    auto [row, col] = getPosition(m.from);
+    piece->setRow(row);
+    piece->setColumn(col);
+    piece->setHasMoved(undo.movedBefore);
+    if (piece->getType() == KING) {
+        ((piece->getColor() == WHITE) ? whiteKingPosition : blackKingPosition) = {row, col};
+    }
+    if (undo.captured) {
+        attacks.replace(m.to, undo.captured.mapped()->getColor(), undo.captured.mapped()->getType());
+    } else {
+        attacks.remove(m.to);
+    }
+    attacks.add(m.from, piece->getColor(), piece->getType());
+    auto node = position_map.extract(m.to);
+    node.key() = m.from;
+    position_map.insert(std::move(node));
+    if (undo.captured) {
+        undo.captured.mapped()->setCaptured(false);
+        position_map.insert(std::move(undo.captured));
+    }
+    whiteChecked = undo.whiteChecked;
+    blackChecked = undo.blackChecked;
+    pawnKey = undo.pawnKey;
+    positionKey = undo.positionKey;
+    history.pop();
+    turn = (turn == WHITE) ? BLACK : WHITE;
+}
+
+bool Board::isPseudoLegal(int from, int to) {
+    auto it = position_map.find(from);
+    if (it == position_map.end() || it->second->getColor() != turn) {
+        return false;
+    }
+    auto target = position_map.find(to);
+    if (target != position_map.end() && target->second->getColor() == turn) {
+        return false;
+    }
+    return it->second->canMove(to);
+}
+
+void Board::generateLegalMoves(vector<Move>& out, bool captures_only) {
+    size_t first = out.size();
+    {
+        STATS_INC(MOVE_GENERATIONS);
+        STATS_PHASE(MOVE_GENERATION);
+        TRACE_SCOPE("Board::generateLegalMoves");
+        for (auto& [from, piece] : position_map) {
+            if (piece->getColor() != turn) {
+                continue;
+            }
+            for (int to{0}; to < board_width * board_height; ++to) {
+                if (captures_only && !isPositionOccupied(to)) {
+                    continue;
+                }
+                if (to != from && isPseudoLegal(from, to)) {
+                    out.push_back({from, to});
+                }
+            }
+        }
+    }
+    Color mover = turn;
+    MoveUndo undo;
+    size_t kept = first;
+    for (size_t i{first}; i < out.size(); ++i) {
+        makeMove(out[i], undo);
+        bool legal = !checkIfChecked(mover);
+        unmakeMove(undo);
+        if (legal) {
+            out[kept++] = out[i];
+        }
+    }
+    out.resize(kept);
+}
+
+void Board::generateEvasions(vector<Move>& out) {
+    auto [king_row, king_col] = (turn == WHITE) ? whiteKingPosition : blackKingPosition;
+    int king_index = getPositionIndex(king_row, king_col);
+    uint64_t targets{0}; // squares where a piece other than the king stops every check
+    int checkers{0};
+    for (auto& [index, piece] : position_map) {
+        if (piece->getColor() == turn || !piece->amIAttacking(king_index)) {
+            continue;
+        }
+        ++checkers;
+        targets |= uint64_t{1} << index;
+        PieceType type = piece->getType();
+        if (type == ROOK || type == BISHOP || type == QUEEN) {
+            auto [row, col] = getPosition(index);
+            int step_r = (row > king_row) - (row < king_row);
+            int step_c = (col > king_col) - (col < king_col);
+            for (int r{king_row + step_r}, c{king_col + step_c}; r != row || c != col; r += step_r, c += step_c) {
+                targets |= uint64_t{1} << getPositionIndex(r, c);
+            }
+        }
+    }
+    if (checkers == 0) {
+        generateLegalMoves(out);
+        return;
+    }
+    if (checkers > 1) {
+        targets = 0; // only the king can answer a double check
+    }
+
+    size_t first = out.size();
+    {
+        STATS_INC(MOVE_GENERATIONS);
+        STATS_PHASE(MOVE_GENERATION);
+        TRACE_SCOPE("Board::generateEvasions");
+        for (int dr{-1}; dr <= 1; ++dr) {
+            for (int dc{-1}; dc <= 1; ++dc) {
+                int r = king_row + dr;
+                int c = king_col + dc;
+                if ((dr != 0 || dc != 0) && r >= 0 && r < board_height && c >= 0 && c < board_width &&
+                    isPseudoLegal(king_index, getPositionIndex(r, c))) {
+                    out.push_back({king_index, getPositionIndex(r, c)});
+                }
+            }
+        }
+        for (auto& [from, piece] : position_map) {
+            if (piece->getColor() != turn || from == king_index) {
+                continue;
+            }
+            for (uint64_t rest{targets}; rest != 0; rest &= rest - 1) {
+                int to = std::countr_zero(rest);
+                if (isPseudoLegal(from, to)) {
+                    out.push_back({from, to});
+                }
+            }
         }
     }
+    Color mover = turn;
+    MoveUndo undo;
+    size_t kept = first;
+    for (size_t i{first}; i < out.size(); ++i) {
+        makeMove(out[i], undo);
+        bool legal = !checkIfChecked(mover);
+        unmakeMove(undo);
+        if (legal) {
+            out[kept++] = out[i];
+        }
+    }
+    out.resize(kept);
+}
+
+bool Board::isLegalMove(Move m) {
+    if (m.from < 0 || m.from >= board_width * board_height || m.to < 0 || m.to >= board_width * board_height || !isPseudoLegal(m.from, m.to)) {
+        return false;
+    }
+    Color mover = turn;
+    MoveUndo undo;
+    makeMove(m, undo);
+    bool legal = !checkIfChecked(mover);
+    unmakeMove(undo);
+    return legal;
+}
+
+string Board::moveToString(Move m) {
+    string s = getNotation(m.from) + getNotation(m.to);
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+    return s;
+}
+
+Move Board::moveFromString(string_view s) {
+    auto m = parseMove(s);
+    if (!m) {
+        throw invalid_argument("Invalid move: " + string(s));
+    }
+    return *m;
+}
+
+std::optional<Move> Board::parseMove(string_view s) {
+    // squares are one letter followed by the row number
+    auto square = [](string_view notation) -> int {
+        if (notation.size() < 2) {
+            return -1;
+        }
+        int column = std::tolower(static_cast<unsigned char>(notation[0])) - 'a';
+        int row{0};
+        for (char c : notation.substr(1)) {
+            if (!std::isdigit(static_cast<unsigned char>(c)) || row > board_height) {
+                return -1;
+            }
+            row = row * 10 + (c - '0');
+        }
+        if (column < 0 || column >= board_width || row < 1 || row > board_height) {
+            return -1;
+        }
+        return getPositionIndex(row - 1, column);
+    };
+    size_t split{1};
+    while (split < s.size() && std::isdigit(static_cast<unsigned char>(s[split]))) {
+        ++split;
+    }
+    int from = square(s.substr(0, split));
+    int to = (split < s.size()) ? square(s.substr(split)) : -1;
+    if (from < 0 || to < 0) {
+        return std::nullopt;
+    }
+    return Move{from, to};
 }
 
 int Board::numberOfPieces() const {
@@ -411,6 +992,9 @@ int Board::numberOfPieces() const {
 }
 
 vector<int> Piece::getPossibleMoves(int index) {
+    STATS_INC(MOVE_GENERATIONS);
+    STATS_PHASE(MOVE_GENERATION);
+    TRACE_SCOPE("Piece::getPossibleMoves");
     vector<int> moves;
     auto x = this->board.lock()->getPosition(index);
     for (int i{ 0 }; i < board_height * board_width; ++i) {
@@ -421,14 +1005,62 @@ vector<int> Piece::getPossibleMoves(int index) {
     return moves;
 }
 
-vector<int, char> Board::indexToPieceMap() const {
-    vector<int, char> map;
+vector<pair<int, char>> Board::indexToPieceMap() const {
+    vector<pair<int, char>> map;
     for (auto& [index, piece] : position_map) {
         map.push_back({index, piece->getSymbol()});
     }
     return map;
 }
 
+void Board::publishSnapshot() {
+    BoardSnapshot snapshot;
+    for (auto& [index, piece] : position_map) {
+        char symbol = piece->getSymbol();
+        snapshot.squares[index] = (piece->getColor() == WHITE) ? symbol : static_cast<char>(std::tolower(symbol));
+    }
+    snapshot.blackToMove = turn == BLACK;
+    snapshot.whiteChecked = whiteChecked;
+    snapshot.blackChecked = blackChecked;
+    publisher.publish(snapshot);
+}
+
+const SnapshotPublisher& Board::snapshots() const {
+    return publisher;
+}
+
 Color Board::getTurn() const {
     return turn;
-}
\ No newline at end of file
+}
+
+const std::unordered_map<int, std::unique_ptr<Piece>>& Board::getPositionMap() const {
+    return position_map;
+}
+
+uint64_t Board::getPawnKey() const {
+    return pawnKey;
+}
+
+uint64_t Board::getPositionKey() const {
+    return positionKey;
+}
+
+bool Board::isRepetition() const {
+    return history.repetitions() >= 1;
+}
+
+bool Board::isThreefoldRepetition() const {
+    return history.repetitions() >= 2;
+}
+
+bool Board::isFiftyMoveDraw() const {
+    return history.halfmoveClock() >= 100;
+}
+
+int Board::getHalfmoveClock() const {
+    return history.halfmoveClock();
+}
+
+void Board::setHistory(RepetitionHistory replacement) {
+    history = std::move(replacement);
+}
@@ -1,7 +1,15 @@
 // board.h
 #ifndef UNTITLED24_BOARD_H
 #define UNTITLED24_BOARD_H
+#include "attack_map.h"
+#include "board_snapshot.h"
+#include "repetition_history.h"
+#include "text_renderer.h"
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -96,6 +104,7 @@ public:
     Rook(int row, int column, Color color) : Piece(row, column, color) {
         type = ROOK;
     }
+    [[nodiscard]] char getSymbol() const override;
     [[nodiscard]] bool amIAttacking(int index) const override;
 };
 
@@ -106,6 +115,7 @@ public:
     Knight(int row, int column, Color color) : Piece(row, column, color) {
         type = KNIGHT;
     }
+    [[nodiscard]] char getSymbol() const override;
     [[nodiscard]] bool amIAttacking(int index) const override;
 };
 
@@ -116,6 +126,7 @@ public:
     Bishop(int row, int column, Color color) : Piece(row, column, color) {
         type = BISHOP;
     }
+    [[nodiscard]] char getSymbol() const override;
     [[nodiscard]] bool amIAttacking(int index) const override;
 };
 
@@ -126,6 +137,7 @@ public:
     Queen(int row, int column, Color color) : Piece(row, column, color) {
         type = QUEEN;
     }
+    [[nodiscard]] char getSymbol() const override;
     [[nodiscard]] bool amIAttacking(int index) const override;
 };
 
@@ -136,9 +148,50 @@ public:
     King(int row, int column, Color color) : Piece(row, column, color) {
         type = KING;
     }
+    [[nodiscard]] char getSymbol() const override;
     [[nodiscard]] bool amIAttacking(int index) const override;
 };
 
+struct Move {
+    int from{-1};
+    int to{-1};
+    bool operator==(const Move&) const = default;
+    [[nodiscard]] bool isNull() const { return from < 0; }
+};
+
+// Outcome of a move attempt, see Board::tryMove and Board::validateMoves.
+enum class MoveStatus : uint8_t {
+    OK,
+    OFF_BOARD,
+    NO_PIECE,
+    NOT_YOUR_TURN,
+    INVALID_MOVE, // the piece cannot move there
+    KING_IN_CHECK // the move would leave the mover's king attacked
+};
+
+// Everything makeMove changes that unmakeMove cannot recompute.
+struct MoveUndo {
+    Move move;
+    // the captured piece still in its map node, so neither making nor
+    // unmaking a move allocates
+    std::unordered_map<int, unique_ptr<Piece>>::node_type captured;
+    bool movedBefore{false};
+    bool whiteChecked{false};
+    bool blackChecked{false};
+    uint64_t pawnKey{0};
+    uint64_t positionKey{0};
+};
+
+// A position in 32 bytes: occupancy mask plus a 4-bit code (color << 3 | type)
+// for every occupied square, in square order. Used to store many games
+// compactly; load it into a Board to validate or generate moves.
+struct CompactBoard {
+    uint64_t occupancy{0};
+    std::array<uint8_t, 16> pieces{};
+    uint8_t flags{0}; // bit 0: black to move, bit 1: white checked, bit 2: black checked
+    bool operator==(const CompactBoard&) const = default;
+};
+
 class Board : public std::enable_shared_from_this<Board> {
 private:
     std::unordered_map<int, std::unique_ptr<Piece>> position_map;
@@ -149,8 +202,30 @@ private:
     bool blackChecked{false};
     pair<int, int> whiteKingPosition;
     pair<int, int> blackKingPosition;
+    uint64_t pawnKey{0}; // zobrist key of pawns only, see evaluation.h
+    uint64_t positionKey{0}; // zobrist key of all pieces and the side to move
+    void attachPieces();
+    // Empties the position map but keeps a bucket per square, so iterating it
+    // (and so the move order) depends only on the position being set up, not
+    // on the positions the board held before.
+    void clearPieces();
+    void placePiece(PieceType type, Color color, int row, int col);
+    bool isPseudoLegal(int from, int to);
+    // Squares of c's pieces that shield c's king from a slider.
+    [[nodiscard]] uint64_t pinnedPieces(Color c) const;
+    SnapshotPublisher publisher;
+    void publishSnapshot();
+    RepetitionHistory history;
+    AttackMap attacks; // rebuilt by attachPieces, updated by makeMove and unmakeMove
 public:
     void init();
+    // Sets up the position described by the piece placement, side to move and
+    // halfmove clock fields of a FEN string. Castling and en passant are ignored.
+    void initFromFen(string_view fen);
+    [[nodiscard]] string toFen() const;
+    void initFromCompact(const CompactBoard& compact);
+    [[nodiscard]] CompactBoard toCompact() const;
+    static PieceType pieceTypeFromSymbol(char symbol);
     static int getPositionIndex(int row, int column);
     static pair<int, int> getPosition(int index);
     bool isPositionOccupied(int index) const;
@@ -159,6 +234,12 @@ public:
     unique_ptr<Piece>& getPiece(int index);
     string boardString();
 	string boardStringWithPossibleMoves(int from);
+    // boardString's cells: white pieces lowercase, black uppercase, '.' empty.
+    [[nodiscard]] TextCells textCells() const;
+    // The same texts written into out without allocating; return their
+    // length. out needs board_text_size characters (see writeBoardText).
+    size_t writeBoardString(std::span<char> out) const;
+    size_t writeBoardStringWithPossibleMoves(int from, std::span<char> out) const;
 
     static bool isPawnAttacking(int position_index, int target, Color c);
     bool isRookAttacking(int position_index, int target) const;
@@ -167,11 +248,61 @@ public:
     bool isQueenAttacking(int position_index, int target);
     static bool isKingAttacking(int position_index, int target);
     bool checkIfChecked(Color c); // actually checks
+    // Attack queries answered from the incrementally updated attack map,
+    // without scanning the pieces. Squares are returned as bit masks.
+    [[nodiscard]] uint64_t attackersOf(int square, Color c) const;
+    [[nodiscard]] int attackerCount(int square, Color c) const;
+    [[nodiscard]] bool isSquareAttacked(int square, Color by) const;
+    [[nodiscard]] uint64_t attackedSquares(Color by) const;
+    // c's pieces other than the king that are attacked and either undefended
+    // or attacked by a cheaper piece.
+    [[nodiscard]] uint64_t hangingPieces(Color c) const;
+    // Static exchange evaluation of m in pawns, see AttackMap::staticExchange.
+    [[nodiscard]] int staticExchange(Move m) const;
+    // Squares c's king could step to without being attacked.
+    [[nodiscard]] uint64_t kingEscapes(Color c) const;
     bool isChecked(Color c) const; //  only getter
     void move(int from, int to);
+    // Same as move, but reports an illegal move through the status instead of
+    // throwing. The board is only changed when MoveStatus::OK is returned.
+    MoveStatus tryMove(Move m);
+    // Checks every candidate against the current position, statuses[i] for
+    // moves[i]. Whether the side to move is in check and which of its pieces
+    // are pinned is worked out once, at the first pseudo-legal candidate;
+    // only king moves, pinned pieces and moves out of check are then made
+    // and unmade. Throws std::invalid_argument unless the spans are as long.
+    void validateMoves(std::span<const Move> moves, std::span<MoveStatus> statuses);
+
+    // Search primitives: makeMove applies a pseudo-legal move without any
+    // validation, unmakeMove takes back the last one. The check flags are not
+    // updated, use checkIfChecked.
+    void makeMove(Move m, MoveUndo& undo);
+    void unmakeMove(MoveUndo& undo);
+    // Appends every legal move of the side to move to out.
+    void generateLegalMoves(vector<Move>& out, bool captures_only = false);
+    // Same result as generateLegalMoves, but when the side to move is in check
+    // only king moves, captures of the checker and interpositions are tried.
+    void generateEvasions(vector<Move>& out);
+    bool isLegalMove(Move m);
+    static string moveToString(Move m);
+    static Move moveFromString(string_view s);
+    static std::optional<Move> parseMove(string_view s);
     int numberOfPieces() const;
     Color getTurn() const;
     vector<pair<int, char>> indexToPieceMap() const;
+    // Latest position published by init*() and move(), readable from any thread.
+    [[nodiscard]] const SnapshotPublisher& snapshots() const;
+    [[nodiscard]] const std::unordered_map<int, std::unique_ptr<Piece>>& getPositionMap() const;
+    [[nodiscard]] uint64_t getPawnKey() const;
+    [[nodiscard]] uint64_t getPositionKey() const;
+    // The position occurred before since the last capture or pawn move,
+    // counting the moves made by makeMove, so search can score it as a draw.
+    [[nodiscard]] bool isRepetition() const;
+    [[nodiscard]] bool isThreefoldRepetition() const;
+    [[nodiscard]] bool isFiftyMoveDraw() const;
+    [[nodiscard]] int getHalfmoveClock() const;
+    // Replaces the key history, e.g. after restoring a position of a recorded game.
+    void setHistory(RepetitionHistory replacement);
 
 };
 #endif //UNTITLED24_BOARD_H
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "board_batch.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+#include "board_batch_kernels.h"
+#if defined(BOARD_BATCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+    struct ScalarLanes {
+        using Vec = uint64_t;
+        static constexpr size_t width{1};
+
+        static Vec load(const uint64_t* p) { return *p; }
+        static void store(uint64_t* p, Vec v) { *p = v; }
+        static Vec broadcast(uint64_t bits) { return bits; }
+        static Vec bitAnd(Vec a, Vec b) { return a & b; }
+        static Vec bitOr(Vec a, Vec b) { return a | b; }
+        static Vec bitNot(Vec a) { return ~a; }
+        template <int n>
+        static Vec shiftLeft(Vec v) { return v << n; }
+        template <int n>
+        static Vec shiftRight(Vec v) { return v >> n; }
+    };
+
+    struct CpuFeatures {
+        bool avx2{false};
+        bool avx512{false};
+
+        CpuFeatures() {
+#if defined(BOARD_BATCH_X86) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return;
+            }
+            __cpuid(info, 1);
+            if ((info[2] & (1 << 27)) == 0) { // the OS saves the extended registers
+                return;
+            }
+            uint64_t saved = _xgetbv(0);
+            __cpuidex(info, 7, 0);
+            avx2 = (saved & 0x6) == 0x6 && (info[1] & (1 << 5)) != 0;
+            avx512 = (saved & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+#elif defined(BOARD_BATCH_X86) && defined(__GNUC__)
+            __builtin_cpu_init();
+            avx2 = __builtin_cpu_supports("avx2");
+            avx512 = __builtin_cpu_supports("avx512f");
+#endif
+        }
+    };
+
+    const CpuFeatures& cpuFeatures() {
+        static const CpuFeatures features;
+        return features;
+    }
+
+    BatchKernelFunction kernelFunction(BatchKernel kernel) {
+        switch (kernel) {
+#ifdef BOARD_BATCH_X86
+            case BatchKernel::AVX2:
+                return runBatchKernelAvx2;
+            case BatchKernel::AVX512:
+                return runBatchKernelAvx512;
+#endif
+            default:
+                return runBatchKernelScalar;
+        }
+    }
+
+    constexpr size_t chunk_size{256}; // positions converted at a time by inCheck
+}
+
+void runBatchKernelScalar(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out) {
+    batch::run<ScalarLanes>(planes, query, color, begin, end, out);
+}
+
+BoardBatch::BoardBatch() : kernel(bestKernel()) {
+}
+
+bool BoardBatch::isSupported(BatchKernel kernel) {
+    switch (kernel) {
+        case BatchKernel::SCALAR:
+            return true;
+        case BatchKernel::AVX2:
+            return cpuFeatures().avx2;
+        case BatchKernel::AVX512:
+            return cpuFeatures().avx512;
+    }
+    return false;
+}
+
+BatchKernel BoardBatch::bestKernel() {
+    if (isSupported(BatchKernel::AVX512)) {
+        return BatchKernel::AVX512;
+    }
+    return isSupported(BatchKernel::AVX2) ? BatchKernel::AVX2 : BatchKernel::SCALAR;
+}
+
+const char* BoardBatch::kernelName(BatchKernel kernel) {
+    switch (kernel) {
+        case BatchKernel::SCALAR:
+            return "scalar";
+        case BatchKernel::AVX2:
+            return "avx2";
+        case BatchKernel::AVX512:
+            return "avx512";
+    }
+    return "?";
+}
+
+void BoardBatch::setKernel(BatchKernel kernel) {
+    if (!isSupported(kernel)) {
+        throw std::invalid_argument(string("This CPU cannot run the ") + kernelName(kernel) + " batch kernels");
+    }
+    this->kernel = kernel;
+}
+
+BatchKernel BoardBatch::getKernel() const {
+    return kernel;
+}
+
+void BoardBatch::resizePlanes(size_t positions) {
+    // whole vectors of the widest kernel, the padding holds empty boards
+    size_t padded = (positions + padding - 1) / padding * padding;
+    for (auto& plane : types) {
+        plane.resize(padded);
+    }
+    for (auto& plane : colors) {
+        plane.resize(padded);
+    }
+}
+
+void BoardBatch::clear() {
+    count = 0;
+    turns.clear();
+    resizePlanes(0);
+}
+
+void BoardBatch::reserve(size_t positions) {
+    size_t padded = (positions + padding - 1) / padding * padding;
+    for (auto& plane : types) {
+        plane.reserve(padded);
+    }
+    for (auto& plane : colors) {
+        plane.reserve(padded);
+    }
+    turns.reserve(positions);
+}
+
+void BoardBatch::add(const CompactBoard& position) {
+    resizePlanes(count + 1);
+    int n{0};
+    for (uint64_t squares = position.occupancy; squares != 0; squares &= squares - 1, ++n) {
+        uint64_t bit = uint64_t{1} << std::countr_zero(squares);
+        uint8_t code = (position.pieces[n / 2] >> ((n % 2) * 4)) & 0xF;
+        types[code & 7][count] |= bit;
+        colors[code >> 3][count] |= bit;
+    }
+    turns.push_back(static_cast<uint8_t>((position.flags & 1) ? BLACK : WHITE));
+    ++count;
+}
+
+void BoardBatch::add(const Board& board) {
+    add(board.toCompact());
+}
+
+size_t BoardBatch::size() const {
+    return count;
+}
+
+Color BoardBatch::getTurn(size_t i) const {
+    return static_cast<Color>(turns[i]);
+}
+
+void BoardBatch::run(BatchQuery query, Color c, size_t begin, size_t end, uint64_t* out) const {
+    BatchPlanes planes{{types[0].data(), types[1].data(), types[2].data(), types[3].data(), types[4].data(), types[5].data()},
+                       {colors[0].data(), colors[1].data()}};
+    kernelFunction(kernel)(planes, query, static_cast<int>(c), begin, end, out);
+}
+
+void BoardBatch::occupancy(std::span<uint64_t> out) const {
+    assert(out.size() >= count);
+    run(BatchQuery::OCCUPANCY, WHITE, 0, count, out.data());
+}
+
+void BoardBatch::attackedSquares(Color by, std::span<uint64_t> out) const {
+    assert(out.size() >= count);
+    run(BatchQuery::ATTACKED_SQUARES, by, 0, count, out.data());
+}
+
+void BoardBatch::checkers(Color c, std::span<uint64_t> out) const {
+    assert(out.size() >= count);
+    run(BatchQuery::CHECKERS, c, 0, count, out.data());
+}
+
+void BoardBatch::inCheck(Color c, std::span<bool> out) const {
+    assert(out.size() >= count);
+    std::array<uint64_t, chunk_size> found;
+    for (size_t begin{0}; begin < count; begin += chunk_size) {
+        size_t end = std::min(count, begin + chunk_size);
+        run(BatchQuery::CHECKERS, c, begin, end, found.data());
+        for (size_t i{begin}; i < end; ++i) {
+            out[i] = found[i - begin] != 0;
+        }
+    }
+}
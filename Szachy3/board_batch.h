@@ -0,0 +1,68 @@
+#ifndef BOARD_BATCH_H
+#define BOARD_BATCH_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "board.h"
+
+enum class BatchQuery;
+
+// Instruction sets the batch kernels are built for. The widest one the CPU
+// supports is picked at run time; SCALAR runs everywhere.
+enum class BatchKernel {
+    SCALAR,
+    AVX2, // 4 positions per instruction
+    AVX512 // 8 positions per instruction, AVX-512F
+};
+
+// Many positions in structure-of-arrays form: one bitboard per piece type
+// and per color, each an array over the positions, so a kernel loads the
+// same plane of several positions into one vector register. Attacks are
+// computed from scratch with shift-based ray fills, the same squares
+// AttackMap keeps incrementally: a slider's ray includes its first blocker
+// of either color, and squares of the attacker's own pieces count.
+//
+// Every position needs at most one king per side, as Board does; a side
+// without a king is never in check.
+class BoardBatch {
+private:
+    static constexpr size_t padding{8}; // the widest kernel's positions per vector
+    std::array<vector<uint64_t>, 6> types; // indexed by PieceType
+    std::array<vector<uint64_t>, 2> colors; // indexed by Color
+    vector<uint8_t> turns; // Color to move
+    size_t count{0};
+    BatchKernel kernel;
+
+    void resizePlanes(size_t positions);
+    // The kernel's results for the positions begin..end, begin a multiple of padding.
+    void run(BatchQuery query, Color c, size_t begin, size_t end, uint64_t* out) const;
+public:
+    BoardBatch();
+
+    [[nodiscard]] static bool isSupported(BatchKernel kernel);
+    [[nodiscard]] static BatchKernel bestKernel();
+    [[nodiscard]] static const char* kernelName(BatchKernel kernel);
+    // Throws std::invalid_argument when this CPU cannot run the kernel.
+    void setKernel(BatchKernel kernel);
+    [[nodiscard]] BatchKernel getKernel() const;
+
+    void clear();
+    void reserve(size_t positions);
+    void add(const CompactBoard& position);
+    void add(const Board& board);
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] Color getTurn(size_t i) const;
+
+    // Each out[i] describes position i; out must hold size() entries.
+    void occupancy(std::span<uint64_t> out) const;
+    // Squares attacked by color by, see AttackMap::attackedSquares.
+    void attackedSquares(Color by, std::span<uint64_t> out) const;
+    // Squares of the pieces giving check to color c's king.
+    void checkers(Color c, std::span<uint64_t> out) const;
+    // The same verdict as Board::checkIfChecked(c).
+    void inCheck(Color c, std::span<bool> out) const;
+};
+
+#endif // BOARD_BATCH_H
@@ -0,0 +1,48 @@
+// BoardBatch kernels for AVX2, four positions per 256-bit register. Only
+// called after BoardBatch::isSupported has checked the CPU, so this file is
+// compiled for AVX2 whatever the rest of the program targets.
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "board_batch_kernels.h"
+
+namespace {
+    struct Avx2Lanes {
+        using Vec = __m256i;
+        static constexpr size_t width{4};
+
+        static Vec load(const uint64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(uint64_t* p, Vec v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+        static Vec broadcast(uint64_t bits) { return _mm256_set1_epi64x(static_cast<long long>(bits)); }
+        static Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+        static Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+        static Vec bitNot(Vec a) { return _mm256_xor_si256(a, _mm256_set1_epi64x(-1)); }
+        template <int n>
+        static Vec shiftLeft(Vec v) { return _mm256_slli_epi64(v, n); }
+        template <int n>
+        static Vec shiftRight(Vec v) { return _mm256_srli_epi64(v, n); }
+    };
+}
+
+void runBatchKernelAvx2(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out) {
+    batch::run<Avx2Lanes>(planes, query, color, begin, end, out);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
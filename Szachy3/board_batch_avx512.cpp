@@ -0,0 +1,61 @@
+// BoardBatch kernels for AVX-512F, eight positions per 512-bit register. Only
+// called after BoardBatch::isSupported has checked the CPU, so this file is
+// compiled for AVX-512 whatever the rest of the program targets.
+//
+// GCC's shift intrinsics pass _mm512_undefined_epi32() as the unused merge
+// source, which -Wuninitialized reports wherever they are inlined; the
+// warnings point into avx512fintrin.h, so they are silenced from before it.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <immintrin.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+#include "board_batch_kernels.h"
+
+namespace {
+    struct Avx512Lanes {
+        using Vec = __m512i;
+        static constexpr size_t width{8};
+
+        static Vec load(const uint64_t* p) { return _mm512_loadu_si512(p); }
+        static void store(uint64_t* p, Vec v) { _mm512_storeu_si512(p, v); }
+        static Vec broadcast(uint64_t bits) { return _mm512_set1_epi64(static_cast<long long>(bits)); }
+        static Vec bitAnd(Vec a, Vec b) { return _mm512_and_si512(a, b); }
+        static Vec bitOr(Vec a, Vec b) { return _mm512_or_si512(a, b); }
+        static Vec bitNot(Vec a) { return _mm512_ternarylogic_epi64(a, a, a, 0x55); }
+        template <int n>
+        static Vec shiftLeft(Vec v) { return _mm512_slli_epi64(v, n); }
+        template <int n>
+        static Vec shiftRight(Vec v) { return _mm512_srli_epi64(v, n); }
+    };
+}
+
+void runBatchKernelAvx512(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out) {
+    batch::run<Avx512Lanes>(planes, query, color, begin, end, out);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
@@ -0,0 +1,191 @@
+#ifndef BOARD_BATCH_KERNELS_H
+#define BOARD_BATCH_KERNELS_H
+
+// Internal to BoardBatch: the kernels written once over a Lanes type, which
+// holds a vector of bitboards, one per position, and the handful of
+// operations on it the ray fills need. Each instruction set instantiates
+// them in its own translation unit, compiled for that target; everything
+// here has internal linkage so no copy built for a wider target can be
+// linked into the scalar path.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BOARD_BATCH_X86
+#endif
+
+struct BatchPlanes {
+    std::array<const uint64_t*, 6> types; // indexed by PieceType
+    std::array<const uint64_t*, 2> colors;
+};
+
+enum class BatchQuery {
+    OCCUPANCY,
+    ATTACKED_SQUARES, // by color
+    CHECKERS // of color's king
+};
+
+// Writes out[i - begin] for the positions begin..end. begin is a multiple of
+// 8 and the planes are readable up to end rounded up to one.
+using BatchKernelFunction = void (*)(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end,
+                                     uint64_t* out);
+
+void runBatchKernelScalar(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out);
+#ifdef BOARD_BATCH_X86
+void runBatchKernelAvx2(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out);
+void runBatchKernelAvx512(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out);
+#endif
+
+namespace {
+    namespace batch {
+        constexpr uint64_t all_squares{~uint64_t{0}};
+        constexpr uint64_t not_a{0xFEFEFEFEFEFEFEFEull}; // squares a step towards the h file can land on
+        constexpr uint64_t not_ab{0xFCFCFCFCFCFCFCFCull};
+        constexpr uint64_t not_h{0x7F7F7F7F7F7F7F7Full};
+        constexpr uint64_t not_gh{0x3F3F3F3F3F3F3F3Full};
+
+        // Moves every square by shift indices, up for a positive shift.
+        template <class Lanes, int shift>
+        typename Lanes::Vec shifted(typename Lanes::Vec v) {
+            if constexpr (shift > 0) {
+                return Lanes::template shiftLeft<shift>(v);
+            } else {
+                return Lanes::template shiftRight<-shift>(v);
+            }
+        }
+
+        // A single step from every square of from, dropping the steps that
+        // wrapped around the board's side.
+        template <class Lanes, int shift>
+        typename Lanes::Vec step(typename Lanes::Vec from, uint64_t edge) {
+            return Lanes::bitAnd(shifted<Lanes, shift>(from), Lanes::broadcast(edge));
+        }
+
+        // Kogge-Stone occluded fill: the rays from every square of from in
+        // one direction, each up to and including its first occupied square.
+        template <class Lanes, int shift>
+        typename Lanes::Vec slide(typename Lanes::Vec from, typename Lanes::Vec empty, uint64_t edge) {
+            using Vec = typename Lanes::Vec;
+            Vec mask = Lanes::broadcast(edge);
+            Vec open = Lanes::bitAnd(empty, mask);
+            Vec reached = from;
+            reached = Lanes::bitOr(reached, Lanes::bitAnd(open, shifted<Lanes, shift>(reached)));
+            open = Lanes::bitAnd(open, shifted<Lanes, shift>(open));
+            reached = Lanes::bitOr(reached, Lanes::bitAnd(open, shifted<Lanes, 2 * shift>(reached)));
+            open = Lanes::bitAnd(open, shifted<Lanes, 2 * shift>(open));
+            reached = Lanes::bitOr(reached, Lanes::bitAnd(open, shifted<Lanes, 4 * shift>(reached)));
+            return Lanes::bitAnd(shifted<Lanes, shift>(reached), mask);
+        }
+
+        template <class Lanes>
+        typename Lanes::Vec orthogonalRays(typename Lanes::Vec from, typename Lanes::Vec empty) {
+            return Lanes::bitOr(Lanes::bitOr(slide<Lanes, 8>(from, empty, all_squares), slide<Lanes, -8>(from, empty, all_squares)),
+                                Lanes::bitOr(slide<Lanes, 1>(from, empty, not_a), slide<Lanes, -1>(from, empty, not_h)));
+        }
+
+        template <class Lanes>
+        typename Lanes::Vec diagonalRays(typename Lanes::Vec from, typename Lanes::Vec empty) {
+            return Lanes::bitOr(Lanes::bitOr(slide<Lanes, 9>(from, empty, not_a), slide<Lanes, 7>(from, empty, not_h)),
+                                Lanes::bitOr(slide<Lanes, -7>(from, empty, not_a), slide<Lanes, -9>(from, empty, not_h)));
+        }
+
+        template <class Lanes>
+        typename Lanes::Vec knightSteps(typename Lanes::Vec from) {
+            return Lanes::bitOr(
+                    Lanes::bitOr(Lanes::bitOr(step<Lanes, 17>(from, not_a), step<Lanes, 15>(from, not_h)),
+                                 Lanes::bitOr(step<Lanes, 10>(from, not_ab), step<Lanes, 6>(from, not_gh))),
+                    Lanes::bitOr(Lanes::bitOr(step<Lanes, -6>(from, not_ab), step<Lanes, -10>(from, not_gh)),
+                                 Lanes::bitOr(step<Lanes, -15>(from, not_a), step<Lanes, -17>(from, not_h))));
+        }
+
+        template <class Lanes>
+        typename Lanes::Vec kingSteps(typename Lanes::Vec from) {
+            return Lanes::bitOr(
+                    Lanes::bitOr(Lanes::bitOr(step<Lanes, 8>(from, all_squares), step<Lanes, -8>(from, all_squares)),
+                                 Lanes::bitOr(step<Lanes, 1>(from, not_a), step<Lanes, -1>(from, not_h))),
+                    Lanes::bitOr(Lanes::bitOr(step<Lanes, 9>(from, not_a), step<Lanes, 7>(from, not_h)),
+                                 Lanes::bitOr(step<Lanes, -7>(from, not_a), step<Lanes, -9>(from, not_h))));
+        }
+
+        // Squares attacked by color's pawns on from.
+        template <class Lanes>
+        typename Lanes::Vec pawnCaptures(typename Lanes::Vec from, int color) {
+            if (color == 0) {
+                return Lanes::bitOr(step<Lanes, 7>(from, not_h), step<Lanes, 9>(from, not_a));
+            }
+            return Lanes::bitOr(step<Lanes, -9>(from, not_h), step<Lanes, -7>(from, not_a));
+        }
+
+        template <class Lanes, BatchQuery query>
+        typename Lanes::Vec evaluate(const BatchPlanes& planes, int color, size_t i) {
+            using Vec = typename Lanes::Vec;
+            Vec own = Lanes::load(planes.colors[color] + i);
+            Vec other = Lanes::load(planes.colors[1 - color] + i);
+            Vec occupied = Lanes::bitOr(own, other);
+            if constexpr (query == BatchQuery::OCCUPANCY) {
+                return occupied;
+            } else {
+                Vec empty = Lanes::bitNot(occupied);
+                Vec pawns = Lanes::load(planes.types[0] + i);
+                Vec rooks = Lanes::load(planes.types[1] + i);
+                Vec knights = Lanes::load(planes.types[2] + i);
+                Vec bishops = Lanes::load(planes.types[3] + i);
+                Vec queens = Lanes::load(planes.types[4] + i);
+                Vec kings = Lanes::load(planes.types[5] + i);
+                Vec orthogonal = Lanes::bitOr(rooks, queens);
+                Vec diagonal = Lanes::bitOr(bishops, queens);
+                if constexpr (query == BatchQuery::ATTACKED_SQUARES) {
+                    Vec attacks = Lanes::bitOr(pawnCaptures<Lanes>(Lanes::bitAnd(pawns, own), color),
+                                               Lanes::bitOr(knightSteps<Lanes>(Lanes::bitAnd(knights, own)),
+                                                            kingSteps<Lanes>(Lanes::bitAnd(kings, own))));
+                    attacks = Lanes::bitOr(attacks, orthogonalRays<Lanes>(Lanes::bitAnd(orthogonal, own), empty));
+                    return Lanes::bitOr(attacks, diagonalRays<Lanes>(Lanes::bitAnd(diagonal, own), empty));
+                } else {
+                    // everything a piece on the king's square would attack, met by the enemy piece of that kind
+                    Vec king = Lanes::bitAnd(kings, own);
+                    Vec found = Lanes::bitOr(Lanes::bitAnd(pawnCaptures<Lanes>(king, color), pawns),
+                                             Lanes::bitAnd(knightSteps<Lanes>(king), knights));
+                    found = Lanes::bitOr(found, Lanes::bitAnd(kingSteps<Lanes>(king), kings));
+                    found = Lanes::bitOr(found, Lanes::bitAnd(orthogonalRays<Lanes>(king, empty), orthogonal));
+                    found = Lanes::bitOr(found, Lanes::bitAnd(diagonalRays<Lanes>(king, empty), diagonal));
+                    return Lanes::bitAnd(found, other);
+                }
+            }
+        }
+
+        template <class Lanes, BatchQuery query>
+        void runQuery(const BatchPlanes& planes, int color, size_t begin, size_t end, uint64_t* out) {
+            size_t i{begin};
+            for (; i + Lanes::width <= end; i += Lanes::width) {
+                Lanes::store(out + (i - begin), evaluate<Lanes, query>(planes, color, i));
+            }
+            if (i < end) {
+                // the planes are padded, only the results past end are dropped
+                alignas(64) std::array<uint64_t, Lanes::width> last;
+                Lanes::store(last.data(), evaluate<Lanes, query>(planes, color, i));
+                for (size_t j{0}; i + j < end; ++j) {
+                    out[i + j - begin] = last[j];
+                }
+            }
+        }
+
+        template <class Lanes>
+        void run(const BatchPlanes& planes, BatchQuery query, int color, size_t begin, size_t end, uint64_t* out) {
+            switch (query) {
+                case BatchQuery::OCCUPANCY:
+                    runQuery<Lanes, BatchQuery::OCCUPANCY>(planes, color, begin, end, out);
+                    break;
+                case BatchQuery::ATTACKED_SQUARES:
+                    runQuery<Lanes, BatchQuery::ATTACKED_SQUARES>(planes, color, begin, end, out);
+                    break;
+                case BatchQuery::CHECKERS:
+                    runQuery<Lanes, BatchQuery::CHECKERS>(planes, color, begin, end, out);
+                    break;
+            }
+        }
+    }
+}
+
+#endif // BOARD_BATCH_KERNELS_H
@@ -0,0 +1,59 @@
+#include "board_snapshot.h"
+#include <cstring>
+
+namespace {
+    constexpr uint64_t black_to_move_flag{1};
+    constexpr uint64_t white_checked_flag{2};
+    constexpr uint64_t black_checked_flag{4};
+}
+
+void SnapshotPublisher::publish(const BoardSnapshot& snapshot) {
+    uint64_t version = latest.load(std::memory_order_relaxed) + 1;
+    Slot& slot = slots[version % slot_count];
+    slot.sequence.store(2 * version - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i{0}; i < 8; ++i) {
+        uint64_t word;
+        std::memcpy(&word, snapshot.squares.data() + 8 * i, sizeof(word));
+        slot.data[i].store(word, std::memory_order_relaxed);
+    }
+    uint64_t flags = (snapshot.blackToMove ? black_to_move_flag : 0) |
+                     (snapshot.whiteChecked ? white_checked_flag : 0) |
+                     (snapshot.blackChecked ? black_checked_flag : 0);
+    slot.data[8].store(flags, std::memory_order_relaxed);
+
+    slot.sequence.store(2 * version, std::memory_order_release);
+    latest.store(version, std::memory_order_release);
+}
+
+bool SnapshotPublisher::read(BoardSnapshot& out) const {
+    while (true) {
+        uint64_t version = latest.load(std::memory_order_acquire);
+        if (version == 0) {
+            return false;
+        }
+        const Slot& slot = slots[version % slot_count];
+        if (slot.sequence.load(std::memory_order_acquire) != 2 * version) {
+            continue; // lapped before we started
+        }
+        for (size_t i{0}; i < 8; ++i) {
+            uint64_t word = slot.data[i].load(std::memory_order_relaxed);
+            std::memcpy(out.squares.data() + 8 * i, &word, sizeof(word));
+        }
+        uint64_t flags = slot.data[8].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != 2 * version) {
+            continue; // lapped during the copy
+        }
+        out.version = version;
+        out.blackToMove = flags & black_to_move_flag;
+        out.whiteChecked = flags & white_checked_flag;
+        out.blackChecked = flags & black_checked_flag;
+        return true;
+    }
+}
+
+uint64_t SnapshotPublisher::version() const {
+    return latest.load(std::memory_order_acquire);
+}
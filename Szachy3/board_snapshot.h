@@ -0,0 +1,42 @@
+#ifndef BOARD_SNAPSHOT_H
+#define BOARD_SNAPSHOT_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Immutable copy of a position for readers outside the thread that moves.
+struct BoardSnapshot {
+    std::array<char, 64> squares{}; // FEN letters (uppercase white), '\0' on empty squares
+    uint64_t version{0}; // 1 for the first published position, +1 per publication
+    bool blackToMove{false};
+    bool whiteChecked{false};
+    bool blackChecked{false};
+};
+
+// Single writer, any number of readers. Snapshots go round a ring of slots,
+// each guarded by a sequence number (a seqlock per slot). The writer never
+// waits; a reader copies the latest slot without locking or allocating and
+// only retries when the writer laps the whole ring during that one copy.
+class SnapshotPublisher {
+private:
+    static constexpr size_t slot_count{4};
+    static constexpr size_t words{9}; // 64 square bytes + one word of flags
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> sequence{0}; // odd while being written
+        std::array<std::atomic<uint64_t>, words> data{};
+    };
+
+    std::array<Slot, slot_count> slots;
+    std::atomic<uint64_t> latest{0};
+public:
+    // Called only by the writer thread.
+    void publish(const BoardSnapshot& snapshot);
+    // Copies the latest snapshot into out. Returns false if nothing was published yet.
+    bool read(BoardSnapshot& out) const;
+    // Version of the latest snapshot, cheap enough to poll for changes.
+    [[nodiscard]] uint64_t version() const;
+};
+
+#endif // BOARD_SNAPSHOT_H
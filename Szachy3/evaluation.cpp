@@ -0,0 +1,347 @@
+#include "evaluation.h"
+#include "search_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    constexpr uint64_t squareBit(int row, int column) {
+        return uint64_t{1} << (row * board_width + column);
+    }
+
+    constexpr uint64_t fileMask(int column) {
+        uint64_t mask{0};
+        if (column < 0 || column >= board_width) {
+            return mask;
+        }
+        for (int row{0}; row < board_height; ++row) {
+            mask |= squareBit(row, column);
+        }
+        return mask;
+    }
+
+    constexpr uint64_t adjacentFilesMask(int column) {
+        return fileMask(column - 1) | fileMask(column + 1);
+    }
+
+    // rows strictly in front of `row` from c's point of view
+    constexpr uint64_t rowsInFront(int row, Color c) {
+        uint64_t mask{0};
+        for (int r{0}; r < board_height; ++r) {
+            if ((c == WHITE && r > row) || (c == BLACK && r < row)) {
+                for (int col{0}; col < board_width; ++col) {
+                    mask |= squareBit(r, col);
+                }
+            }
+        }
+        return mask;
+    }
+
+    bool isPassed(int row, int column, Color c, uint64_t enemy_pawns) {
+        uint64_t span = (fileMask(column) | adjacentFilesMask(column)) & rowsInFront(row, c);
+        return (enemy_pawns & span) == 0;
+    }
+
+    bool isBackward(int row, int column, Color c, uint64_t own_pawns, uint64_t enemy_pawns) {
+        int forward = (c == WHITE) ? 1 : -1;
+        int stop_row = row + forward;
+        if (stop_row < 0 || stop_row >= board_height) {
+            return false;
+        }
+        // supported, or can still be supported, by a neighbour that is not ahead of it
+        if ((own_pawns & adjacentFilesMask(column) & ~rowsInFront(row, c)) != 0) {
+            return false;
+        }
+        int attacker_row = stop_row + forward;
+        if (attacker_row < 0 || attacker_row >= board_height) {
+            return false;
+        }
+        uint64_t stop_attackers{0};
+        if (column > 0) {
+            stop_attackers |= squareBit(attacker_row, column - 1);
+        }
+        if (column < board_width - 1) {
+            stop_attackers |= squareBit(attacker_row, column + 1);
+        }
+        return (enemy_pawns & stop_attackers) != 0;
+    }
+
+    struct PawnCounts {
+        std::array<int, board_height> passed{}; // by ranks advanced
+        int isolated{0};
+        int doubled{0};
+        int backward{0};
+    };
+
+    void countPawnsOf(Color c, uint64_t own_pawns, uint64_t enemy_pawns, uint64_t& passed, PawnCounts& counts) {
+        for (int column{0}; column < board_width; ++column) {
+            int on_file = std::popcount(own_pawns & fileMask(column));
+            if (on_file > 1) {
+                counts.doubled += on_file - 1;
+            }
+        }
+        for (uint64_t pawns = own_pawns; pawns != 0; pawns &= pawns - 1) {
+            auto [row, column] = Board::getPosition(std::countr_zero(pawns));
+            if (isPassed(row, column, c, enemy_pawns)) {
+                passed |= squareBit(row, column);
+                ++counts.passed[(c == WHITE) ? row : board_height - 1 - row];
+            }
+            if ((own_pawns & adjacentFilesMask(column)) == 0) {
+                ++counts.isolated;
+            } else if (isBackward(row, column, c, own_pawns, enemy_pawns)) {
+                ++counts.backward;
+            }
+        }
+    }
+
+    int scorePawns(const PawnCounts& counts, const EvalParams& params) {
+        int score{0};
+        for (int rank{0}; rank < board_height; ++rank) {
+            score += counts.passed[rank] * params.passedPawnBonus[rank];
+        }
+        return score - counts.isolated * params.isolatedPawnPenalty - counts.doubled * params.doubledPawnPenalty -
+               counts.backward * params.backwardPawnPenalty;
+    }
+
+    std::array<uint64_t, 2> pawnMasks(const Board& board) {
+        std::array<uint64_t, 2> pawns{};
+        for (auto& [index, piece] : board.getPositionMap()) {
+            if (piece->getType() == PAWN && !piece->isCaptured()) {
+                pawns[static_cast<int>(piece->getColor())] |= uint64_t{1} << index;
+            }
+        }
+        return pawns;
+    }
+
+    // square of the piece as seen from white's side of the board
+    int relativeSquare(int index, Color c) {
+        auto [row, column] = Board::getPosition(index);
+        return (c == WHITE) ? index : Board::getPositionIndex(board_height - 1 - row, column);
+    }
+
+    constexpr std::array<const char*, piece_type_count> piece_names{"PAWN", "ROOK", "KNIGHT", "BISHOP", "QUEEN", "KING"};
+
+    EvalParams current_params;
+    std::atomic<uint32_t> params_version{1};
+}
+
+int evaluatePawnStructure(const Board& board, std::array<uint64_t, 2>& passed_pawns) {
+    std::array<uint64_t, 2> pawns = pawnMasks(board);
+    passed_pawns = {};
+    PawnCounts white;
+    PawnCounts black;
+    countPawnsOf(WHITE, pawns[0], pawns[1], passed_pawns[0], white);
+    countPawnsOf(BLACK, pawns[1], pawns[0], passed_pawns[1], black);
+    return scorePawns(white, current_params) - scorePawns(black, current_params);
+}
+
+const EvalParams& evalParams() {
+    return current_params;
+}
+
+void setEvalParams(const EvalParams& params) {
+    current_params = params;
+    params_version.fetch_add(1, std::memory_order_relaxed);
+}
+
+vector<double> evalParamsToVector(const EvalParams& params) {
+    vector<double> weights(eval_features::count);
+    for (int type{0}; type < piece_type_count; ++type) {
+        weights[eval_features::piece_value + type] = params.pieceValues[type];
+        for (int square{0}; square < square_count; ++square) {
+            weights[eval_features::piece_square + type * square_count + square] = params.pieceSquare[type][square];
+        }
+    }
+    for (int rank{0}; rank < board_height; ++rank) {
+        weights[eval_features::passed_pawn + rank] = params.passedPawnBonus[rank];
+    }
+    weights[eval_features::isolated_pawn] = params.isolatedPawnPenalty;
+    weights[eval_features::doubled_pawn] = params.doubledPawnPenalty;
+    weights[eval_features::backward_pawn] = params.backwardPawnPenalty;
+    return weights;
+}
+
+EvalParams evalParamsFromVector(const vector<double>& weights) {
+    if (weights.size() != eval_features::count) {
+        throw std::invalid_argument("Wrong number of evaluation weights: " + std::to_string(weights.size()));
+    }
+    auto value = [&](int index) { return static_cast<int>(std::lround(weights[index])); };
+    EvalParams params;
+    for (int type{0}; type < piece_type_count; ++type) {
+        params.pieceValues[type] = value(eval_features::piece_value + type);
+        for (int square{0}; square < square_count; ++square) {
+            params.pieceSquare[type][square] = value(eval_features::piece_square + type * square_count + square);
+        }
+    }
+    for (int rank{0}; rank < board_height; ++rank) {
+        params.passedPawnBonus[rank] = value(eval_features::passed_pawn + rank);
+    }
+    params.isolatedPawnPenalty = value(eval_features::isolated_pawn);
+    params.doubledPawnPenalty = value(eval_features::doubled_pawn);
+    params.backwardPawnPenalty = value(eval_features::backward_pawn);
+    return params;
+}
+
+string evalFeatureName(int index) {
+    using namespace eval_features;
+    if (index >= piece_value && index < piece_square) {
+        return string("value.") + piece_names[index - piece_value];
+    }
+    if (index >= piece_square && index < passed_pawn) {
+        int type = (index - piece_square) / square_count;
+        int square = (index - piece_square) % square_count;
+        string notation = Board::getNotation(square);
+        std::transform(notation.begin(), notation.end(), notation.begin(), [](unsigned char c) { return std::tolower(c); });
+        return string("pst.") + piece_names[type] + "." + notation;
+    }
+    if (index >= passed_pawn && index < isolated_pawn) {
+        return "passed." + std::to_string(index - passed_pawn);
+    }
+    switch (index) {
+        case isolated_pawn:
+            return "isolated";
+        case doubled_pawn:
+            return "doubled";
+        case backward_pawn:
+            return "backward";
+        default:
+            throw std::out_of_range("No evaluation feature " + std::to_string(index));
+    }
+}
+
+void saveEvalParams(const EvalParams& params, const string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    vector<double> weights = evalParamsToVector(params);
+    for (int i{0}; i < eval_features::count; ++i) {
+        out << evalFeatureName(i) << ' ' << std::lround(weights[i]) << '\n';
+    }
+}
+
+EvalParams loadEvalParams(const string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Cannot read " + path);
+    }
+    std::unordered_map<string, int> indices;
+    for (int i{0}; i < eval_features::count; ++i) {
+        indices[evalFeatureName(i)] = i;
+    }
+    vector<double> weights = evalParamsToVector(EvalParams{});
+    string name;
+    double value;
+    while (in >> name >> value) {
+        auto it = indices.find(name);
+        if (it == indices.end()) {
+            throw std::invalid_argument("Unknown evaluation parameter: " + name);
+        }
+        weights[it->second] = value;
+    }
+    return evalParamsFromVector(weights);
+}
+
+void extractEvalFeatures(const Board& board, vector<EvalFeature>& out) {
+    // white and black pieces on mirrored squares cancel, so sum densely first
+    std::array<int, eval_features::count> sums{};
+    std::array<bool, eval_features::count> seen{};
+    std::array<uint16_t, eval_features::count> touched;
+    int touched_count{0};
+    auto add = [&](int index, int amount) {
+        if (amount == 0) {
+            return;
+        }
+        if (!seen[index]) {
+            seen[index] = true;
+            touched[touched_count++] = static_cast<uint16_t>(index);
+        }
+        sums[index] += amount;
+    };
+    for (auto& [index, piece] : board.getPositionMap()) {
+        if (piece->isCaptured()) {
+            continue;
+        }
+        int type = static_cast<int>(piece->getType());
+        int sign = (piece->getColor() == WHITE) ? 1 : -1;
+        add(eval_features::piece_value + type, sign);
+        add(eval_features::piece_square + type * square_count + relativeSquare(index, piece->getColor()), sign);
+    }
+    std::array<uint64_t, 2> pawns = pawnMasks(board);
+    std::array<uint64_t, 2> passed{};
+    PawnCounts white;
+    PawnCounts black;
+    countPawnsOf(WHITE, pawns[0], pawns[1], passed[0], white);
+    countPawnsOf(BLACK, pawns[1], pawns[0], passed[1], black);
+    for (int rank{0}; rank < board_height; ++rank) {
+        add(eval_features::passed_pawn + rank, white.passed[rank] - black.passed[rank]);
+    }
+    add(eval_features::isolated_pawn, black.isolated - white.isolated);
+    add(eval_features::doubled_pawn, black.doubled - white.doubled);
+    add(eval_features::backward_pawn, black.backward - white.backward);
+    for (int i{0}; i < touched_count; ++i) {
+        if (sums[touched[i]] != 0) {
+            out.push_back({touched[i], static_cast<int8_t>(sums[touched[i]])});
+        }
+    }
+}
+
+PawnHashTable::PawnHashTable(size_t size) : entries(std::bit_ceil(size)) {}
+
+const PawnEntry& PawnHashTable::probe(const Board& board) {
+    uint64_t key = board.getPawnKey();
+    PawnEntry& entry = entries[key & (entries.size() - 1)];
+    uint32_t version = params_version.load(std::memory_order_relaxed);
+    ++probes;
+    STATS_INC(PAWN_HASH_PROBES);
+    if (entry.valid && entry.key == key && entry.paramsVersion == version) {
+        ++hits;
+        STATS_INC(PAWN_HASH_HITS);
+        return entry;
+    }
+    entry.key = key;
+    entry.score = evaluatePawnStructure(board, entry.passedPawns);
+    entry.paramsVersion = version;
+    entry.valid = true;
+    return entry;
+}
+
+void PawnHashTable::clear() {
+    std::fill(entries.begin(), entries.end(), PawnEntry{});
+    probes = 0;
+    hits = 0;
+}
+
+uint64_t PawnHashTable::getProbes() const {
+    return probes;
+}
+
+uint64_t PawnHashTable::getHits() const {
+    return hits;
+}
+
+PawnHashTable& threadPawnTable() {
+    thread_local PawnHashTable table;
+    return table;
+}
+
+int evaluate(const Board& board) {
+    STATS_INC(EVALUATIONS);
+    STATS_PHASE(EVALUATION);
+    int score{0};
+    for (auto& [index, piece] : board.getPositionMap()) {
+        if (piece->isCaptured()) {
+            continue;
+        }
+        int type = static_cast<int>(piece->getType());
+        int value = current_params.pieceValues[type] + current_params.pieceSquare[type][relativeSquare(index, piece->getColor())];
+        score += (piece->getColor() == WHITE) ? value : -value;
+    }
+    score += threadPawnTable().probe(board).score;
+    return (board.getTurn() == WHITE) ? score : -score;
+}
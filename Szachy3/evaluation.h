@@ -0,0 +1,99 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "board.h"
+
+static_assert(board_width * board_height <= 64, "square masks are stored in 64 bit integers");
+
+constexpr int pawn_hash_entries{1 << 14}; // must be a power of two
+constexpr int piece_type_count{static_cast<int>(NO_PIECE)};
+constexpr int square_count{board_width * board_height};
+
+// Values in centipawns, indexed by PieceType.
+constexpr std::array<int, piece_type_count> piece_values{100, 500, 320, 330, 900, 0};
+
+constexpr std::array<int, board_height> passed_pawn_bonus{0, 10, 15, 25, 45, 75, 120, 0}; // by ranks advanced
+constexpr int isolated_pawn_penalty{15};
+constexpr int doubled_pawn_penalty{12};
+constexpr int backward_pawn_penalty{10};
+
+// Every tunable evaluation weight. Sized by PieceType, so a new piece type
+// gets its own value and square table without further changes.
+struct EvalParams {
+    std::array<int, piece_type_count> pieceValues{piece_values};
+    // bonus by square from white's point of view; black squares are mirrored by row
+    std::array<std::array<int, square_count>, piece_type_count> pieceSquare{};
+    std::array<int, board_height> passedPawnBonus{passed_pawn_bonus};
+    int isolatedPawnPenalty{isolated_pawn_penalty};
+    int doubledPawnPenalty{doubled_pawn_penalty};
+    int backwardPawnPenalty{backward_pawn_penalty};
+};
+
+// The evaluation is linear in EvalParams: evaluate() from white's point of
+// view equals the dot product of the parameter vector and the feature vector.
+namespace eval_features {
+    constexpr int piece_value{0};
+    constexpr int piece_square{piece_value + piece_type_count}; // + type * square_count + square
+    constexpr int passed_pawn{piece_square + piece_type_count * square_count}; // + ranks advanced
+    constexpr int isolated_pawn{passed_pawn + board_height};
+    constexpr int doubled_pawn{isolated_pawn + 1};
+    constexpr int backward_pawn{doubled_pawn + 1};
+    constexpr int count{backward_pawn + 1};
+}
+
+struct EvalFeature {
+    uint16_t index;
+    int8_t coefficient; // white count minus black count, negated for penalties
+};
+
+const EvalParams& evalParams();
+// Not synchronized with running evaluations; set parameters before searching.
+void setEvalParams(const EvalParams& params);
+vector<double> evalParamsToVector(const EvalParams& params);
+EvalParams evalParamsFromVector(const vector<double>& weights);
+[[nodiscard]] string evalFeatureName(int index);
+// Text format, one "name value" line per parameter, see evalFeatureName.
+void saveEvalParams(const EvalParams& params, const string& path);
+EvalParams loadEvalParams(const string& path);
+// Appends the non-zero features of the position to out.
+void extractEvalFeatures(const Board& board, vector<EvalFeature>& out);
+
+// Cached result of the pawn structure evaluation for one pawn key.
+struct PawnEntry {
+    uint64_t key{0};
+    std::array<uint64_t, 2> passedPawns{}; // square mask of passed pawns, indexed by Color
+    int score{0}; // from white's point of view
+    uint32_t paramsVersion{0}; // entries computed with other parameters are stale
+    bool valid{false};
+};
+
+// Small direct-mapped cache of pawn structure scores. Pawn structure changes
+// rarely during a game or a search, so nearly every lookup is a hit. Tables
+// are not synchronized, every thread should use its own (see threadPawnTable).
+class PawnHashTable {
+private:
+    vector<PawnEntry> entries;
+    uint64_t probes{0};
+    uint64_t hits{0};
+public:
+    explicit PawnHashTable(size_t size = pawn_hash_entries);
+    const PawnEntry& probe(const Board& board);
+    void clear();
+    [[nodiscard]] uint64_t getProbes() const;
+    [[nodiscard]] uint64_t getHits() const;
+};
+
+PawnHashTable& threadPawnTable();
+
+// Full (uncached) pawn structure evaluation: passed, isolated, doubled and
+// backward pawns. Fills passed_pawns with the passed pawn masks.
+int evaluatePawnStructure(const Board& board, std::array<uint64_t, 2>& passed_pawns);
+
+// Static evaluation in centipawns from the side to move's point of view.
+int evaluate(const Board& board);
+
+#endif // EVALUATION_H
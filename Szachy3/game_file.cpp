@@ -0,0 +1,91 @@
+#include "game_file.h"
+#include <stdexcept>
+
+namespace {
+    string_view nextToken(string_view& line) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == string_view::npos) {
+            line = {};
+            return {};
+        }
+        size_t end = std::min(line.find_first_of(" \t\r", start), line.size());
+        string_view token = line.substr(start, end - start);
+        line.remove_prefix(end);
+        return token;
+    }
+}
+
+std::optional<GameResult> parseGameResult(string_view token) {
+    if (token == "1-0") {
+        return GameResult::WHITE_WIN;
+    }
+    if (token == "0-1") {
+        return GameResult::BLACK_WIN;
+    }
+    if (token == "1/2-1/2") {
+        return GameResult::DRAW;
+    }
+    return std::nullopt;
+}
+
+bool parseGameLine(string_view line, GameResult& result, vector<Move>& moves) {
+    std::optional<GameResult> parsed = parseGameResult(nextToken(line));
+    if (!parsed) {
+        return false;
+    }
+    result = *parsed;
+    moves.clear();
+    for (string_view token = nextToken(line); !token.empty(); token = nextToken(line)) {
+        std::optional<Move> m = Board::parseMove(token);
+        if (!m) {
+            return false;
+        }
+        moves.push_back(*m);
+    }
+    return true;
+}
+
+GameFileReader::GameFileReader(std::span<const string> files, size_t block_bytes) : files(files), blockBytes(block_bytes) {
+    if (block_bytes == 0) {
+        throw std::invalid_argument("Game file blocks must not be empty");
+    }
+}
+
+bool GameFileReader::next(string& block) {
+    while (true) {
+        if (!file) {
+            if (nextFile == files.size()) {
+                return false;
+            }
+            path = files[nextFile++];
+            file.reset(std::fopen(path.c_str(), "rb"));
+            if (!file) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+        }
+        block = std::move(carry);
+        carry.clear();
+        size_t kept = block.size();
+        block.resize(kept + blockBytes);
+        size_t got = std::fread(block.data() + kept, 1, blockBytes, file.get());
+        if (got < blockBytes && std::ferror(file.get())) {
+            throw std::runtime_error("Cannot read " + path);
+        }
+        block.resize(kept + got);
+        bytes += got;
+        if (got < blockBytes) {
+            file.reset(); // the last line of a file needs no newline
+        } else {
+            size_t cut = block.rfind('\n') + 1; // 0 without a newline: all of it is carried
+            carry.assign(block, cut);
+            block.resize(cut);
+        }
+        if (!block.empty()) {
+            return true;
+        }
+    }
+}
+
+uint64_t GameFileReader::bytesRead() const {
+    return bytes;
+}
@@ -0,0 +1,57 @@
+#ifndef GAME_FILE_H
+#define GAME_FILE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "board.h"
+#include "training_data.h"
+
+// Game files hold one game per line, played from the initial position: the
+// result (1-0, 0-1 or 1/2-1/2) followed by the moves in coordinate notation,
+// e.g. "1-0 e2e4 e7e5 g1f3". Blank lines are skipped.
+
+[[nodiscard]] std::optional<GameResult> parseGameResult(string_view token);
+
+// Splits a line into its result and moves, without checking that the moves
+// are legal. Returns false when the line is not a game.
+bool parseGameLine(string_view line, GameResult& result, vector<Move>& moves);
+
+// Calls f(line) for every non-blank line of a block.
+template<typename F>
+void forEachGameLine(string_view block, F&& f) {
+    while (!block.empty()) {
+        size_t end = std::min(block.find('\n'), block.size());
+        string_view line = block.substr(0, end);
+        block.remove_prefix(std::min(end + 1, block.size()));
+        if (line.find_first_not_of(" \t\r") != string_view::npos) {
+            f(line);
+        }
+    }
+}
+
+// Reads a list of game files in blocks of whole lines, so the blocks can be
+// replayed in parallel. A line longer than a block makes its block longer.
+class GameFileReader {
+private:
+    std::span<const string> files;
+    size_t nextFile{0};
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file{nullptr, std::fclose};
+    string path;
+    string carry; // the start of a line split between blocks
+    size_t blockBytes;
+    uint64_t bytes{0};
+public:
+    GameFileReader(std::span<const string> files, size_t block_bytes);
+    // Replaces block with the next lines; false when every file has been read.
+    bool next(string& block);
+    [[nodiscard]] uint64_t bytesRead() const;
+};
+
+#endif // GAME_FILE_H
@@ -0,0 +1,67 @@
+#include "game_record.h"
+#include <algorithm>
+#include <stdexcept>
+#include "trace.h"
+
+GameRecord::GameRecord(std::shared_ptr<Board> board, int snapshot_interval)
+    : board(std::move(board)), snapshotInterval(std::max(snapshot_interval, 1)) {
+    start();
+}
+
+void GameRecord::start() {
+    moves.clear();
+    snapshots.assign(1, board->toCompact());
+    keys.assign(1, board->getPositionKey());
+    clocks.assign(1, static_cast<uint16_t>(board->getHalfmoveClock()));
+    current = 0;
+}
+
+MoveStatus GameRecord::play(Move m) {
+    MoveStatus status = board->tryMove(m);
+    if (status != MoveStatus::OK) {
+        return status;
+    }
+    moves.resize(current);
+    keys.resize(current + 1);
+    clocks.resize(current + 1);
+    snapshots.resize(current / snapshotInterval + 1);
+    moves.push_back(m);
+    keys.push_back(board->getPositionKey());
+    clocks.push_back(static_cast<uint16_t>(board->getHalfmoveClock()));
+    ++current;
+    if (current % snapshotInterval == 0) {
+        snapshots.push_back(board->toCompact());
+    }
+    return MoveStatus::OK;
+}
+
+void GameRecord::seek(int ply) {
+    TRACE_SCOPE("GameRecord::seek");
+    if (ply < 0 || ply > length()) {
+        throw std::out_of_range("No ply " + std::to_string(ply) + " in a game of " + std::to_string(length()));
+    }
+    int snapshot = ply / snapshotInterval;
+    board->initFromCompact(snapshots[snapshot]);
+    for (int i{snapshot * snapshotInterval}; i < ply; ++i) {
+        board->tryMove(moves[i]);
+    }
+    RepetitionHistory history;
+    history.reset(keys[0], clocks[0]);
+    for (int i{1}; i <= ply; ++i) {
+        history.push(keys[i], clocks[i] == 0);
+    }
+    board->setHistory(std::move(history));
+    current = ply;
+}
+
+int GameRecord::ply() const {
+    return current;
+}
+
+int GameRecord::length() const {
+    return static_cast<int>(moves.size());
+}
+
+const vector<Move>& GameRecord::getMoves() const {
+    return moves;
+}
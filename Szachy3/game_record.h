@@ -0,0 +1,35 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <memory>
+#include <vector>
+#include "board.h"
+
+// The moves of one game played on a Board, with a full snapshot every
+// snapshotInterval plies: any ply is restored by loading the snapshot at or
+// before it and replaying at most snapshotInterval - 1 moves. The position
+// keys of every ply are kept as well, so the restored board still sees
+// repetitions of positions before the snapshot.
+class GameRecord {
+private:
+    std::shared_ptr<Board> board;
+    int snapshotInterval;
+    vector<Move> moves;
+    vector<CompactBoard> snapshots; // position at ply i * snapshotInterval
+    vector<uint64_t> keys; // position key at every ply
+    vector<uint16_t> clocks; // halfmove clock at every ply
+    int current{0};
+public:
+    explicit GameRecord(std::shared_ptr<Board> board, int snapshot_interval = 16);
+    // Starts a new record from the board's current position.
+    void start();
+    // Plays m at the current ply. After seeking back, a move replaces the rest of the game.
+    MoveStatus play(Move m);
+    // Sets the board to the position after the first ply moves.
+    void seek(int ply);
+    [[nodiscard]] int ply() const;
+    [[nodiscard]] int length() const;
+    [[nodiscard]] const vector<Move>& getMoves() const;
+};
+
+#endif // GAME_RECORD_H
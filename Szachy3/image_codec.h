@@ -0,0 +1,41 @@
+#ifndef IMAGE_CODEC_H
+#define IMAGE_CODEC_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// 8-bit RGBA pixels, rows from the top. A pixel is 0xAABBGGRR, so the bytes
+// in memory are R, G, B, A. Decoded images have straight alpha; the
+// renderer premultiplies its sprites once after loading.
+struct Image {
+    int width{0};
+    int height{0};
+    vector<uint32_t> pixels;
+
+    [[nodiscard]] uint32_t* row(int y) { return pixels.data() + static_cast<size_t>(y) * width; }
+    [[nodiscard]] const uint32_t* row(int y) const { return pixels.data() + static_cast<size_t>(y) * width; }
+};
+
+// Decodes the PNG (8-bit, non-interlaced) and BMP (24 or 32 bit, uncompressed
+// or BI_BITFIELDS) files the GUI ships with, without any platform codec.
+Image decodePng(std::span<const uint8_t> data);
+Image decodeBmp(std::span<const uint8_t> data);
+// Picks the decoder by the file signature.
+Image loadImage(const string& path);
+
+// RGBA PNG with a fast greedy deflate (fixed Huffman codes); good enough for
+// the flat colours of board thumbnails.
+vector<uint8_t> encodePng(const Image& image);
+void savePng(const string& path, const Image& image);
+
+void premultiplyAlpha(Image& image);
+// Resamples a premultiplied image with an area filter, so sprites keep their
+// edges when shrunk to small tiles.
+Image resizeImage(const Image& image, int width, int height);
+
+#endif // IMAGE_CODEC_H
@@ -0,0 +1,76 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    fileHandle = file;
+    bytes = static_cast<size_t>(size.QuadPart);
+    if (bytes == 0) {
+        return;
+    }
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map " + path);
+    }
+    address = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    bytes = static_cast<size_t>(st.st_size);
+    if (bytes == 0) {
+        return;
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Cannot map " + path);
+    }
+    address = mapped;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (address != nullptr) {
+        UnmapViewOfFile(address);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    CloseHandle(fileHandle);
+#else
+    if (address != nullptr) {
+        munmap(const_cast<void*>(address), bytes);
+    }
+    close(fd);
+#endif
+}
+
+const void* MappedFile::data() const {
+    return address;
+}
+
+size_t MappedFile::size() const {
+    return bytes;
+}
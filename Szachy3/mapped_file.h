@@ -0,0 +1,28 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. An empty file maps to no data.
+class MappedFile {
+private:
+    const void* address{nullptr};
+    size_t bytes{0};
+#ifdef _WIN32
+    void* fileHandle{nullptr};
+    void* mappingHandle{nullptr};
+#else
+    int fd{-1};
+#endif
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const void* data() const;
+    [[nodiscard]] size_t size() const;
+};
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,347 @@
+#include "mate_solver.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include "trace.h"
+
+namespace {
+    constexpr uint32_t infinite_pn{1u << 30};
+    // a quiet attacking move leaves the defender more replies than a check
+    constexpr uint32_t quiet_initial_pn{2};
+    constexpr size_t gc_fill_percent{90};
+    constexpr uint64_t stop_check_interval{1024};
+
+    uint32_t saturatingAdd(uint32_t a, uint32_t b) {
+        return std::min(a + b, infinite_pn);
+    }
+
+    // The plies a disproof holds for one ply above a child whose disproof holds for plies.
+    uint16_t pliesAbove(uint32_t plies) {
+        if (plies == ProofTable::unlimited_plies) {
+            return ProofTable::unlimited_plies;
+        }
+        return static_cast<uint16_t>(std::min<uint32_t>(plies + 1, ProofTable::unlimited_plies - 1));
+    }
+}
+
+ProofTable::ProofTable(size_t megabytes) {
+    size_t count = std::max(bucket_size, megabytes * 1024 * 1024 / sizeof(Entry));
+    entries.assign(std::bit_floor(count), Entry{});
+}
+
+void ProofTable::clear() {
+    std::fill(entries.begin(), entries.end(), Entry{});
+    used = 0;
+    collections = 0;
+}
+
+const ProofTable::Entry* ProofTable::find(uint64_t key) const {
+    size_t first = (key & (entries.size() / bucket_size - 1)) * bucket_size;
+    for (size_t i{first}; i < first + bucket_size; ++i) {
+        if (entries[i].work != 0 && entries[i].key == key) {
+            return &entries[i];
+        }
+    }
+    return nullptr;
+}
+
+void ProofTable::store(const Entry& entry) {
+    size_t first = (entry.key & (entries.size() / bucket_size - 1)) * bucket_size;
+    Entry* slot = &entries[first];
+    // an empty slot, else the smallest subtree, unproven ones first
+    auto replaceable = [](const Entry& e) { return std::pair{e.work != 0 && e.pn == 0, e.work}; };
+    for (size_t i{first}; i < first + bucket_size; ++i) {
+        if (entries[i].work != 0 && entries[i].key == entry.key) {
+            slot = &entries[i];
+            break;
+        }
+        if (slot->work != 0 && replaceable(entries[i]) < replaceable(*slot)) {
+            slot = &entries[i];
+        }
+    }
+    if (slot->work == 0) {
+        ++used;
+    }
+    *slot = entry;
+    slot->work = std::max<uint32_t>(slot->work, 1);
+    if (used * 100 > entries.size() * gc_fill_percent) {
+        collectGarbage();
+    }
+}
+
+void ProofTable::remove(uint64_t key) {
+    size_t first = (key & (entries.size() / bucket_size - 1)) * bucket_size;
+    for (size_t i{first}; i < first + bucket_size; ++i) {
+        if (entries[i].work != 0 && entries[i].key == key) {
+            entries[i].work = 0;
+            --used;
+            return;
+        }
+    }
+}
+
+void ProofTable::collectGarbage() {
+    TRACE_SCOPE("ProofTable::collectGarbage");
+    ++collections;
+    for (uint32_t threshold{1}; used > entries.size() / 2 && threshold != 0; threshold *= 2) {
+        for (auto& e : entries) {
+            if (e.work != 0 && e.work <= threshold && e.pn != 0) {
+                e.work = 0;
+                --used;
+            }
+        }
+    }
+}
+
+uint64_t ProofTable::garbageCollections() const {
+    return collections;
+}
+
+MateSolver::MateSolver(const MateSolverOptions& options) : options(options), table(options.tableMegabytes) {}
+
+void MateSolver::stop() {
+    stopRequested.store(true, std::memory_order_relaxed);
+}
+
+void MateSolver::expand(Board& board, int ply, bool attacker) {
+    auto& list = children[ply];
+    list.clear();
+    vector<Move> moves;
+    if (attacker) {
+        board.generateLegalMoves(moves);
+    } else {
+        board.generateEvasions(moves);
+    }
+    Color defender = (board.getTurn() == WHITE) ? BLACK : WHITE;
+    MoveUndo undo;
+    for (Move m : moves) {
+        board.makeMove(m, undo);
+        bool check = attacker && board.checkIfChecked(defender);
+        uint64_t key = board.getPositionKey();
+        board.unmakeMove(undo);
+        if (attacker && options.checksOnly && !check) {
+            continue;
+        }
+        uint32_t pn = (attacker && !check) ? quiet_initial_pn : 1;
+        list.push_back({m, key, check, pn, 1});
+    }
+    // checks first, so that they win ties between equally promising moves
+    if (attacker) {
+        std::stable_partition(list.begin(), list.end(), [](const Child& c) { return c.check; });
+    }
+}
+
+// Multiple iterative deepening at one node, in the phi/delta form: phi is the
+// proof number of an OR (attacker) node and the disproof number of an AND
+// node, delta the other one. Returns once phi or delta reaches its threshold.
+void MateSolver::mid(Board& board, int ply, bool attacker, uint32_t th_phi, uint32_t th_delta, int max_ply) {
+    ++nodes;
+    if ((nodes % stop_check_interval == 0 && stopRequested.load(std::memory_order_relaxed)) ||
+        (options.maxNodes != 0 && nodes >= options.maxNodes)) {
+        aborted = true;
+    }
+    uint64_t key = board.getPositionKey();
+    uint64_t nodes_before = nodes;
+    const auto* previous = table.find(key);
+    uint32_t previous_work = previous ? previous->work : 0;
+    ProofTable::Entry entry{key, 0, 0, 1, 0};
+
+    if (ply >= max_ply) {
+        entry.pn = infinite_pn;
+        entry.plies = 0;
+        table.store(entry);
+        return;
+    }
+    expand(board, ply, attacker);
+    auto& list = children[ply];
+    if (list.empty()) {
+        bool mated = !attacker && board.checkIfChecked(board.getTurn());
+        entry.pn = mated ? 0 : infinite_pn;
+        entry.dn = mated ? infinite_pn : 0;
+        entry.plies = ProofTable::unlimited_plies;
+        table.store(entry);
+        return;
+    }
+    int child_plies_left = max_ply - ply - 1;
+
+    while (true) {
+        uint32_t phi{infinite_pn};
+        uint32_t max_child_phi{0};
+        uint32_t open_children{0}; // with a non-zero phi
+        uint32_t second_phi{infinite_pn}; // second smallest child delta
+        size_t best{0};
+        // the plies the disproved children's disproofs hold for, the fewest and the most
+        uint32_t min_plies{ProofTable::unlimited_plies};
+        uint32_t max_plies{0};
+        for (size_t i{0}; i < list.size(); ++i) {
+            Child& c = list[i];
+            uint32_t pn{infinite_pn};
+            uint32_t dn{0};
+            uint32_t plies{0};
+            if (std::find(path.begin(), path.end(), c.key) == path.end()) {
+                // The last known numbers survive the child being dropped from
+                // the table. A disproof found with fewer plies left than here
+                // is no disproof here, until the child is searched from here.
+                if (const auto* e = table.find(c.key);
+                    e != nullptr && (c.searched || e->dn != 0 || e->plies >= child_plies_left)) {
+                    c.pn = e->pn;
+                    c.dn = e->dn;
+                    c.distance = e->distance;
+                    c.plies = e->plies;
+                }
+                pn = c.pn;
+                dn = c.dn;
+                plies = c.plies;
+                // a mate proven where the position was reached earlier may
+                // not fit in the plies left here; like a repetition, it fails
+                if (pn == 0 && ply + 1 + c.distance > max_ply) {
+                    pn = infinite_pn;
+                    dn = 0;
+                    plies = c.distance - 1u;
+                }
+            }
+            if (dn == 0) {
+                min_plies = std::min(min_plies, plies);
+                max_plies = std::max(max_plies, plies);
+            }
+            // children of an OR node are AND nodes and the other way round
+            uint32_t child_phi = attacker ? dn : pn;
+            uint32_t child_delta = attacker ? pn : dn;
+            max_child_phi = std::max(max_child_phi, child_phi);
+            open_children += child_phi != 0;
+            if (child_delta < phi) {
+                second_phi = phi;
+                phi = child_delta;
+                best = i;
+            } else if (child_delta < second_phi) {
+                second_phi = child_delta;
+            }
+        }
+        // Weak proof numbers: the largest child plus one per other open child
+        // instead of the sum, which transpositions and king shuffles inflate.
+        uint32_t delta = (open_children == 0) ? 0 : saturatingAdd(max_child_phi, open_children - 1);
+        if (phi >= th_phi || delta >= th_delta || aborted) {
+            entry.pn = attacker ? phi : delta;
+            entry.dn = attacker ? delta : phi;
+            entry.work = static_cast<uint32_t>(std::min<uint64_t>(previous_work + (nodes - nodes_before) + 1, UINT32_MAX));
+            if (entry.pn == 0 || entry.dn == 0) {
+                // The distance comes from the numbers just used, which stay
+                // with the children even when the table dropped them: the
+                // shortest fitting mate at an OR node, the longest at an AND
+                // node, where every child is proven.
+                int distance = attacker ? INT_MAX : 0;
+                for (const auto& c : list) {
+                    if (c.pn == 0 && ply + 1 + c.distance <= max_ply &&
+                        std::find(path.begin(), path.end(), c.key) == path.end()) {
+                        distance = attacker ? std::min<int>(distance, c.distance) : std::max<int>(distance, c.distance);
+                    } else if (c.pn != 0 && c.dn != 0) {
+                        // still open, can never matter for this node again
+                        table.remove(c.key);
+                    }
+                }
+                if (entry.pn == 0) {
+                    entry.distance = static_cast<uint16_t>(std::min(distance + 1, UINT16_MAX));
+                } else {
+                    // every move of the attacker fails, or one move of the defender holds
+                    entry.plies = pliesAbove(attacker ? min_plies : max_plies);
+                }
+            }
+            table.store(entry);
+            return;
+        }
+        uint32_t child_th_phi = th_delta - (delta - max_child_phi);
+        // 1+epsilon trick: let the child run past the second best before switching back
+        uint32_t child_th_delta = std::min(th_phi, saturatingAdd(second_phi, second_phi / 4 + 1));
+        MoveUndo undo;
+        list[best].searched = true;
+        board.makeMove(list[best].move, undo);
+        path.push_back(key);
+        mid(board, ply + 1, !attacker, child_th_phi, child_th_delta, max_ply);
+        path.pop_back();
+        board.unmakeMove(undo);
+    }
+}
+
+bool MateSolver::extractPv(Board& board, int plies, vector<Move>& pv) {
+    vector<MoveUndo> undos(plies);
+    vector<Move> moves;
+    bool attacker{true};
+    bool mated{false};
+    int made{0};
+    for (; made <= plies; ++made) {
+        moves.clear();
+        if (attacker) {
+            board.generateLegalMoves(moves);
+        } else {
+            board.generateEvasions(moves);
+        }
+        // the attacker takes the shortest mate, the defender the longest resistance
+        Move best;
+        int best_distance = attacker ? INT_MAX : -1;
+        MoveUndo undo;
+        for (Move m : moves) {
+            board.makeMove(m, undo);
+            const auto* e = table.find(board.getPositionKey());
+            board.unmakeMove(undo);
+            if (e != nullptr && e->pn == 0 && (attacker ? e->distance < best_distance : e->distance > best_distance)) {
+                best = m;
+                best_distance = e->distance;
+            }
+        }
+        if (best.isNull()) {
+            mated = !attacker && moves.empty() && board.checkIfChecked(board.getTurn());
+            break;
+        }
+        if (made == plies) {
+            break; // the line goes on past its proven length
+        }
+        pv.push_back(best);
+        board.makeMove(best, undos[made]);
+        attacker = !attacker;
+    }
+    for (int i{static_cast<int>(pv.size())}; i > 0;) {
+        board.unmakeMove(undos[--i]);
+    }
+    return mated;
+}
+
+MateResult MateSolver::solve(Board& board) {
+    TRACE_SCOPE("MateSolver::solve");
+    stopRequested.store(false, std::memory_order_relaxed);
+    nodes = 0;
+    children.resize(options.maxPly + 1);
+    uint64_t key = board.getPositionKey();
+    MateResult result;
+    int max_ply = options.maxPly;
+    // df-pn proves some mate, not the shortest one; with options.shortest the
+    // proof is repeated below the length found until that fails
+    while (max_ply > 0) {
+        aborted = false;
+        table.clear();
+        path.clear();
+        mid(board, 0, true, infinite_pn - 1, infinite_pn - 1, max_ply);
+        result.nodes = nodes;
+        result.garbageCollections += table.garbageCollections();
+        const auto* root = table.find(key);
+        if (aborted || root == nullptr || root->pn != 0) {
+            if (result.status == MateStatus::UNKNOWN && !aborted && root != nullptr && root->dn == 0 &&
+                root->plies == ProofTable::unlimited_plies) {
+                result.status = MateStatus::NO_MATE;
+            }
+            break;
+        }
+        // the reported length is the line's, when it could be read back in full
+        vector<Move> pv;
+        int plies = extractPv(board, root->distance, pv) ? static_cast<int>(pv.size()) : root->distance;
+        if (result.status != MateStatus::MATE || (plies + 1) / 2 < result.mateIn) {
+            result.status = MateStatus::MATE;
+            result.mateIn = (plies + 1) / 2;
+            result.pv = std::move(pv);
+        }
+        if (!options.shortest) {
+            break;
+        }
+        max_ply = std::min<int>(plies, root->distance) - 2;
+    }
+    return result;
+}
@@ -0,0 +1,105 @@
+#ifndef MATE_SOLVER_H
+#define MATE_SOLVER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "board.h"
+
+struct MateSolverOptions {
+    size_t tableMegabytes{32};
+    uint64_t maxNodes{50'000'000}; // 0 - unlimited
+    int maxPly{127}; // lines longer than this count as failed attacks
+    bool checksOnly{false}; // the attacker may only give check
+    bool shortest{false}; // keep searching for shorter mates after the first proof
+};
+
+enum class MateStatus : uint8_t {
+    MATE, // the side to move mates by force
+    NO_MATE, // in any number of moves
+    UNKNOWN // node limit reached, stopped, or no mate within maxPly
+};
+
+struct MateResult {
+    MateStatus status{MateStatus::UNKNOWN};
+    int mateIn{0}; // moves of the side to move, MATE only; the length of pv when it reaches the mate
+    vector<Move> pv;
+    uint64_t nodes{0};
+    uint64_t garbageCollections{0};
+};
+
+// Bounded table of proof and disproof numbers. Entries live in buckets of
+// four; a full bucket drops its smallest subtree, and when the table is 90%
+// full every entry below a growing work threshold is dropped (SmallTreeGC).
+// Proven entries are dropped last, as the mating line is read back from them.
+class ProofTable {
+public:
+    struct Entry {
+        uint64_t key{0};
+        uint32_t pn{0};
+        uint32_t dn{0};
+        uint32_t work{0}; // nodes searched below the entry, 0 - empty slot
+        uint16_t distance{0}; // plies to mate, proven entries only
+        // Disproved entries: the disproof holds with at most this many plies
+        // left, as it ran into maxPly or a repetition on the line searched;
+        // unlimited_plies when it holds with any number.
+        uint16_t plies{0};
+    };
+    static constexpr uint16_t unlimited_plies{UINT16_MAX};
+private:
+    static constexpr size_t bucket_size{4};
+    vector<Entry> entries;
+    size_t used{0};
+    uint64_t collections{0};
+public:
+    explicit ProofTable(size_t megabytes);
+    void clear();
+    [[nodiscard]] const Entry* find(uint64_t key) const;
+    void store(const Entry& entry);
+    void remove(uint64_t key);
+    void collectGarbage();
+    [[nodiscard]] uint64_t garbageCollections() const;
+};
+
+// Depth-first proof-number search (df-pn) for forced mates of the side to
+// move. Unlike alpha-beta it has no depth iterations: it always expands the
+// most proving line, so narrow forcing lines of any length are followed
+// cheaply. The defender only answers checks with evasions (king moves,
+// captures of the checker, interpositions). Repetitions of a position on the
+// current line count as a failed attack, as do lines longer than maxPly; a
+// disproof that relied on either is reused only where no more plies are left
+// and reported as UNKNOWN. One solver per thread; stop() may be called from
+// any thread.
+class MateSolver {
+private:
+    struct Child {
+        Move move;
+        uint64_t key{0};
+        bool check{false};
+        uint32_t pn{1};
+        uint32_t dn{1};
+        uint16_t distance{0}; // plies to mate once proven, kept if the entry is dropped
+        uint16_t plies{0}; // see ProofTable::Entry
+        bool searched{false}; // from this node, so its entry holds for the plies left here
+    };
+
+    MateSolverOptions options;
+    ProofTable table;
+    std::atomic<bool> stopRequested{false};
+    bool aborted{false};
+    uint64_t nodes{0};
+    vector<uint64_t> path;
+    vector<vector<Child>> children;
+
+    void expand(Board& board, int ply, bool attacker);
+    void mid(Board& board, int ply, bool attacker, uint32_t th_phi, uint32_t th_delta, int max_ply);
+    // Returns whether the line ends in mate.
+    bool extractPv(Board& board, int plies, vector<Move>& pv);
+public:
+    explicit MateSolver(const MateSolverOptions& options = {});
+    MateResult solve(Board& board);
+    void stop();
+};
+
+#endif // MATE_SOLVER_H
@@ -0,0 +1,469 @@
+#include "position_counts.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <stdexcept>
+#include "game_file.h"
+#include "thread_pool.h"
+
+uint16_t PositionCount::encode(Move m) {
+    return m.isNull() ? no_move : static_cast<uint16_t>(m.from << 6 | m.to);
+}
+
+Move PositionCount::decode() const {
+    return move == no_move ? Move{} : Move{move >> 6, move & 63};
+}
+
+uint64_t PositionCount::games() const {
+    return uint64_t{results[0]} + results[1] + results[2];
+}
+
+namespace {
+    bool before(const PositionCount& a, const PositionCount& b) {
+        return a.key != b.key ? a.key < b.key : a.move < b.move;
+    }
+
+    bool samePair(const PositionCount& a, const PositionCount& b) {
+        return a.key == b.key && a.move == b.move;
+    }
+
+    void addResults(PositionCount& into, const PositionCount& from) {
+        for (size_t i{0}; i < into.results.size(); ++i) {
+            uint64_t sum = uint64_t{into.results[i]} + from.results[i];
+            into.results[i] = static_cast<uint32_t>(std::min<uint64_t>(sum, std::numeric_limits<uint32_t>::max()));
+        }
+    }
+
+    // Sorts records and merges equal pairs, leaving one record per pair.
+    void sortAndCombine(vector<PositionCount>& records) {
+        std::sort(records.begin(), records.end(), before);
+        size_t kept{0};
+        for (size_t i{0}; i < records.size(); ++i) {
+            if (kept > 0 && samePair(records[kept - 1], records[i])) {
+                addResults(records[kept - 1], records[i]);
+            } else {
+                records[kept++] = records[i];
+            }
+        }
+        records.resize(kept);
+    }
+
+    // Writes sorted records through a buffer, merging equal neighbours.
+    class RecordWriter {
+    private:
+        std::FILE* file;
+        string path;
+        vector<PositionCount> buffer;
+        PositionCount last;
+        bool hasLast{false};
+        uint64_t count{0};
+
+        void flush() {
+            if (std::fwrite(buffer.data(), sizeof(PositionCount), buffer.size(), file) != buffer.size()) {
+                throw std::runtime_error("Cannot write " + path);
+            }
+            buffer.clear();
+        }
+    public:
+        RecordWriter(const string& path, size_t buffer_records) : file(std::fopen(path.c_str(), "wb")), path(path) {
+            if (file == nullptr) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+            buffer.reserve(buffer_records);
+        }
+
+        ~RecordWriter() {
+            std::fclose(file);
+        }
+
+        RecordWriter(const RecordWriter&) = delete;
+        RecordWriter& operator=(const RecordWriter&) = delete;
+
+        void add(const PositionCount& record) {
+            if (hasLast && samePair(last, record)) {
+                addResults(last, record);
+                return;
+            }
+            if (hasLast) {
+                buffer.push_back(last);
+                if (buffer.size() == buffer.capacity()) {
+                    flush();
+                }
+            }
+            last = record;
+            hasLast = true;
+            ++count;
+        }
+
+        // Returns the number of records written.
+        uint64_t finish() {
+            if (hasLast) {
+                buffer.push_back(last);
+                hasLast = false;
+            }
+            flush();
+            if (std::fflush(file) != 0) {
+                throw std::runtime_error("Cannot write " + path);
+            }
+            return count;
+        }
+    };
+
+    class RecordReader {
+    private:
+        std::FILE* file;
+        string path;
+        vector<PositionCount> buffer;
+        size_t next{0};
+        size_t filled{0};
+    public:
+        RecordReader(const string& path, size_t buffer_records)
+                : file(std::fopen(path.c_str(), "rb")), path(path), buffer(buffer_records) {
+            if (file == nullptr) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+        }
+
+        ~RecordReader() {
+            std::fclose(file);
+        }
+
+        RecordReader(const RecordReader&) = delete;
+        RecordReader& operator=(const RecordReader&) = delete;
+
+        // The current record, nullptr at the end of the file. Returns the
+        // bytes read from the file through bytes_read.
+        const PositionCount* peek(uint64_t& bytes_read) {
+            if (next == filled) {
+                filled = std::fread(buffer.data(), sizeof(PositionCount), buffer.size(), file);
+                next = 0;
+                if (filled == 0) {
+                    if (std::ferror(file)) {
+                        throw std::runtime_error("Cannot read " + path);
+                    }
+                    return nullptr;
+                }
+                bytes_read += filled * sizeof(PositionCount);
+            }
+            return &buffer[next];
+        }
+
+        void advance() {
+            ++next;
+        }
+    };
+
+    // Merges sorted runs into one sorted file and returns its record count.
+    uint64_t mergeRuns(std::span<const string> inputs, const string& output, size_t buffer_records, uint64_t& bytes_read) {
+        vector<std::unique_ptr<RecordReader>> readers;
+        readers.reserve(inputs.size());
+        for (const string& path : inputs) {
+            readers.push_back(std::make_unique<RecordReader>(path, buffer_records));
+        }
+        // min-heap of the readers by their current record
+        vector<std::pair<PositionCount, size_t>> heap;
+        auto after = [](const auto& a, const auto& b) { return before(b.first, a.first); };
+        for (size_t i{0}; i < readers.size(); ++i) {
+            if (const PositionCount* r = readers[i]->peek(bytes_read)) {
+                heap.emplace_back(*r, i);
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), after);
+        RecordWriter writer(output, buffer_records);
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), after);
+            auto& [record, reader] = heap.back();
+            writer.add(record);
+            readers[reader]->advance();
+            if (const PositionCount* r = readers[reader]->peek(bytes_read)) {
+                record = *r;
+                std::push_heap(heap.begin(), heap.end(), after);
+            } else {
+                heap.pop_back();
+            }
+        }
+        return writer.finish();
+    }
+
+    // Names the spill files and removes the ones still there when destroyed,
+    // so an interrupted count leaves nothing behind.
+    class SpillFiles {
+    private:
+        std::filesystem::path directory;
+        string prefix;
+        std::atomic<uint64_t> created{0};
+    public:
+        explicit SpillFiles(const string& directory)
+                : directory(directory),
+                  prefix("positions-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-") {
+            if (!std::filesystem::is_directory(this->directory)) {
+                throw std::runtime_error("No temp directory " + directory);
+            }
+        }
+
+        ~SpillFiles() {
+            for (uint64_t i{0}; i < created.load(); ++i) {
+                std::error_code ignored;
+                std::filesystem::remove(path(i), ignored);
+            }
+        }
+
+        SpillFiles(const SpillFiles&) = delete;
+        SpillFiles& operator=(const SpillFiles&) = delete;
+
+        [[nodiscard]] string path(uint64_t i) const {
+            return (directory / (prefix + std::to_string(i) + ".run")).string();
+        }
+
+        string next() {
+            return path(created.fetch_add(1));
+        }
+
+        static void remove(const string& path) {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+    };
+
+    struct ReplayWorker {
+        std::shared_ptr<Board> board{std::make_shared<Board>()};
+        vector<PositionCount> run; // reserved to the worker's share of memory
+        vector<PositionCount> game;
+        vector<Move> moves;
+        uint64_t games{0};
+        uint64_t invalidGames{0};
+        uint64_t positions{0};
+    };
+
+    class Counter {
+    private:
+        const CountOptions& options;
+        ThreadPool pool;
+        SpillFiles spills;
+        FirstError error;
+        vector<ReplayWorker> workers;
+        std::mutex runsMutex;
+        vector<string> runs;
+        std::atomic<uint64_t> bytesRead{0};
+        std::atomic<uint64_t> bytesWritten{0};
+        int passes{0};
+
+        void spill(vector<PositionCount>& run) {
+            sortAndCombine(run);
+            string path = spills.next();
+            std::FILE* file = std::fopen(path.c_str(), "wb");
+            if (file == nullptr) {
+                throw std::runtime_error("Cannot open " + path);
+            }
+            size_t written = std::fwrite(run.data(), sizeof(PositionCount), run.size(), file);
+            if (std::fclose(file) != 0 || written != run.size()) {
+                throw std::runtime_error("Cannot write " + path);
+            }
+            bytesWritten += run.size() * sizeof(PositionCount);
+            run.clear();
+            std::lock_guard lock(runsMutex);
+            runs.push_back(path);
+        }
+
+        // Returns false for a game that cannot be read or has an illegal move.
+        bool replayGame(ReplayWorker& w, string_view line) {
+            GameResult result;
+            if (!parseGameLine(line, result, w.moves)) {
+                return false;
+            }
+            PositionCount record;
+            record.results[static_cast<size_t>(result)] = 1;
+            w.game.clear();
+            w.board->init();
+            size_t plies = (options.maxPly > 0) ? std::min(w.moves.size(), static_cast<size_t>(options.maxPly)) : w.moves.size();
+            for (size_t ply{0}; ply < plies; ++ply) {
+                Move m = w.moves[ply];
+                if (!w.board->isLegalMove(m)) {
+                    return false;
+                }
+                record.key = w.board->getPositionKey();
+                record.move = PositionCount::encode(m);
+                w.game.push_back(record);
+                MoveUndo undo; // makeMove expects an empty one
+                w.board->makeMove(m, undo);
+            }
+            if (plies == w.moves.size()) {
+                record.key = w.board->getPositionKey();
+                record.move = PositionCount::no_move;
+                w.game.push_back(record);
+            }
+            return true;
+        }
+
+        void replayBlock(ReplayWorker& w, string_view block) {
+            forEachGameLine(block, [&](string_view line) {
+                ++w.games;
+                if (!replayGame(w, line)) {
+                    ++w.invalidGames;
+                    return;
+                }
+                w.positions += w.game.size();
+                for (const PositionCount& record : w.game) {
+                    if (w.run.size() == w.run.capacity()) {
+                        spill(w.run);
+                    }
+                    w.run.push_back(record);
+                }
+            });
+        }
+
+        // Hands the game files to the pool block by block, never letting more
+        // than free_blocks wait at once.
+        void readGames(std::span<const string> game_files, size_t block_bytes, std::counting_semaphore<>& free_blocks,
+                       const CountProgress& on_progress) {
+            GameFileReader reader(game_files, block_bytes);
+            string text;
+            while (!error.any() && reader.next(text)) {
+                auto block = std::make_shared<string>(std::move(text));
+                free_blocks.acquire();
+                pool.submit([this, block, &free_blocks] {
+                    error.run([&] { replayBlock(workers[static_cast<size_t>(ThreadPool::currentWorker())], *block); });
+                    free_blocks.release();
+                });
+                bytesRead += block->size();
+                if (on_progress) {
+                    on_progress("replay", bytesRead.load());
+                }
+            }
+        }
+
+        void replay(std::span<const string> game_files, const CountProgress& on_progress) {
+            size_t share = options.memoryBytes / 2 / pool.size() / sizeof(PositionCount);
+            workers.resize(pool.size());
+            for (ReplayWorker& w : workers) {
+                w.run.reserve(share);
+            }
+            // at most two blocks per worker waiting or being replayed
+            size_t block_bytes = std::clamp<size_t>(options.memoryBytes / 8 / (2 * pool.size()), 64 << 10, 8 << 20);
+            std::counting_semaphore<> free_blocks(static_cast<std::ptrdiff_t>(2 * pool.size()));
+            try {
+                readGames(game_files, block_bytes, free_blocks, on_progress);
+            } catch (...) {
+                pool.wait(); // the tasks still use free_blocks
+                throw;
+            }
+            pool.wait();
+            for (ReplayWorker& w : workers) {
+                if (!w.run.empty()) {
+                    pool.submit([this, &w] { error.run([&] { spill(w.run); }); });
+                }
+            }
+            pool.wait();
+            error.rethrow();
+            for (ReplayWorker& w : workers) {
+                w.run = vector<PositionCount>{}; // the merge needs the memory
+            }
+        }
+
+        // Merges runs in groups of fanIn until at most fanIn are left.
+        void reduceRuns(const CountProgress& on_progress) {
+            std::mutex progress_mutex;
+            while (runs.size() > options.fanIn) {
+                ++passes;
+                size_t groups = (runs.size() + options.fanIn - 1) / options.fanIn;
+                size_t parallel = std::min(groups, pool.size());
+                size_t buffer_records = std::max<size_t>(
+                        options.memoryBytes / 2 / parallel / (options.fanIn + 1) / sizeof(PositionCount), 1024);
+                vector<string> inputs = std::move(runs);
+                runs.assign(groups, string{});
+                for (size_t g{0}; g < groups; ++g) {
+                    pool.submit([&, g] {
+                        error.run([&] {
+                            std::span<const string> group(inputs.data() + g * options.fanIn,
+                                                          std::min(options.fanIn, inputs.size() - g * options.fanIn));
+                            string path = spills.next();
+                            uint64_t read{0};
+                            uint64_t records = mergeRuns(group, path, buffer_records, read);
+                            for (const string& input : group) {
+                                SpillFiles::remove(input);
+                            }
+                            runs[g] = path;
+                            bytesRead += read;
+                            bytesWritten += records * sizeof(PositionCount);
+                            std::lock_guard lock(progress_mutex);
+                            if (on_progress) {
+                                on_progress("merge", bytesRead.load());
+                            }
+                        });
+                    });
+                }
+                pool.wait();
+                error.rethrow();
+            }
+        }
+    public:
+        explicit Counter(const CountOptions& options) : options(options), pool(options.threads), spills(options.tempDirectory) {}
+
+        CountStats count(std::span<const string> game_files, const string& out, const CountProgress& on_progress) {
+            CountStats stats;
+            auto start = std::chrono::steady_clock::now();
+            replay(game_files, on_progress);
+            auto replayed = std::chrono::steady_clock::now();
+            for (const ReplayWorker& w : workers) {
+                stats.games += w.games;
+                stats.invalidGames += w.invalidGames;
+                stats.positions += w.positions;
+            }
+            stats.runs = runs.size();
+
+            reduceRuns(on_progress);
+            ++passes;
+            size_t buffer_records = std::max<size_t>(options.memoryBytes / 2 / (runs.size() + 1) / sizeof(PositionCount), 1024);
+            uint64_t read{0};
+            stats.records = mergeRuns(runs, out, buffer_records, read);
+            for (const string& run : runs) {
+                SpillFiles::remove(run);
+            }
+            bytesRead += read;
+            bytesWritten += stats.records * sizeof(PositionCount);
+            if (on_progress) {
+                on_progress("merge", bytesRead.load());
+            }
+
+            stats.mergePasses = passes;
+            stats.bytesRead = bytesRead.load();
+            stats.bytesWritten = bytesWritten.load();
+            stats.replaySeconds = std::chrono::duration<double>(replayed - start).count();
+            stats.mergeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayed).count();
+            return stats;
+        }
+    };
+}
+
+CountStats countPositions(std::span<const string> game_files, const string& out, const CountOptions& options,
+                          const CountProgress& on_progress) {
+    if (options.threads == 0 || options.fanIn < 2) {
+        throw std::invalid_argument("Counting needs a thread and a fan-in of at least 2");
+    }
+    if (options.memoryBytes / 2 / options.threads / sizeof(PositionCount) < 4096) {
+        throw std::invalid_argument("Not enough memory for " + std::to_string(options.threads) + " counting threads");
+    }
+    Counter counter(options);
+    return counter.count(game_files, out, on_progress);
+}
+
+PositionTable::PositionTable(const string& path)
+        : file(path), records(static_cast<const PositionCount*>(file.data()), file.size() / sizeof(PositionCount)) {}
+
+std::span<const PositionCount> PositionTable::find(uint64_t key) const {
+    auto first = std::lower_bound(records.begin(), records.end(), key,
+                                  [](const PositionCount& r, uint64_t k) { return r.key < k; });
+    auto last = std::upper_bound(first, records.end(), key,
+                                 [](uint64_t k, const PositionCount& r) { return k < r.key; });
+    return {first, last};
+}
+
+std::span<const PositionCount> PositionTable::all() const {
+    return records;
+}
@@ -0,0 +1,82 @@
+#ifndef POSITION_COUNTS_H
+#define POSITION_COUNTS_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "mapped_file.h"
+#include "training_data.h"
+
+// How often a move was played from a position, split by the results of the
+// games it was played in. Spill files and the final table are plain arrays
+// of these, sorted by key and then move, with no two records for the same
+// pair, so a table can be mapped and searched without parsing.
+struct PositionCount {
+    static constexpr uint16_t no_move{0xFFFF}; // the last position of a game
+
+    uint64_t key{0}; // Board::getPositionKey
+    uint16_t move{no_move}; // from << 6 | to
+    std::array<uint8_t, 2> reserved{};
+    std::array<uint32_t, 3> results{}; // indexed by GameResult, saturating
+
+    [[nodiscard]] static uint16_t encode(Move m);
+    [[nodiscard]] Move decode() const;
+    [[nodiscard]] uint64_t games() const;
+};
+
+static_assert(sizeof(PositionCount) == 24, "PositionCount is a 24 byte on-disk record");
+
+struct CountOptions {
+    string tempDirectory{"."};
+    // RAM for the run buffers, the games being replayed and the merge
+    // buffers together; the inputs and the table may be any size.
+    size_t memoryBytes{size_t{256} << 20};
+    size_t threads{std::thread::hardware_concurrency()};
+    size_t fanIn{64}; // runs merged at once
+    int maxPly{0}; // positions after this many plies are not counted, 0 - no limit
+};
+
+struct CountStats {
+    uint64_t games{0};
+    uint64_t invalidGames{0}; // unreadable result or an illegal move, not counted at all
+    uint64_t positions{0}; // (position, move) pairs counted, final positions included
+    uint64_t records{0}; // distinct pairs in the table
+    uint64_t runs{0}; // spill files written by the replay
+    int mergePasses{0};
+    uint64_t bytesRead{0}; // games and spill files
+    uint64_t bytesWritten{0}; // spill files and the table
+    double replaySeconds{0.0};
+    double mergeSeconds{0.0};
+};
+
+// Counts every (position, move) pair of a set of game files (see
+// game_file.h) into a sorted PositionCount table at out, in bounded memory.
+//
+// The games are replayed on a ThreadPool. Each worker fills its share of the
+// memory with records, sorts them, merges equal pairs and spills the run to
+// the temp directory; runs are then merged fanIn at a time, the passes
+// before the last one in parallel, until one is left. on_progress is called
+// with the stage ("replay" or "merge") and bytes processed so far.
+using CountProgress = std::function<void(const char* stage, uint64_t bytes)>;
+CountStats countPositions(std::span<const string> game_files, const string& out, const CountOptions& options = {},
+                          const CountProgress& on_progress = {});
+
+// Read-only view of a table written by countPositions.
+class PositionTable {
+private:
+    MappedFile file;
+    std::span<const PositionCount> records;
+public:
+    explicit PositionTable(const string& path);
+
+    // The moves played from the position, in move order; empty when unseen.
+    [[nodiscard]] std::span<const PositionCount> find(uint64_t key) const;
+    [[nodiscard]] std::span<const PositionCount> all() const;
+};
+
+#endif // POSITION_COUNTS_H
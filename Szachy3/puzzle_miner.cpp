@@ -0,0 +1,284 @@
+#include "puzzle_miner.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <semaphore>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include "game_file.h"
+#include "thread_pool.h"
+
+bool Puzzle::isMate() const {
+    return score > mate_score - max_ply;
+}
+
+int Puzzle::mateIn() const {
+    return (mate_score - score + 1) / 2;
+}
+
+// Where a candidate occurs: the block of the game files read, the game line
+// in it and the ply. Blocks are read in order, so this orders the candidates
+// as the files do.
+struct PuzzleMiner::Sighting {
+    uint64_t key{0};
+    uint64_t block{0};
+    uint64_t line{0};
+    size_t ply{0};
+
+    bool operator<(const Sighting& other) const {
+        return std::tie(block, line, ply) < std::tie(other.block, other.line, other.ply);
+    }
+};
+
+struct PuzzleMiner::Worker {
+    std::shared_ptr<Board> board{std::make_shared<Board>()};
+    std::shared_ptr<Board> position{std::make_shared<Board>()}; // the candidate being verified, without history
+    std::unique_ptr<Searcher> searcher;
+    vector<Move> moves; // of the game being replayed
+    vector<Move> legal;
+    vector<Puzzle> puzzles;
+    vector<Sighting> sightings; // of the puzzles found and of the candidates cached
+    MiningStats stats;
+};
+
+namespace {
+    constexpr Color opponent(Color c) {
+        return (c == WHITE) ? BLACK : WHITE;
+    }
+}
+
+PuzzleMiner::PuzzleMiner(const PuzzleOptions& options) : options(options), verifiedKeys(std::bit_ceil(options.cacheEntries)) {
+    if (options.depth < 1 || options.maxSolutionMoves < 1 || options.cacheEntries == 0) {
+        throw std::invalid_argument("Puzzle mining needs a search depth, solution moves and a cache");
+    }
+}
+
+bool PuzzleMiner::isCandidate(Board& board, bool blunder, int recapture, vector<Move>& moves) {
+    if (blunder) {
+        return true;
+    }
+    Color side = board.getTurn();
+    Color other = opponent(side);
+    for (uint64_t targets = board.hangingPieces(other); targets != 0; targets &= targets - 1) {
+        int to = std::countr_zero(targets);
+        if (to == recapture) {
+            continue; // taking back in an exchange is no tactic
+        }
+        for (uint64_t from = board.attackersOf(to, side); from != 0; from &= from - 1) {
+            if (board.staticExchange({std::countr_zero(from), to}) >= options.minGain) {
+                return true;
+            }
+        }
+    }
+    if (std::popcount(board.kingEscapes(other)) > 1) {
+        return false;
+    }
+    // a boxed-in king: look for a check that leaves it no square to step to
+    // and does not just lose the checker
+    moves.clear();
+    board.generateLegalMoves(moves);
+    for (Move m : moves) {
+        if (board.staticExchange(m) < 0) {
+            continue;
+        }
+        MoveUndo undo;
+        board.makeMove(m, undo);
+        bool threat = board.checkIfChecked(other) && board.kingEscapes(other) == 0;
+        board.unmakeMove(undo);
+        if (threat) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PuzzleMiner::extendSolution(Worker& w, Puzzle& puzzle, const vector<Move>& pv) {
+    puzzle.solution.assign(1, pv[0]);
+    vector<Move> line = pv;
+    vector<MoveUndo> undos;
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.nodes = options.nodes;
+    limits.multiPv = 2;
+    // the solver's move and the reply the search expects, then the next solver move if it is unique
+    for (size_t at{0}; static_cast<int>(puzzle.solution.size() + 1) / 2 < options.maxSolutionMoves && at + 2 < line.size();
+         at += 2) {
+        for (size_t i{at}; i < at + 2; ++i) {
+            undos.emplace_back();
+            w.position->makeMove(line[i], undos.back());
+        }
+        SearchResult result = w.searcher->search(*w.position, limits);
+        if (result.lines.empty() || result.lines[0].pv.empty() ||
+            (result.lines.size() > 1 && result.lines[0].score - result.lines[1].score < options.minMargin)) {
+            break;
+        }
+        line.resize(at + 2);
+        line.insert(line.end(), result.lines[0].pv.begin(), result.lines[0].pv.end());
+        puzzle.solution.push_back(line[at + 1]);
+        puzzle.solution.push_back(line[at + 2]);
+    }
+    for (auto undo = undos.rbegin(); undo != undos.rend(); ++undo) {
+        w.position->unmakeMove(*undo);
+    }
+}
+
+bool PuzzleMiner::verify(Worker& w, Puzzle& puzzle) {
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.nodes = options.nodes;
+    limits.multiPv = 2;
+    w.searcher->newGame(); // the verdict must not depend on the positions searched before
+    SearchResult result = w.searcher->search(*w.position, limits);
+    if (result.lines.size() < 2 || result.lines[0].pv.empty()) {
+        return false; // no choice to make
+    }
+    const SearchLine& best = result.lines[0];
+    const SearchLine& second = result.lines[1];
+    puzzle.score = best.score;
+    if (puzzle.isMate()) {
+        // one mating move, and the search's whole line to the mate
+        if (puzzle.mateIn() > options.maxMateMoves || second.score > mate_score - max_ply ||
+            static_cast<int>(best.pv.size()) != 2 * puzzle.mateIn() - 1) {
+            return false;
+        }
+        puzzle.solution = best.pv;
+    } else if (best.score >= options.minScore && best.score - second.score >= options.minMargin) {
+        extendSolution(w, puzzle, best.pv);
+    } else {
+        return false;
+    }
+    puzzle.key = w.position->getPositionKey();
+    puzzle.fen = w.position->toFen();
+    return true;
+}
+
+MiningStats PuzzleMiner::mine(std::span<const string> game_files, const PuzzleCallback& on_puzzle,
+                              const ProgressCallback& on_progress) {
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(options.threads);
+    vector<Worker> workers(pool.size());
+    for (Worker& w : workers) {
+        w.searcher = std::make_unique<Searcher>(SearchOptions{.hashMegabytes = options.hashMegabytes});
+    }
+    FirstError error;
+    MiningStats totals;
+
+    auto mine_game = [&](Worker& w, string_view line, uint64_t block, uint64_t line_index) {
+        ++w.stats.games;
+        GameResult result;
+        if (!parseGameLine(line, result, w.moves)) {
+            ++w.stats.invalidGames;
+            return;
+        }
+        Board& board = *w.board;
+        board.init();
+        bool blunder{false};
+        int recapture{-1};
+        for (size_t ply{0};; ++ply) {
+            ++w.stats.positions;
+            if (isCandidate(board, blunder, recapture, w.legal)) {
+                ++w.stats.candidates;
+                uint64_t key = board.getPositionKey();
+                std::atomic<uint64_t>& slot = verifiedKeys[key & (verifiedKeys.size() - 1)];
+                // which game verifies a position first depends on the threads;
+                // the earliest sighting decides where its puzzle is reported
+                if (slot.exchange(key, std::memory_order_relaxed) == key) {
+                    ++w.stats.cached;
+                    w.sightings.push_back({key, block, line_index, ply});
+                } else {
+                    ++w.stats.verified;
+                    auto search_start = std::chrono::steady_clock::now();
+                    w.position->initFromCompact(board.toCompact());
+                    Puzzle puzzle;
+                    if (verify(w, puzzle)) {
+                        w.puzzles.push_back(std::move(puzzle));
+                        w.sightings.push_back({key, block, line_index, ply});
+                    }
+                    w.stats.verifySeconds +=
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - search_start).count();
+                }
+            }
+            if (ply == w.moves.size()) {
+                return;
+            }
+            Move m = w.moves[ply];
+            if (!board.isLegalMove(m)) {
+                ++w.stats.invalidGames;
+                return;
+            }
+            blunder = board.staticExchange(m) <= -options.minGain; // the move gives material away
+            recapture = board.isPositionOccupied(m.to) ? m.to : -1;
+            MoveUndo undo;
+            board.makeMove(m, undo);
+        }
+    };
+
+    GameFileReader reader(game_files, size_t{1} << 20);
+    std::counting_semaphore<> free_blocks(static_cast<std::ptrdiff_t>(2 * pool.size()));
+    try {
+        string text;
+        for (uint64_t index{0}; !error.any() && reader.next(text); ++index) {
+            auto block = std::make_shared<string>(std::move(text));
+            free_blocks.acquire();
+            pool.submit([&, block, index] {
+                error.run([&] {
+                    Worker& w = workers[static_cast<size_t>(ThreadPool::currentWorker())];
+                    uint64_t line_index{0};
+                    forEachGameLine(*block, [&](string_view line) { mine_game(w, line, index, line_index++); });
+                });
+                free_blocks.release();
+            });
+            if (on_progress) {
+                on_progress(reader.bytesRead());
+            }
+        }
+    } catch (...) {
+        pool.wait(); // the tasks still use this frame
+        throw;
+    }
+    pool.wait();
+    error.rethrow();
+
+    // a puzzle verified in several games comes out the same from each
+    std::unordered_map<uint64_t, std::pair<Sighting, const Puzzle*>> found;
+    for (const Worker& w : workers) {
+        for (const Puzzle& puzzle : w.puzzles) {
+            if (!found.try_emplace(puzzle.key, Sighting{puzzle.key, UINT64_MAX}, &puzzle).second) {
+                ++totals.duplicates;
+            }
+        }
+    }
+    for (const Worker& w : workers) {
+        for (const Sighting& s : w.sightings) {
+            auto it = found.find(s.key);
+            if (it != found.end() && s < it->second.first) {
+                it->second.first = s;
+            }
+        }
+    }
+    vector<std::pair<Sighting, const Puzzle*>> ordered;
+    ordered.reserve(found.size());
+    for (const auto& [key, entry] : found) {
+        ordered.push_back(entry);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    totals.puzzles = ordered.size();
+    if (on_puzzle) {
+        for (const auto& [sighting, puzzle] : ordered) {
+            on_puzzle(*puzzle);
+        }
+    }
+
+    for (const Worker& w : workers) {
+        totals.games += w.stats.games;
+        totals.invalidGames += w.stats.invalidGames;
+        totals.positions += w.stats.positions;
+        totals.candidates += w.stats.candidates;
+        totals.cached += w.stats.cached;
+        totals.verified += w.stats.verified;
+        totals.verifySeconds += w.stats.verifySeconds;
+    }
+    totals.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return totals;
+}
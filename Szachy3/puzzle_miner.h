@@ -0,0 +1,95 @@
+#ifndef PUZZLE_MINER_H
+#define PUZZLE_MINER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "search.h"
+
+struct PuzzleOptions {
+    // Cheap filters: a position is searched only if the side to move can
+    // capture a piece winning at least minGain pawns by static exchange
+    // (other than by taking back on the square just captured on), if
+    // the opponent's king has at most one escape and a check can take it
+    // away, or if the move that led to it gave away minGain pawns.
+    int minGain{2};
+    // Verification: a fixed-depth two-line search. The best move must score
+    // minScore centipawns and the second best at least minMargin less, or
+    // the best must mate in at most maxMateMoves while the second does not.
+    int depth{6};
+    uint64_t nodes{0}; // per search, 0 - unlimited
+    size_t hashMegabytes{4};
+    int minScore{250};
+    int minMargin{150};
+    int maxMateMoves{5};
+    // Solution lines follow the search's line while each solver move is
+    // still unique by minMargin, up to this many solver moves (mates are
+    // always given in full).
+    int maxSolutionMoves{4};
+    // Positions verified recently, so positions repeated across games are
+    // searched once; a lossy table of this many keys. Positions are verified
+    // without the game's history, so the verdict depends on the key alone.
+    size_t cacheEntries{size_t{1} << 20};
+    size_t threads{std::thread::hardware_concurrency()};
+};
+
+struct Puzzle {
+    uint64_t key{0}; // Board::getPositionKey, puzzles are unique by it
+    string fen; // the solver is to move, halfmove clock 0
+    vector<Move> solution; // solver, opponent, solver, ..., ending with a solver move
+    int score{0}; // best move's score in centipawns for the solver, or a mate score
+    [[nodiscard]] bool isMate() const;
+    [[nodiscard]] int mateIn() const; // solver moves, mates only
+};
+
+struct MiningStats {
+    uint64_t games{0};
+    uint64_t invalidGames{0};
+    uint64_t positions{0};
+    uint64_t candidates{0}; // positions passing the cheap filters
+    uint64_t cached{0}; // candidates verified before, skipped
+    uint64_t verified{0}; // candidates searched
+    uint64_t puzzles{0};
+    uint64_t duplicates{0}; // puzzles verified again in another game
+    double seconds{0.0};
+    double verifySeconds{0.0}; // search time summed over the threads
+};
+
+// Replays game files (see game_file.h) on a ThreadPool and reports the
+// tactical puzzles found in them. Every position of every game goes through
+// the cheap filters, which use the incremental attack map and need no move
+// generation except to look for checks against a boxed-in king. Candidates
+// are verified with Searcher, and each accepted puzzle's solution is
+// extended while its next solver move stays unique. The puzzles reported do
+// not depend on the thread count.
+class PuzzleMiner {
+private:
+    struct Worker;
+    struct Sighting;
+    PuzzleOptions options;
+    vector<std::atomic<uint64_t>> verifiedKeys; // direct-mapped by key
+
+    // recapture: the square the last move captured on, -1 after a quiet move
+    bool isCandidate(Board& board, bool blunder, int recapture, vector<Move>& moves);
+    bool verify(Worker& w, Puzzle& puzzle);
+    void extendSolution(Worker& w, Puzzle& puzzle, const vector<Move>& pv);
+public:
+    explicit PuzzleMiner(const PuzzleOptions& options = {});
+
+    // Called once every game is mined, once per distinct puzzle, in the
+    // order the puzzles first occur in the game files.
+    using PuzzleCallback = std::function<void(const Puzzle&)>;
+    // Called with the bytes of game files read so far.
+    using ProgressCallback = std::function<void(uint64_t bytes)>;
+
+    MiningStats mine(std::span<const string> game_files, const PuzzleCallback& on_puzzle,
+                     const ProgressCallback& on_progress = {});
+};
+
+#endif // PUZZLE_MINER_H
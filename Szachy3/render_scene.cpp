@@ -0,0 +1,233 @@
+#include "render_scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    constexpr std::wstring_view letters[] = {L"A", L"B", L"C", L"D", L"E", L"F", L"G", L"H"};
+    constexpr std::wstring_view numbers[] = {L"1", L"2", L"3", L"4", L"5", L"6", L"7", L"8"};
+    // dirty rectangles covering more than this part of the viewport become one full redraw
+    constexpr float full_redraw_fraction{0.5f};
+
+    int pieceBitmap(char symbol) {
+        constexpr const char* order = "PRNBQKprnbqk";
+        const char* found = std::strchr(order, symbol);
+        return (symbol != '\0' && found) ? static_cast<int>(found - order) : -1;
+    }
+
+    uint64_t mix(uint64_t h, uint64_t value) {
+        h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    uint64_t floatBits(float f) {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    uint64_t hashCommand(const SceneCommand& c) {
+        uint64_t h = mix(static_cast<uint64_t>(c.type), c.bitmap);
+        h = mix(h, static_cast<uint64_t>(c.font));
+        for (float f : {c.target.left, c.target.top, c.target.right, c.target.bottom, c.scaleX, c.scaleY}) {
+            h = mix(h, floatBits(f));
+        }
+        return mix(h, std::hash<std::wstring_view>{}(c.text));
+    }
+
+    // Whole pixels, one more on each side for antialiased edges, clipped to the viewport.
+    SceneRect pixelAligned(const SceneRect& r, const SceneRect& viewport) {
+        return {std::max(std::floor(r.left) - 1.0f, viewport.left), std::max(std::floor(r.top) - 1.0f, viewport.top),
+                std::min(std::ceil(r.right) + 1.0f, viewport.right), std::min(std::ceil(r.bottom) + 1.0f, viewport.bottom)};
+    }
+
+    bool touches(const SceneRect& a, const SceneRect& b) {
+        return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+    }
+
+    // Merges rectangles that overlap or share an edge, until none do.
+    void mergeTouching(vector<SceneRect>& rects) {
+        bool merged{true};
+        while (merged) {
+            merged = false;
+            for (size_t i{0}; i < rects.size() && !merged; ++i) {
+                for (size_t j{i + 1}; j < rects.size(); ++j) {
+                    if (touches(rects[i], rects[j])) {
+                        rects[i] = rects[i].united(rects[j]);
+                        rects.erase(rects.begin() + static_cast<std::ptrdiff_t>(j));
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+SceneRect SceneRect::united(const SceneRect& other) const {
+    if (empty()) {
+        return other;
+    }
+    if (other.empty()) {
+        return *this;
+    }
+    return {std::min(left, other.left), std::min(top, other.top), std::max(right, other.right), std::max(bottom, other.bottom)};
+}
+
+SceneRect SceneCommand::bounds() const {
+    float half_width = 0.5f * (target.right - target.left) * std::abs(scaleX);
+    float half_height = 0.5f * (target.bottom - target.top) * std::abs(scaleY);
+    float center_x = 0.5f * (target.left + target.right);
+    float center_y = 0.5f * (target.top + target.bottom);
+    return {center_x - half_width, center_y - half_height, center_x + half_width, center_y + half_height};
+}
+
+void RenderScene::clear() {
+    commands.clear();
+}
+
+void RenderScene::add(const SceneCommand& command) {
+    commands.push_back(command);
+}
+
+const vector<SceneCommand>& RenderScene::getCommands() const {
+    return commands;
+}
+
+void RenderScene::build(const BoardSceneState& state) {
+    commands.clear();
+    const auto& squares = state.squares;
+    float tile = squares[0].right - squares[0].left;
+    auto bitmap = [&](int id, const SceneRect& target, float scale_x = 1.0f, float scale_y = 1.0f) {
+        commands.push_back({SceneCommandType::BITMAP, static_cast<uint16_t>(id), SceneFont::MESSAGE, target, scale_x, scale_y, {}});
+    };
+    auto text = [&](std::wstring_view s, SceneFont font, const SceneRect& box) {
+        commands.push_back({SceneCommandType::TEXT, 0, font, box, 1.0f, 1.0f, s});
+    };
+
+    for (int i{0}; i < 8; ++i) {
+        for (int j{0}; j < 8; ++j) {
+            bitmap(scene_tile_bitmaps + (i + j) % 2, squares[i * 8 + j]);
+        }
+    }
+    for (int i{0}; i < 8; ++i) {
+        const SceneRect& first = squares[i * 8];
+        text(numbers[i], SceneFont::COORDINATES, {first.left - tile / 2.5f, first.top + tile / 3, first.left, first.bottom});
+    }
+    for (int i{0}; i < 8; ++i) {
+        const SceneRect& square = squares[i];
+        text(letters[i], SceneFont::COORDINATES, {square.left + tile / 2.5f, square.bottom, square.right, square.bottom + tile});
+    }
+    for (int index{0}; index < 64; ++index) {
+        char symbol = state.position.squares[index];
+        if ((symbol == 'K' && state.position.whiteChecked) || (symbol == 'k' && state.position.blackChecked)) {
+            bitmap(scene_tile_bitmaps + 2, squares[index]);
+        }
+    }
+    int picked_bitmap{-1};
+    for (int index{0}; index < 64; ++index) {
+        int piece = pieceBitmap(state.position.squares[index]);
+        if (piece < 0) {
+            continue;
+        }
+        if (index == state.picked) {
+            picked_bitmap = piece;
+        } else if (index == state.pulsing) {
+            bitmap(scene_piece_bitmaps + piece, squares[index], 1.0f + 0.5f * std::sin(state.pulse), 0.5f + std::sin(state.pulse));
+        } else {
+            bitmap(scene_piece_bitmaps + piece, squares[index]);
+        }
+    }
+    if (picked_bitmap >= 0) {
+        float half = tile / 2.0f;
+        bitmap(scene_piece_bitmaps + picked_bitmap, {state.mouseX - half, state.mouseY - half, state.mouseX + half, state.mouseY + half});
+    }
+    if (!state.message.empty()) {
+        text(state.message, SceneFont::MESSAGE, state.messageBox);
+    }
+}
+
+vector<SceneRect> diffScenes(const RenderScene& previous, const RenderScene& next, const SceneRect& viewport, size_t max_rects) {
+    const auto& before = previous.getCommands();
+    const auto& after = next.getCommands();
+    std::unordered_map<uint64_t, vector<size_t>> earlier;
+    earlier.reserve(before.size());
+    for (size_t i{0}; i < before.size(); ++i) {
+        earlier[hashCommand(before[i])].push_back(i);
+    }
+    vector<bool> matched(before.size(), false);
+    vector<SceneRect> dirty;
+    auto mark = [&](const SceneCommand& c) {
+        SceneRect r = pixelAligned(c.bounds(), viewport);
+        if (!r.empty()) {
+            dirty.push_back(r);
+        }
+    };
+
+    // match each command to an equal one of the previous frame, keeping the stacking order
+    std::ptrdiff_t last_matched{-1};
+    for (const SceneCommand& c : after) {
+        auto bucket = earlier.find(hashCommand(c));
+        std::ptrdiff_t in_order{-1};
+        std::ptrdiff_t out_of_order{-1};
+        if (bucket != earlier.end()) {
+            for (size_t i : bucket->second) {
+                if (matched[i] || !(before[i] == c)) {
+                    continue;
+                }
+                if (static_cast<std::ptrdiff_t>(i) > last_matched) {
+                    in_order = static_cast<std::ptrdiff_t>(i);
+                    break;
+                }
+                if (out_of_order < 0) {
+                    out_of_order = static_cast<std::ptrdiff_t>(i);
+                }
+            }
+        }
+        if (in_order >= 0) {
+            matched[static_cast<size_t>(in_order)] = true;
+            last_matched = in_order;
+        } else {
+            if (out_of_order >= 0) {
+                matched[static_cast<size_t>(out_of_order)] = true; // same command, new place in the stack
+            }
+            mark(c);
+        }
+    }
+    for (size_t i{0}; i < before.size(); ++i) {
+        if (!matched[i]) {
+            mark(before[i]);
+        }
+    }
+
+    mergeTouching(dirty);
+    while (dirty.size() > max_rects) {
+        // merge the pair that adds the least area
+        size_t best_i{0};
+        size_t best_j{1};
+        float best_cost = std::numeric_limits<float>::max();
+        for (size_t i{0}; i < dirty.size(); ++i) {
+            for (size_t j{i + 1}; j < dirty.size(); ++j) {
+                float cost = dirty[i].united(dirty[j]).area() - dirty[i].area() - dirty[j].area();
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        dirty[best_i] = dirty[best_i].united(dirty[best_j]);
+        dirty.erase(dirty.begin() + static_cast<std::ptrdiff_t>(best_j));
+        mergeTouching(dirty);
+    }
+    float total{0.0f};
+    for (const SceneRect& r : dirty) {
+        total += r.area();
+    }
+    if (total > full_redraw_fraction * viewport.area()) {
+        return {viewport};
+    }
+    return dirty;
+}
@@ -0,0 +1,91 @@
+#ifndef RENDER_SCENE_H
+#define RENDER_SCENE_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "board_snapshot.h"
+
+using std::vector;
+
+// Same fields as D2D1_RECT_F, so a backend can pass it straight through.
+struct SceneRect {
+    float left{0.0f};
+    float top{0.0f};
+    float right{0.0f};
+    float bottom{0.0f};
+
+    [[nodiscard]] bool empty() const { return right <= left || bottom <= top; }
+    [[nodiscard]] float area() const { return empty() ? 0.0f : (right - left) * (bottom - top); }
+    [[nodiscard]] bool intersects(const SceneRect& other) const {
+        return left < other.right && other.left < right && top < other.bottom && other.top < bottom;
+    }
+    [[nodiscard]] SceneRect united(const SceneRect& other) const;
+    bool operator==(const SceneRect&) const = default;
+};
+
+enum class SceneCommandType : uint8_t {
+    BITMAP,
+    TEXT
+};
+
+// Bitmaps are numbered like DrawingChessboardInterface::PieceBitmaps, then its TileBitmaps.
+constexpr uint16_t scene_piece_bitmaps{0}; // + index of the piece in "PRNBQKprnbqk"
+constexpr uint16_t scene_tile_bitmaps{12}; // + 0 white tile, 1 black tile, 2 check overlay
+
+enum class SceneFont : uint8_t {
+    MESSAGE, // the big turn message
+    COORDINATES
+};
+
+// One draw call of a frame. Two equal commands draw the same pixels, so
+// frames are compared command by command instead of pixel by pixel.
+struct SceneCommand {
+    SceneCommandType type{SceneCommandType::BITMAP};
+    uint16_t bitmap{0};
+    SceneFont font{SceneFont::MESSAGE};
+    SceneRect target; // bitmap destination or text layout box
+    float scaleX{1.0f}; // scaling about the centre of target (the pulse animation)
+    float scaleY{1.0f};
+    std::wstring_view text; // must outlive the scene; the GUI's strings are static
+
+    // Everything the command can touch on screen.
+    [[nodiscard]] SceneRect bounds() const;
+    bool operator==(const SceneCommand&) const = default;
+};
+
+// What the GUI shows, independent of how it is drawn.
+struct BoardSceneState {
+    BoardSnapshot position;
+    std::array<SceneRect, 64> squares{}; // screen rectangle of every square, row 0 at the bottom
+    int picked{-1}; // square of the piece being dragged
+    float mouseX{0.0f};
+    float mouseY{0.0f};
+    int pulsing{-1}; // square of the pulsing piece
+    float pulse{0.0f};
+    std::wstring_view message;
+    SceneRect messageBox{100.0f, 100.0f, 1000.0f, 1000.0f};
+};
+
+// Retained list of draw commands for one frame, back to front.
+class RenderScene {
+private:
+    vector<SceneCommand> commands;
+public:
+    void clear();
+    void add(const SceneCommand& command);
+    [[nodiscard]] const vector<SceneCommand>& getCommands() const;
+    // Builds the frame DrawingChessboardInterface::drawChessboard draws.
+    void build(const BoardSceneState& state);
+};
+
+// Rectangles, in whole pixels and clipped to viewport, that cover every pixel
+// that differs between the two frames: the bounds of the commands only one
+// frame has, and of the common ones whose stacking order changed. Nearby
+// rectangles are merged until at most max_rects remain; when they would
+// cover most of the viewport, the viewport itself is returned.
+vector<SceneRect> diffScenes(const RenderScene& previous, const RenderScene& next, const SceneRect& viewport,
+                             size_t max_rects = 8);
+
+#endif // RENDER_SCENE_H
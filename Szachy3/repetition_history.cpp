@@ -0,0 +1,48 @@
+#include "repetition_history.h"
+#include <algorithm>
+
+void RepetitionHistory::reset(uint64_t key, int halfmove_clock) {
+    keys.clear();
+    clocks.clear();
+    filter.fill(0);
+    keys.push_back(key);
+    clocks.push_back(static_cast<uint16_t>(std::clamp(halfmove_clock, 0, UINT16_MAX)));
+    ++filter[key % filter_size];
+}
+
+void RepetitionHistory::push(uint64_t key, bool irreversible) {
+    uint16_t clock = (irreversible || clocks.empty()) ? 0 : static_cast<uint16_t>(std::min(clocks.back() + 1, UINT16_MAX));
+    keys.push_back(key);
+    clocks.push_back(clock);
+    ++filter[key % filter_size];
+}
+
+void RepetitionHistory::pop() {
+    --filter[keys.back() % filter_size];
+    keys.pop_back();
+    clocks.pop_back();
+}
+
+int RepetitionHistory::repetitions() const {
+    if (keys.empty() || filter[keys.back() % filter_size] < 2) {
+        return 0;
+    }
+    // only positions with the same side to move, after the last irreversible move
+    size_t last = keys.size() - 1;
+    size_t window = std::min<size_t>(clocks.back(), last);
+    int count{0};
+    for (size_t back{2}; back <= window; back += 2) {
+        if (keys[last - back] == keys[last]) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int RepetitionHistory::halfmoveClock() const {
+    return clocks.empty() ? 0 : clocks.back();
+}
+
+size_t RepetitionHistory::size() const {
+    return keys.size();
+}
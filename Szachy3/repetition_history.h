@@ -0,0 +1,30 @@
+#ifndef REPETITION_HISTORY_H
+#define REPETITION_HISTORY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Position keys of the game and of the line being searched, one per ply, as
+// a stack that Board::makeMove pushes and Board::unmakeMove pops. A small
+// table counts the keys on the stack by their low bits, so most probes
+// answer "no repetition" without looking at the stack; the rest only scan
+// back to the last capture or pawn move.
+class RepetitionHistory {
+private:
+    static constexpr size_t filter_size{4096};
+    std::vector<uint64_t> keys;
+    std::vector<uint16_t> clocks; // plies since the last capture or pawn move
+    std::array<uint16_t, filter_size> filter{};
+public:
+    void reset(uint64_t key, int halfmove_clock = 0);
+    void push(uint64_t key, bool irreversible);
+    void pop();
+    // Earlier occurrences of the current position that can still repeat it.
+    [[nodiscard]] int repetitions() const;
+    [[nodiscard]] int halfmoveClock() const;
+    [[nodiscard]] size_t size() const;
+};
+
+#endif // REPETITION_HISTORY_H
@@ -0,0 +1,471 @@
+#include "search.h"
+#include <algorithm>
+#include <bit>
+#include "evaluation.h"
+#include "search_stats.h"
+#include "trace.h"
+
+namespace {
+    constexpr uint64_t initial_clock_check_interval{64}; // nodes between clock checks before adapting
+    constexpr uint64_t max_clock_check_interval{4096};
+    constexpr std::chrono::microseconds clock_check_period{200}; // bounds how late a hard time limit is noticed
+
+    int scoreToTT(int score, int ply) {
+        if (score > mate_score - max_ply) {
+            return score + ply;
+        }
+        if (score < -mate_score + max_ply) {
+            return score - ply;
+        }
+        return score;
+    }
+
+    int scoreFromTT(int score, int ply) {
+        if (score > mate_score - max_ply) {
+            return score - ply;
+        }
+        if (score < -mate_score + max_ply) {
+            return score + ply;
+        }
+        return score;
+    }
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+    resize(megabytes);
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    size_t count = std::max<size_t>(1, megabytes * 1024 * 1024 / sizeof(TTEntry));
+    entries.assign(std::bit_floor(count), TTEntry{});
+}
+
+void TranspositionTable::clear() {
+    std::fill(entries.begin(), entries.end(), TTEntry{});
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry& entry) const {
+    const TTEntry& e = entries[key & (entries.size() - 1)];
+    if (e.bound == Bound::NONE || e.key != key) {
+        return false;
+    }
+    entry = e;
+    return true;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score, Bound bound, Move best) {
+    TTEntry& e = entries[key & (entries.size() - 1)];
+    if (e.key == key && e.bound != Bound::NONE && depth < e.depth && bound != Bound::EXACT) {
+        return;
+    }
+    if (best.isNull() && e.key == key) {
+        best = e.move();
+    }
+    e.key = key;
+    e.score = static_cast<int16_t>(score);
+    e.depth = static_cast<int8_t>(std::clamp(depth, 0, 127));
+    e.bound = bound;
+    e.from = static_cast<int8_t>(best.from);
+    e.to = static_cast<int8_t>(best.to);
+}
+
+void TranspositionTable::store(const TTEntry& entry) {
+    TTEntry& e = entries[entry.key & (entries.size() - 1)];
+    if (e.key == entry.key && e.bound != Bound::NONE && entry.depth < e.depth) {
+        return;
+    }
+    e = entry;
+}
+
+Searcher::Searcher(const SearchOptions& options) : options(options), tt(options.hashMegabytes) {
+    for (auto& moves : moveLists) {
+        moves.reserve(128);
+    }
+}
+
+void Searcher::stop() {
+    stopRequested.store(true, std::memory_order_relaxed);
+}
+
+void Searcher::newGame() {
+    tt.clear();
+    killers = {};
+    history = {};
+    exports.clear();
+}
+
+void Searcher::takeExports(vector<TTEntry>& out) {
+    out.clear();
+    out.swap(exports);
+}
+
+void Searcher::importEntry(const TTEntry& entry) {
+    tt.store(entry);
+}
+
+int Searcher::searchWindow(Board& board, int depth, int alpha, int beta, uint64_t& nodes_searched) {
+    limits = SearchLimits{};
+    startClock();
+    stopRequested.store(false, std::memory_order_relaxed);
+    stopped = false;
+    nodes = 0;
+    int score = negamax(board, std::min(depth, max_ply - 1), 0, alpha, beta);
+    nodes_searched = nodes;
+    return score;
+}
+
+void Searcher::startClock() {
+    startTime = std::chrono::steady_clock::now();
+    lastClockCheck = startTime;
+    clockCheckInterval = initial_clock_check_interval;
+    nextClockCheck = clockCheckInterval;
+    hasDeadline = limits.moveTime.count() != 0;
+    deadline = startTime + limits.moveTime;
+}
+
+void Searcher::checkLimits() {
+    if (stopRequested.load(std::memory_order_relaxed) || limits.stopToken.stop_requested()) {
+        stopped = true;
+        return;
+    }
+    if (limits.nodes != 0 && nodes >= limits.nodes) {
+        stopped = true;
+        return;
+    }
+    if (hasDeadline && nodes >= nextClockCheck) {
+        auto now = std::chrono::steady_clock::now();
+        auto since_last = now - lastClockCheck;
+        if (since_last > clock_check_period && clockCheckInterval > 1) {
+            clockCheckInterval /= 2;
+        } else if (since_last < clock_check_period / 4 && clockCheckInterval < max_clock_check_interval) {
+            clockCheckInterval *= 2;
+        }
+        lastClockCheck = now;
+        nextClockCheck = nodes + clockCheckInterval;
+        if (now >= deadline) {
+            stopped = true;
+        }
+    }
+}
+
+void Searcher::orderMoves(Board& board, vector<Move>& moves, Move tt_move, int ply) {
+    std::array<int, 256> scores{};
+    size_t n = std::min(moves.size(), scores.size());
+    for (size_t i{0}; i < n; ++i) {
+        Move m = moves[i];
+        if (m == tt_move) {
+            scores[i] = 1000000;
+        } else if (board.isPositionOccupied(m.to)) {
+            int victim = piece_values[static_cast<int>(board.getPiece(m.to)->getType())];
+            int attacker = piece_values[static_cast<int>(board.getPiece(m.from)->getType())];
+            scores[i] = 100000 + 10 * victim - attacker / 10;
+        } else if (ply < max_ply && (m == killers[ply][0] || m == killers[ply][1])) {
+            scores[i] = (m == killers[ply][0]) ? 90001 : 90000;
+        } else {
+            scores[i] = std::min(history[m.from][m.to], 89999);
+        }
+    }
+    // move lists are short, insertion sort keeps equal moves in generation order
+    for (size_t i{1}; i < n; ++i) {
+        Move m = moves[i];
+        int s = scores[i];
+        size_t j{i};
+        for (; j > 0 && scores[j - 1] < s; --j) {
+            moves[j] = moves[j - 1];
+            scores[j] = scores[j - 1];
+        }
+        moves[j] = m;
+        scores[j] = s;
+    }
+}
+
+int Searcher::quiesce(Board& board, int ply, int alpha, int beta) {
+    ++nodes;
+    STATS_INC(QNODES);
+    checkLimits();
+    if (stopped) {
+        return 0;
+    }
+    pvLength[ply] = ply;
+    int stand_pat = evaluate(board);
+    if (ply >= max_ply || stand_pat >= beta) {
+        return stand_pat;
+    }
+    alpha = std::max(alpha, stand_pat);
+
+    vector<Move>& moves = moveLists[ply];
+    moves.clear();
+    board.generateLegalMoves(moves, true);
+    orderMoves(board, moves, {}, ply);
+    MoveUndo undo;
+    for (Move m : moves) {
+        board.makeMove(m, undo);
+        int score = -quiesce(board, ply + 1, -beta, -alpha);
+        board.unmakeMove(undo);
+        if (stopped) {
+            return 0;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (score >= beta) {
+                STATS_INC(CUTOFFS);
+                return score;
+            }
+        }
+    }
+    return alpha;
+}
+
+int Searcher::negamax(Board& board, int depth, int ply, int alpha, int beta) {
+    pvLength[ply] = ply;
+    bool in_check = board.checkIfChecked(board.getTurn());
+    if (in_check && ply < max_ply / 2) {
+        ++depth;
+    }
+    if (depth <= 0) {
+        return options.quiescence ? quiesce(board, ply, alpha, beta) : evaluate(board);
+    }
+    ++nodes;
+    STATS_INC(NODES);
+    checkLimits();
+    if (stopped) {
+        return 0;
+    }
+    if (ply > 0 && (board.isRepetition() || board.isFiftyMoveDraw())) {
+        return 0;
+    }
+    if (ply >= max_ply) {
+        return evaluate(board);
+    }
+
+    bool pv_node = beta - alpha > 1;
+    uint64_t key = board.getPositionKey();
+    TTEntry entry;
+    Move tt_move;
+    STATS_INC(HASH_PROBES);
+    if (tt.probe(key, entry)) {
+        STATS_INC(HASH_HITS);
+        tt_move = entry.move();
+        int tt_score = scoreFromTT(entry.score, ply);
+        if (!pv_node && ply > 0 && entry.depth >= depth &&
+            (entry.bound == Bound::EXACT ||
+             (entry.bound == Bound::LOWER && tt_score >= beta) ||
+             (entry.bound == Bound::UPPER && tt_score <= alpha))) {
+            return tt_score;
+        }
+    }
+
+    vector<Move>& moves = moveLists[ply];
+    moves.clear();
+    board.generateLegalMoves(moves);
+    if (moves.empty()) {
+        return in_check ? -mate_score + ply : 0;
+    }
+    orderMoves(board, moves, tt_move, ply);
+
+    int best_score{-infinite_score};
+    Move best_move;
+    Bound bound{Bound::UPPER};
+    MoveUndo undo;
+    for (size_t i{0}; i < moves.size(); ++i) {
+        Move m = moves[i];
+        bool capture = board.isPositionOccupied(m.to);
+        board.makeMove(m, undo);
+        int score;
+        if (i == 0) {
+            score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+        } else {
+            int reduction{0};
+            if (options.lateMoveReductions && depth >= 3 && i >= 3 && !capture && !in_check) {
+                reduction = (depth >= 6 && i >= 8) ? 2 : 1;
+                STATS_INC(REDUCTIONS);
+            }
+            score = -negamax(board, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+            if (score > alpha && (reduction > 0 || score < beta)) {
+                score = -negamax(board, depth - 1, ply + 1, -beta, -alpha);
+            }
+        }
+        board.unmakeMove(undo);
+        if (stopped) {
+            return 0;
+        }
+        if (score > best_score) {
+            best_score = score;
+            best_move = m;
+            if (score > alpha) {
+                alpha = score;
+                bound = Bound::EXACT;
+                pvTable[ply][ply] = m;
+                for (int next{ply + 1}; next < pvLength[ply + 1]; ++next) {
+                    pvTable[ply][next] = pvTable[ply + 1][next];
+                }
+                pvLength[ply] = std::max(pvLength[ply + 1], ply + 1);
+                if (ply == 0) {
+                    rootScore = score;
+                }
+                if (score >= beta) {
+                    bound = Bound::LOWER;
+                    STATS_INC(CUTOFFS);
+                    if (i == 0) {
+                        STATS_INC(FIRST_MOVE_CUTOFFS);
+                    }
+                    if (!capture) {
+                        if (killers[ply][0] != m) {
+                            killers[ply][1] = killers[ply][0];
+                            killers[ply][0] = m;
+                        }
+                        history[m.from][m.to] += depth * depth;
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    tt.store(key, depth, scoreToTT(best_score, ply), bound, best_move);
+    if (options.exportDepth > 0 && depth >= options.exportDepth) {
+        TTEntry stored;
+        if (tt.probe(key, stored)) {
+            exports.push_back(stored);
+        }
+    }
+    return best_score;
+}
+
+int Searcher::searchLines(Board& board, int depth, size_t line_count) {
+    ++nodes;
+    STATS_INC(NODES);
+    pvLength[0] = 0;
+    if (board.checkIfChecked(board.getTurn())) {
+        ++depth;
+    }
+    // exact holds the best lines found so far, best first; a move has to beat
+    // the last one once there are line_count of them
+    vector<SearchLine> exact;
+    vector<SearchLine> rest;
+    MoveUndo undo;
+    for (SearchLine& line : rootLines) {
+        Move m = line.pv.front();
+        int floor = (exact.size() < line_count) ? -infinite_score : exact.back().score;
+        board.makeMove(m, undo);
+        int score;
+        if (floor == -infinite_score) {
+            score = -negamax(board, depth - 1, 1, -infinite_score, infinite_score);
+        } else {
+            score = -negamax(board, depth - 1, 1, -floor - 1, -floor);
+            if (score > floor && !stopped) {
+                score = -negamax(board, depth - 1, 1, -infinite_score, -floor);
+            }
+        }
+        board.unmakeMove(undo);
+        if (stopped) {
+            return 0;
+        }
+        line.score = score;
+        if (score <= floor) {
+            line.pv.resize(1);
+            rest.push_back(std::move(line));
+            continue;
+        }
+        line.pv.assign(1, m);
+        line.pv.insert(line.pv.end(), pvTable[1].begin() + 1, pvTable[1].begin() + std::max(pvLength[1], 1));
+        auto at = std::upper_bound(exact.begin(), exact.end(), score, [](int s, const SearchLine& l) { return s > l.score; });
+        exact.insert(at, std::move(line));
+        if (exact.size() > line_count) {
+            exact.back().pv.resize(1);
+            rest.push_back(std::move(exact.back()));
+            exact.pop_back();
+        }
+    }
+    // next iteration: this one's lines first, then the rest by their bounds
+    std::stable_sort(rest.begin(), rest.end(), [](const SearchLine& a, const SearchLine& b) { return a.score > b.score; });
+    rootLines = std::move(exact);
+    rootLines.insert(rootLines.end(), std::make_move_iterator(rest.begin()), std::make_move_iterator(rest.end()));
+    tt.store(board.getPositionKey(), depth, scoreToTT(rootLines.front().score, 0), Bound::EXACT, rootLines.front().pv.front());
+    return rootLines.front().score;
+}
+
+SearchResult Searcher::search(Board& board, const SearchLimits& search_limits, const IterationCallback& on_iteration) {
+    limits = search_limits;
+    startClock();
+    stopRequested.store(false, std::memory_order_relaxed);
+    stopped = false;
+    nodes = 0;
+    killers = {};
+    for (auto& row : history) {
+        for (auto& h : row) {
+            h /= 8;
+        }
+    }
+
+    SearchResult result;
+    vector<Move> root_moves;
+    board.generateLegalMoves(root_moves);
+    if (root_moves.empty()) {
+        result.score = board.checkIfChecked(board.getTurn()) ? -mate_score : 0;
+        return result;
+    }
+    result.bestMove = root_moves.front();
+    if (limits.clock) {
+        timeManager.start(*limits.clock, root_moves.size());
+        auto hard_limit = startTime + timeManager.getMaximum();
+        deadline = hasDeadline ? std::min(deadline, hard_limit) : hard_limit;
+        hasDeadline = true;
+    }
+
+    size_t line_count = std::min<size_t>(static_cast<size_t>(std::max(limits.multiPv, 1)), root_moves.size());
+    if (line_count > 1) {
+        TTEntry entry;
+        orderMoves(board, root_moves, tt.probe(board.getPositionKey(), entry) ? entry.move() : Move{}, 0);
+        rootLines.clear();
+        for (Move m : root_moves) {
+            rootLines.push_back({-infinite_score, {m}});
+        }
+    }
+
+    for (int depth{1}; depth <= std::min(limits.depth, max_ply - 1); ++depth) {
+        TRACE_SCOPE("Searcher::iteration");
+        int score = (line_count > 1) ? searchLines(board, depth, line_count) : negamax(board, depth, 0, -infinite_score, infinite_score);
+        if (stopped) {
+            // A partial iteration still improves on the previous one once its
+            // first (the previous best) move has been searched, as the root
+            // line only changes when a move's search completes; the move, its
+            // score and line are taken together. Several lines searched in
+            // part do not make a ranking, so then the last iteration stands.
+            if (line_count == 1 && pvLength[0] > 0 && depth > 1) {
+                result.score = rootScore;
+                result.pv.assign(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]);
+                result.lines.assign(1, {rootScore, result.pv});
+                result.bestMove = result.pv.front();
+            }
+            break;
+        }
+        result.depth = depth;
+        result.score = score;
+        if (line_count > 1) {
+            result.lines.assign(rootLines.begin(), rootLines.begin() + static_cast<std::ptrdiff_t>(line_count));
+            result.pv = result.lines.front().pv;
+        } else {
+            result.pv.assign(pvTable[0].begin(), pvTable[0].begin() + pvLength[0]);
+            result.lines.assign(1, {score, result.pv});
+        }
+        result.bestMove = result.pv.front();
+        result.nodes = nodes;
+        if (on_iteration) {
+            on_iteration(result);
+        }
+        bool mates_resolved = std::all_of(result.lines.begin(), result.lines.end(), [depth](const SearchLine& l) {
+            return isMateScore(l.score) && mate_score - std::abs(l.score) <= depth;
+        });
+        if (mates_resolved) {
+            break;
+        }
+        if (limits.clock) {
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+            if (!timeManager.shouldContinue(depth, result.bestMove, score, elapsed)) {
+                break;
+            }
+        }
+    }
+    result.nodes = nodes;
+    return result;
+}
@@ -0,0 +1,143 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stop_token>
+#include <vector>
+#include "board.h"
+#include "time_manager.h"
+
+constexpr int max_ply{64};
+constexpr int mate_score{30000};
+constexpr int infinite_score{32000};
+
+[[nodiscard]] constexpr bool isMateScore(int score) {
+    return score > mate_score - max_ply || score < -mate_score + max_ply;
+}
+
+enum class Bound : uint8_t {
+    NONE,
+    EXACT,
+    LOWER,
+    UPPER
+};
+
+struct TTEntry {
+    uint64_t key{0};
+    int16_t score{0};
+    int8_t depth{0};
+    Bound bound{Bound::NONE};
+    int8_t from{-1};
+    int8_t to{-1};
+
+    [[nodiscard]] Move move() const { return {from, to}; }
+};
+
+// Shared by all iterations (and all lines of one search); replaced by depth.
+class TranspositionTable {
+private:
+    vector<TTEntry> entries;
+public:
+    explicit TranspositionTable(size_t megabytes = 16);
+    void resize(size_t megabytes);
+    void clear();
+    bool probe(uint64_t key, TTEntry& entry) const;
+    void store(uint64_t key, int depth, int score, Bound bound, Move best);
+    // Stores an entry taken from another table as it is.
+    void store(const TTEntry& entry);
+};
+
+struct SearchLimits {
+    int depth{max_ply - 1};
+    uint64_t nodes{0}; // 0 - unlimited
+    std::chrono::milliseconds moveTime{0}; // 0 - unlimited
+    std::optional<TimeControl> clock{}; // budgets the move from the clock (see TimeManager)
+    int multiPv{1}; // moves to score exactly, for analysis; 1 - only the best move
+    std::stop_token stopToken{}; // a stop request ends the search like Searcher::stop
+};
+
+struct SearchOptions {
+    bool quiescence{true};
+    bool lateMoveReductions{true};
+    size_t hashMegabytes{16};
+    int exportDepth{0}; // hash entries at least this deep are kept for takeExports, 0 - none
+};
+
+// One principal variation of a multi-PV search, scored exactly.
+struct SearchLine {
+    int score{0};
+    vector<Move> pv;
+};
+
+struct SearchResult {
+    Move bestMove;
+    int score{0};
+    int depth{0};
+    uint64_t nodes{0};
+    vector<Move> pv;
+    vector<SearchLine> lines; // best first, SearchLimits::multiPv of them or one per legal move
+};
+
+// Iterative deepening alpha-beta (PVS with quiescence, transposition table,
+// killer and history ordering and late move reductions) over Board's
+// makeMove/unmakeMove. One Searcher per thread; stop() may be called from
+// any thread.
+class Searcher {
+private:
+    SearchOptions options;
+    TranspositionTable tt;
+    std::atomic<bool> stopRequested{false};
+    bool stopped{false};
+    SearchLimits limits;
+    std::chrono::steady_clock::time_point startTime;
+    std::chrono::steady_clock::time_point deadline;
+    bool hasDeadline{false};
+    TimeManager timeManager;
+    // the clock is read every clockCheckInterval nodes, adapted so that reads stay about clock_check_period apart
+    uint64_t clockCheckInterval{0};
+    uint64_t nextClockCheck{0};
+    std::chrono::steady_clock::time_point lastClockCheck;
+    uint64_t nodes{0};
+    std::array<std::array<Move, 2>, max_ply> killers{};
+    std::array<std::array<int, 64>, 64> history{};
+    std::array<vector<Move>, max_ply + 1> moveLists;
+    std::array<std::array<Move, max_ply + 1>, max_ply + 1> pvTable{};
+    std::array<int, max_ply + 1> pvLength{};
+    int rootScore{0}; // of the root line in pvTable[0], set with it
+    vector<TTEntry> exports;
+    vector<SearchLine> rootLines; // every root move, the exact lines of the last iteration first
+
+    void startClock();
+    void checkLimits();
+    void orderMoves(Board& board, vector<Move>& moves, Move tt_move, int ply);
+    int negamax(Board& board, int depth, int ply, int alpha, int beta);
+    int quiesce(Board& board, int ply, int alpha, int beta);
+    int searchLines(Board& board, int depth, size_t line_count);
+public:
+    explicit Searcher(const SearchOptions& options = {});
+
+    // Called after every completed iteration, with all the lines of its depth.
+    // With SearchLimits::multiPv > 1 each iteration is still one pass over
+    // the root moves, with one hash table and move ordering state: the best
+    // multiPv moves get exact scores, the others are only proved worse than
+    // the last of those by a null window search.
+    using IterationCallback = std::function<void(const SearchResult&)>;
+
+    SearchResult search(Board& board, const SearchLimits& limits, const IterationCallback& on_iteration = {});
+    // One fixed-depth search of the position inside (alpha, beta), without
+    // iterative deepening. Used to split a search over several processes.
+    int searchWindow(Board& board, int depth, int alpha, int beta, uint64_t& nodes_searched);
+    void stop();
+    // Forgets everything learned from previous positions.
+    void newGame();
+    // Moves the deep hash entries stored since the last call into out (see SearchOptions::exportDepth).
+    void takeExports(vector<TTEntry>& out);
+    void importEntry(const TTEntry& entry);
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,128 @@
+#include "search_stats.h"
+#include <chrono>
+
+namespace stats {
+    namespace {
+        ThreadStats slots[max_threads];
+        ThreadStats retired; // totals of threads that already exited
+        ThreadStats overflow; // shared (and slightly lossy) once all slots are taken
+        const auto process_start = std::chrono::steady_clock::now();
+
+        constexpr const char* counter_names[counters]{
+            "nodes", "qnodes", "hash_probes", "hash_hits", "pawn_hash_probes", "pawn_hash_hits",
+            "cutoffs", "first_move_cutoffs", "reductions", "moves", "move_generations",
+            "legality_checks", "evaluations"
+        };
+        constexpr const char* phase_names[phases]{"move_generation", "evaluation", "legality"};
+
+        void foldInto(ThreadStats& from, Snapshot& to) {
+            for (int i{0}; i < counters; ++i) {
+                to.counts[i] += from.counts[i].load(std::memory_order_relaxed);
+            }
+            for (int i{0}; i < phases; ++i) {
+                to.phaseNanoseconds[i] += from.phaseNanoseconds[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        // Gives the slot back when its thread exits, keeping the counts.
+        struct SlotOwner {
+            ThreadStats* slot{nullptr};
+            ~SlotOwner() {
+                if (slot == nullptr) {
+                    return;
+                }
+                for (int i{0}; i < counters; ++i) {
+                    retired.counts[i].fetch_add(slot->counts[i].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                for (int i{0}; i < phases; ++i) {
+                    retired.phaseNanoseconds[i].fetch_add(slot->phaseNanoseconds[i].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+                slot->used.store(false, std::memory_order_release);
+                local_slot = &overflow;
+            }
+        };
+
+        double ratio(uint64_t a, uint64_t b) {
+            return (b == 0) ? 0.0 : static_cast<double>(a) / static_cast<double>(b);
+        }
+    }
+
+    ThreadStats& acquireSlot() {
+        thread_local SlotOwner owner;
+        if (owner.slot != nullptr) {
+            return *owner.slot;
+        }
+        for (auto& slot : slots) {
+            bool expected{false};
+            if (!slot.used.load(std::memory_order_relaxed) && slot.used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                owner.slot = &slot;
+                return slot;
+            }
+        }
+        return overflow;
+    }
+
+    uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - process_start).count());
+    }
+
+    uint64_t Snapshot::get(Counter c) const {
+        return counts[static_cast<int>(c)];
+    }
+
+    uint64_t Snapshot::get(Phase p) const {
+        return phaseNanoseconds[static_cast<int>(p)];
+    }
+
+    Snapshot Snapshot::operator-(const Snapshot& since) const {
+        Snapshot diff;
+        for (int i{0}; i < counters; ++i) {
+            diff.counts[i] = counts[i] - since.counts[i];
+        }
+        for (int i{0}; i < phases; ++i) {
+            diff.phaseNanoseconds[i] = phaseNanoseconds[i] - since.phaseNanoseconds[i];
+        }
+        diff.nanoseconds = nanoseconds - since.nanoseconds;
+        return diff;
+    }
+
+    Snapshot snapshot() {
+        Snapshot s;
+        for (auto& slot : slots) {
+            foldInto(slot, s);
+        }
+        foldInto(retired, s);
+        foldInto(overflow, s);
+        s.nanoseconds = now();
+        return s;
+    }
+
+    const char* name(Counter c) {
+        return counter_names[static_cast<int>(c)];
+    }
+
+    const char* name(Phase p) {
+        return phase_names[static_cast<int>(p)];
+    }
+
+    std::string toJson(const Snapshot& s) {
+        double seconds = static_cast<double>(s.nanoseconds) / 1e9;
+        std::string json = "{\"elapsed_ms\":" + std::to_string(s.nanoseconds / 1000000);
+        json += ",\"counters\":{";
+        for (int i{0}; i < counters; ++i) {
+            json += (i == 0 ? "\"" : ",\"") + std::string(counter_names[i]) + "\":" + std::to_string(s.counts[i]);
+        }
+        json += "},\"phase_ms\":{";
+        for (int i{0}; i < phases; ++i) {
+            json += (i == 0 ? "\"" : ",\"") + std::string(phase_names[i]) + "\":" + std::to_string(static_cast<double>(s.phaseNanoseconds[i]) / 1e6);
+        }
+        uint64_t nodes = s.get(Counter::NODES) + s.get(Counter::QNODES);
+        json += "},\"nps\":" + std::to_string(seconds > 0.0 ? static_cast<uint64_t>(static_cast<double>(nodes) / seconds) : 0);
+        json += ",\"hash_hit_rate\":" + std::to_string(ratio(s.get(Counter::HASH_HITS), s.get(Counter::HASH_PROBES)));
+        json += ",\"pawn_hash_hit_rate\":" + std::to_string(ratio(s.get(Counter::PAWN_HASH_HITS), s.get(Counter::PAWN_HASH_PROBES)));
+        json += ",\"first_move_cutoff_rate\":" + std::to_string(ratio(s.get(Counter::FIRST_MOVE_CUTOFFS), s.get(Counter::CUTOFFS)));
+        json += "}";
+        return json;
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef SEARCH_STATS_H
+#define SEARCH_STATS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Per-thread counters and phase timers fed by Board, move generation,
+// evaluation and search. Each thread owns one cache-line aligned slot and is
+// its only writer, so counting is a plain relaxed load/store with no sharing;
+// any other thread may read the totals at any time through snapshot().
+//
+// Everything is compiled in only when SZACHY_STATS is defined. Otherwise the
+// STATS_* macros expand to nothing and cost nothing.
+namespace stats {
+    enum class Counter {
+        NODES,
+        QNODES,
+        HASH_PROBES,
+        HASH_HITS,
+        PAWN_HASH_PROBES,
+        PAWN_HASH_HITS,
+        CUTOFFS,
+        FIRST_MOVE_CUTOFFS,
+        REDUCTIONS,
+        MOVES,
+        MOVE_GENERATIONS,
+        LEGALITY_CHECKS,
+        EVALUATIONS,
+        COUNT
+    };
+
+    enum class Phase {
+        MOVE_GENERATION,
+        EVALUATION,
+        LEGALITY,
+        COUNT
+    };
+
+    constexpr int counters{static_cast<int>(Counter::COUNT)};
+    constexpr int phases{static_cast<int>(Phase::COUNT)};
+    constexpr int max_threads{256};
+    constexpr size_t cache_line{64};
+
+    struct alignas(cache_line) ThreadStats {
+        std::array<std::atomic<uint64_t>, counters> counts{};
+        std::array<std::atomic<uint64_t>, phases> phaseNanoseconds{};
+        std::atomic<bool> used{false};
+    };
+
+    // Plain totals, taken at one point in time. The difference of two
+    // snapshots describes what happened in between (e.g. one search).
+    struct Snapshot {
+        std::array<uint64_t, counters> counts{};
+        std::array<uint64_t, phases> phaseNanoseconds{};
+        uint64_t nanoseconds{0}; // time since process start, or elapsed time for a difference
+
+        [[nodiscard]] uint64_t get(Counter c) const;
+        [[nodiscard]] uint64_t get(Phase p) const;
+        Snapshot operator-(const Snapshot& since) const;
+    };
+
+    // nanoseconds since process start, from a monotonic clock
+    uint64_t now();
+
+    ThreadStats& acquireSlot();
+    inline thread_local ThreadStats* local_slot{nullptr};
+
+    inline ThreadStats& localSlot() {
+        if (local_slot == nullptr) {
+            local_slot = &acquireSlot();
+        }
+        return *local_slot;
+    }
+
+    inline void add(Counter c, uint64_t n) {
+        auto& counter = localSlot().counts[static_cast<int>(c)];
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline void increment(Counter c) {
+        add(c, 1);
+    }
+
+    inline void addTime(Phase p, uint64_t nanoseconds) {
+        auto& time = localSlot().phaseNanoseconds[static_cast<int>(p)];
+        time.store(time.load(std::memory_order_relaxed) + nanoseconds, std::memory_order_relaxed);
+    }
+
+    class PhaseTimer {
+    private:
+        Phase phase;
+        uint64_t start;
+    public:
+        explicit PhaseTimer(Phase p) : phase(p), start(now()) {}
+        ~PhaseTimer() { addTime(phase, now() - start); }
+        PhaseTimer(const PhaseTimer&) = delete;
+        PhaseTimer& operator=(const PhaseTimer&) = delete;
+    };
+
+    // Sum over all threads, including threads that already exited.
+    Snapshot snapshot();
+
+    // JSON object with raw counts, phase times and derived rates (nodes per
+    // second, hash hit rate, first move cutoff rate). Pass the difference of
+    // two snapshots to export a single search.
+    std::string toJson(const Snapshot& s);
+
+    const char* name(Counter c);
+    const char* name(Phase p);
+}
+
+#ifdef SZACHY_STATS
+#define STATS_INC(counter) ::stats::increment(::stats::Counter::counter)
+#define STATS_ADD(counter, n) ::stats::add(::stats::Counter::counter, (n))
+#define STATS_PHASE(phase) ::stats::PhaseTimer stats_phase_timer(::stats::Phase::phase)
+#else
+#define STATS_INC(counter) ((void)0)
+#define STATS_ADD(counter, n) ((void)0)
+#define STATS_PHASE(phase) ((void)0)
+#endif
+
+#endif // SEARCH_STATS_H
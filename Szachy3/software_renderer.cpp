@@ -0,0 +1,242 @@
+#include "software_renderer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SOFTWARE_RENDERER_SSE2
+#endif
+
+namespace {
+    const char* pieces_file_names[SpriteSet::piece_count] = {"white-pawn.png", "white-rook.png",
+        "white-knight.png", "white-bishop.png", "white-queen.png", "white-king.png", "black-pawn.png",
+        "black-rook.png", "black-knight.png", "black-bishop.png", "black-queen.png", "black-king.png"};
+    const char* tiles_file_names[3] = {"white-tile.bmp", "black-tile.bmp", "transparent_red_for_check.bmp"};
+
+    constexpr uint32_t background_color{0xffffffe0}; // LightCyan, as the GUI clears its window
+    constexpr uint32_t text_color{0xff000000};
+
+    // 5x7 glyphs for the coordinates, one byte per row, bit 4 is the leftmost column.
+    constexpr uint8_t glyphs[16][7] = {
+        {0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // A
+        {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}, // B
+        {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}, // C
+        {0x1e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1e}, // D
+        {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}, // E
+        {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10}, // F
+        {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f}, // G
+        {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // H
+        {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}, // 1
+        {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}, // 2
+        {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}, // 3
+        {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}, // 4
+        {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}, // 5
+        {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}, // 6
+        {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+        {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}, // 8
+    };
+
+    int margin(const RenderOptions& options) {
+        return options.coordinates ? options.tileSize / 2 : 0;
+    }
+
+    void drawGlyph(Image& target, int glyph, int x, int y, int scale) {
+        for (int gy{0}; gy < 7; ++gy) {
+            for (int gx{0}; gx < 5; ++gx) {
+                if (!(glyphs[glyph][gy] & (0x10 >> gx))) {
+                    continue;
+                }
+                for (int sy{0}; sy < scale; ++sy) {
+                    int py = y + gy * scale + sy;
+                    if (py < 0 || py >= target.height) {
+                        continue;
+                    }
+                    uint32_t* row = target.row(py);
+                    for (int sx{0}; sx < scale; ++sx) {
+                        int px = x + gx * scale + sx;
+                        if (px >= 0 && px < target.width) {
+                            row[px] = text_color;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // premultiplied "over" for one pixel: dst = src + dst * (255 - src.a) / 255
+    inline uint32_t blendPixel(uint32_t src, uint32_t dst) {
+        uint32_t inverse = 255 - (src >> 24);
+        if (inverse == 0) {
+            return src;
+        }
+        uint32_t out{0};
+        for (int shift{0}; shift < 32; shift += 8) {
+            uint32_t x = ((dst >> shift) & 0xff) * inverse + 128;
+            x = (x + (x >> 8)) >> 8;
+            out |= std::min<uint32_t>(((src >> shift) & 0xff) + x, 255) << shift;
+        }
+        return out;
+    }
+
+    void blendRow(uint32_t* dst, const uint32_t* src, int count) {
+        int i{0};
+#ifdef SOFTWARE_RENDERER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i all_255 = _mm_set1_epi16(255);
+        const __m128i round = _mm_set1_epi16(128);
+        const __m128i alpha_mask = _mm_set1_epi32(static_cast<int>(0xff000000u));
+        for (; i + 4 <= count; i += 4) {
+            __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            __m128i alpha = _mm_and_si128(s, alpha_mask);
+            // sprites are mostly fully transparent or fully opaque
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, _mm_setzero_si128())) == 0xffff) {
+                continue;
+            }
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(alpha, alpha_mask)) == 0xffff) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), s);
+                continue;
+            }
+            __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+            __m128i s_low = _mm_unpacklo_epi8(s, zero);
+            __m128i s_high = _mm_unpackhi_epi8(s, zero);
+            __m128i inverse_low = _mm_sub_epi16(all_255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_low, 0xff), 0xff));
+            __m128i inverse_high = _mm_sub_epi16(all_255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(s_high, 0xff), 0xff));
+            __m128i d_low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inverse_low), round);
+            __m128i d_high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inverse_high), round);
+            d_low = _mm_srli_epi16(_mm_add_epi16(d_low, _mm_srli_epi16(d_low, 8)), 8);
+            d_high = _mm_srli_epi16(_mm_add_epi16(d_high, _mm_srli_epi16(d_high, 8)), 8);
+            __m128i blended = _mm_adds_epu8(s, _mm_packus_epi16(d_low, d_high));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), blended);
+        }
+#endif
+        for (; i < count; ++i) {
+            uint32_t alpha = src[i] >> 24;
+            if (alpha == 0) {
+                continue;
+            }
+            dst[i] = blendPixel(src[i], dst[i]);
+        }
+    }
+
+    bool clip(const Image& target, const Image& source, int& x, int& y, int& src_x, int& src_y, int& width, int& height) {
+        src_x = std::max(0, -x);
+        src_y = std::max(0, -y);
+        width = std::min(source.width, target.width - x) - src_x;
+        height = std::min(source.height, target.height - y) - src_y;
+        x += src_x;
+        y += src_y;
+        return width > 0 && height > 0;
+    }
+}
+
+SpriteSet::SpriteSet(const string& directory) {
+    string prefix = directory.empty() || directory.back() == '/' || directory.back() == '\\' ? directory : directory + "/";
+    for (size_t i{0}; i < piece_count; ++i) {
+        pieces[i] = loadImage(prefix + pieces_file_names[i]);
+        premultiplyAlpha(pieces[i]);
+    }
+    for (size_t i{0}; i < tiles.size(); ++i) {
+        tiles[i] = loadImage(prefix + tiles_file_names[i]);
+        premultiplyAlpha(tiles[i]);
+    }
+}
+
+const SpriteSet::Scaled& SpriteSet::scaled(int tile_size) const {
+    if (tile_size <= 0) {
+        throw std::invalid_argument("Tile size must be positive");
+    }
+    std::lock_guard lock(cacheMutex);
+    auto& entry = cache[tile_size];
+    if (!entry) {
+        auto made = std::make_unique<Scaled>();
+        made->tileSize = tile_size;
+        for (size_t i{0}; i < piece_count; ++i) {
+            made->pieces[i] = resizeImage(pieces[i], tile_size, tile_size);
+        }
+        for (size_t i{0}; i < tiles.size(); ++i) {
+            made->tiles[i] = resizeImage(tiles[i], tile_size, tile_size);
+        }
+        entry = std::move(made);
+    }
+    return *entry;
+}
+
+int SpriteSet::pieceIndex(char symbol) {
+    constexpr const char* order = "PRNBQKprnbqk";
+    const char* found = std::strchr(order, symbol);
+    return (symbol != '\0' && found) ? static_cast<int>(found - order) : -1;
+}
+
+std::pair<int, int> SoftwareRenderer::frameSize(const RenderOptions& options) {
+    int side = 8 * options.tileSize + margin(options);
+    return {side, side};
+}
+
+void SoftwareRenderer::render(const BoardSnapshot& position, const RenderOptions& options, Image& target) const {
+    const SpriteSet::Scaled& scaled = sprites.scaled(options.tileSize);
+    auto [width, height] = frameSize(options);
+    target.width = width;
+    target.height = height;
+    target.pixels.resize(static_cast<size_t>(width) * height);
+    int left = margin(options);
+    int tile = options.tileSize;
+    // row 0 is at the bottom, as in DrawingChessboardInterface::calculateChessboardRects
+    auto origin = [&](int index) {
+        int row = index / 8;
+        int col = index % 8;
+        if (options.blackAtBottom) {
+            row = 7 - row;
+            col = 7 - col;
+        }
+        return std::pair<int, int>{left + col * tile, (7 - row) * tile};
+    };
+
+    if (options.coordinates) {
+        std::fill(target.pixels.begin(), target.pixels.end(), background_color);
+        int scale = std::max(1, tile * 2 / 5 / 7);
+        for (int i{0}; i < 8; ++i) {
+            auto [x, y] = origin(i * 8 + (options.blackAtBottom ? 7 : 0));
+            drawGlyph(target, 8 + i, (left - 5 * scale) / 2, y + (tile - 7 * scale) / 2, scale);
+            auto [column_x, column_y] = origin(i + (options.blackAtBottom ? 56 : 0));
+            drawGlyph(target, i, column_x + (tile - 5 * scale) / 2, 8 * tile + (left - 7 * scale) / 2, scale);
+        }
+    }
+    for (int index{0}; index < 64; ++index) {
+        auto [x, y] = origin(index);
+        copyImage(target, scaled.tiles[(index / 8 + index % 8) % 2], x, y);
+    }
+    for (int index{0}; index < 64; ++index) {
+        char symbol = position.squares[index];
+        if ((symbol == 'K' && position.whiteChecked) || (symbol == 'k' && position.blackChecked)) {
+            auto [x, y] = origin(index);
+            blendSprite(target, scaled.tiles[SpriteSet::check_overlay], x, y);
+        }
+    }
+    for (int index{0}; index < 64; ++index) {
+        int piece = SpriteSet::pieceIndex(position.squares[index]);
+        if (piece >= 0) {
+            auto [x, y] = origin(index);
+            blendSprite(target, scaled.pieces[piece], x, y);
+        }
+    }
+}
+
+void blendSprite(Image& target, const Image& sprite, int x, int y) {
+    int src_x, src_y, width, height;
+    if (!clip(target, sprite, x, y, src_x, src_y, width, height)) {
+        return;
+    }
+    for (int row{0}; row < height; ++row) {
+        blendRow(target.row(y + row) + x, sprite.row(src_y + row) + src_x, width);
+    }
+}
+
+void copyImage(Image& target, const Image& source, int x, int y) {
+    int src_x, src_y, width, height;
+    if (!clip(target, source, x, y, src_x, src_y, width, height)) {
+        return;
+    }
+    for (int row{0}; row < height; ++row) {
+        std::memcpy(target.row(y + row) + x, source.row(src_y + row) + src_x, static_cast<size_t>(width) * sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "board_snapshot.h"
+#include "image_codec.h"
+
+// The piece and tile images of the GUI, decoded without Direct2D or WIC and
+// premultiplied. Scaled copies are made once per tile size and kept, so
+// rendering many boards of one size never resamples again. Safe to share
+// between threads.
+class SpriteSet {
+public:
+    static constexpr size_t piece_count{12};
+    static constexpr size_t white_tile{0};
+    static constexpr size_t black_tile{1};
+    static constexpr size_t check_overlay{2};
+
+    // The tiles and pieces scaled to one tile size.
+    struct Scaled {
+        int tileSize{0};
+        std::array<Image, piece_count> pieces;
+        std::array<Image, 3> tiles;
+    };
+private:
+    std::array<Image, piece_count> pieces; // same order as DrawingChessboardInterface::PieceBitmaps
+    std::array<Image, 3> tiles;
+    mutable std::mutex cacheMutex;
+    mutable std::unordered_map<int, std::unique_ptr<Scaled>> cache;
+public:
+    // Loads the images from directory, by the file names Drawing.h uses.
+    explicit SpriteSet(const string& directory);
+    [[nodiscard]] const Scaled& scaled(int tile_size) const;
+    // Index into Scaled::pieces for a FEN letter, or -1.
+    [[nodiscard]] static int pieceIndex(char symbol);
+};
+
+struct RenderOptions {
+    int tileSize{32};
+    bool coordinates{true}; // numbers left of the board, letters below it, as in the GUI
+    bool blackAtBottom{false};
+};
+
+// Draws a position into an RGBA framebuffer the way DrawingChessboardInterface
+// draws it on screen: tiles, coordinates, the check overlay on the checked
+// king's square and the pieces. Tiles are copied, sprites are blended with
+// premultiplied "over", four pixels at a time where SSE2 is available.
+class SoftwareRenderer {
+private:
+    const SpriteSet& sprites;
+public:
+    explicit SoftwareRenderer(const SpriteSet& sprites) : sprites(sprites) {}
+    // Size of the framebuffer render() produces for these options.
+    [[nodiscard]] static std::pair<int, int> frameSize(const RenderOptions& options);
+    // Resizes target as needed; reusing one target between calls avoids allocating.
+    void render(const BoardSnapshot& position, const RenderOptions& options, Image& target) const;
+};
+
+// Blends a premultiplied sprite over target at (x, y), clipped to the target.
+void blendSprite(Image& target, const Image& sprite, int x, int y);
+// Copies an opaque image into target at (x, y), clipped to the target.
+void copyImage(Image& target, const Image& source, int x, int y);
+
+#endif // SOFTWARE_RENDERER_H
@@ -0,0 +1,184 @@
+#include "sprite_atlas.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+uint64_t hashSpriteSource(const string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return 0;
+    }
+    uint64_t hash{0xcbf29ce484222325ull};
+    std::array<uint8_t, 4096> buffer;
+    for (size_t read; (read = std::fread(buffer.data(), 1, buffer.size(), file)) > 0;) {
+        for (size_t i{0}; i < read; ++i) {
+            hash = (hash ^ buffer[i]) * 0x100000001b3ull;
+        }
+    }
+    std::fclose(file);
+    return hash;
+}
+
+SpriteAtlas::SpriteAtlas(const string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    fileHandle = file;
+    mappedBytes = static_cast<size_t>(size.QuadPart);
+    if (mappedBytes >= sizeof(AtlasHeader)) {
+        mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr) {
+            CloseHandle(file);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        data = static_cast<const uint8_t*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    mappedBytes = static_cast<size_t>(st.st_size);
+    if (mappedBytes >= sizeof(AtlasHeader)) {
+        void* address = mmap(nullptr, mappedBytes, PROT_READ, MAP_SHARED, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        data = static_cast<const uint8_t*>(address);
+    }
+#endif
+    try {
+        validate(path);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+SpriteAtlas::~SpriteAtlas() {
+    unmap();
+}
+
+void SpriteAtlas::unmap() {
+#ifdef _WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+        data = nullptr;
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+        mappingHandle = nullptr;
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+        fileHandle = nullptr;
+    }
+#else
+    if (data != nullptr) {
+        munmap(const_cast<uint8_t*>(data), mappedBytes);
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+void SpriteAtlas::validate(const string& path) {
+    if (data == nullptr) {
+        throw std::runtime_error(path + " is not a sprite atlas");
+    }
+    header = reinterpret_cast<const AtlasHeader*>(data);
+    if (header->magic != AtlasHeader{}.magic) {
+        throw std::runtime_error(path + " is not a sprite atlas");
+    }
+    if (header->version != AtlasHeader{}.version) {
+        throw std::runtime_error(path + ": unsupported atlas version " + std::to_string(header->version));
+    }
+    uint64_t tables = sizeof(AtlasHeader) + uint64_t{header->spriteCount} * sizeof(AtlasSprite) +
+                      uint64_t{header->levelCount} * sizeof(AtlasLevel);
+    if (header->spriteCount == 0 || header->levelCount == 0 || tables > mappedBytes) {
+        throw std::runtime_error(path + ": truncated atlas index");
+    }
+    names = reinterpret_cast<const AtlasSprite*>(data + sizeof(AtlasHeader));
+    levels = reinterpret_cast<const AtlasLevel*>(data + sizeof(AtlasHeader) + header->spriteCount * sizeof(AtlasSprite));
+    for (size_t l{0}; l < header->levelCount; ++l) {
+        const AtlasLevel& level = levels[l];
+        bool fits = level.columns > 0 && level.tileSize > 0 &&
+                    uint64_t{level.columns} * level.tileSize <= level.width &&
+                    uint64_t{(header->spriteCount + level.columns - 1) / level.columns} * level.tileSize <= level.height &&
+                    level.offset + uint64_t{level.width} * level.height * 4 <= mappedBytes;
+        if (!fits || (l > 0 && level.tileSize <= levels[l - 1].tileSize)) {
+            throw std::runtime_error(path + ": invalid atlas level " + std::to_string(l));
+        }
+    }
+}
+
+size_t SpriteAtlas::spriteCount() const {
+    return header->spriteCount;
+}
+
+size_t SpriteAtlas::levelCount() const {
+    return header->levelCount;
+}
+
+int SpriteAtlas::tileSize(size_t level) const {
+    return static_cast<int>(levels[level].tileSize);
+}
+
+size_t SpriteAtlas::nearestLevel(int tile_size) const {
+    for (size_t l{0}; l < header->levelCount; ++l) {
+        if (static_cast<int>(levels[l].tileSize) >= tile_size) {
+            return l;
+        }
+    }
+    return header->levelCount - 1;
+}
+
+int SpriteAtlas::find(std::string_view name) const {
+    for (size_t i{0}; i < header->spriteCount; ++i) {
+        if (this->name(i) == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+uint64_t SpriteAtlas::sourceHash(size_t sprite) const {
+    return names[sprite].sourceHash;
+}
+
+std::string_view SpriteAtlas::name(size_t sprite) const {
+    const auto& stored = names[sprite].name;
+    return {stored.data(), static_cast<size_t>(std::find(stored.begin(), stored.end(), '\0') - stored.begin())};
+}
+
+SpriteAtlas::Sprite SpriteAtlas::sprite(size_t level, size_t sprite) const {
+    if (level >= header->levelCount || sprite >= header->spriteCount) {
+        throw std::out_of_range("No sprite " + std::to_string(sprite) + " at atlas level " + std::to_string(level));
+    }
+    const AtlasLevel& l = levels[level];
+    size_t stride = size_t{l.width} * 4;
+    size_t row = sprite / l.columns;
+    size_t column = sprite % l.columns;
+    return {data + l.offset + row * l.tileSize * stride + column * l.tileSize * 4, static_cast<int>(l.tileSize), stride};
+}
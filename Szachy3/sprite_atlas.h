@@ -0,0 +1,105 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "image_codec.h"
+
+static_assert(std::endian::native == std::endian::little, "sprite atlas files are little endian");
+
+// Sprite atlas file: every piece and tile image pre-scaled to a few tile
+// sizes, ready to hand to the GPU. Layout:
+//
+//   AtlasHeader
+//   AtlasSprite[spriteCount]   names and source hashes, in sprite index order
+//   AtlasLevel[levelCount]     ascending tileSize
+//   pixels of each level at AtlasLevel::offset (64-byte aligned)
+//
+// A level is one page of premultiplied BGRA pixels (DXGI_FORMAT_B8G8R8A8_UNORM
+// with premultiplied alpha), tileSize x tileSize per sprite, sprite i at
+// column i % columns and row i / columns of the page.
+struct AtlasHeader {
+    std::array<char, 4> magic{'S', 'Z', 'A', 'T'};
+    uint32_t version{2};
+    uint32_t spriteCount{0};
+    uint32_t levelCount{0};
+};
+
+struct AtlasSprite {
+    std::array<char, 32> name{}; // file name without extension, zero padded
+    uint64_t sourceHash{0}; // hashSpriteSource of the image file it was packed from
+};
+
+struct AtlasLevel {
+    uint32_t tileSize{0};
+    uint32_t columns{0};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint64_t offset{0};
+};
+
+static_assert(sizeof(AtlasHeader) == 16 && sizeof(AtlasSprite) == 40 && sizeof(AtlasLevel) == 24,
+              "atlas records are written as they are laid out in memory");
+
+// FNV-1a of an image file's bytes, so that a reader can tell the file has
+// changed since the atlas was packed; 0 when it cannot be read.
+uint64_t hashSpriteSource(const string& path);
+
+struct AtlasSource {
+    string name;
+    Image image; // straight alpha
+    uint64_t sourceHash{0};
+};
+
+// Scales the images to every tile size and writes the atlas.
+// In sprite_atlas_writer.cpp, with image_codec.cpp.
+void writeSpriteAtlas(const string& path, const vector<AtlasSource>& sprites, vector<int> tile_sizes);
+
+// Read-only view of an atlas file, mapped into memory; nothing is decoded
+// or copied when it is opened.
+class SpriteAtlas {
+public:
+    struct Sprite {
+        const uint8_t* pixels{nullptr}; // BGRA, premultiplied
+        int size{0}; // width and height
+        size_t stride{0}; // bytes between rows
+    };
+private:
+    const uint8_t* data{nullptr};
+    size_t mappedBytes{0};
+    const AtlasHeader* header{nullptr};
+    const AtlasSprite* names{nullptr};
+    const AtlasLevel* levels{nullptr};
+#ifdef _WIN32
+    void* fileHandle{nullptr};
+    void* mappingHandle{nullptr};
+#else
+    int fd{-1};
+#endif
+    void validate(const string& path);
+    void unmap();
+public:
+    explicit SpriteAtlas(const string& path);
+    ~SpriteAtlas();
+    SpriteAtlas(const SpriteAtlas&) = delete;
+    SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+    [[nodiscard]] size_t spriteCount() const;
+    [[nodiscard]] size_t levelCount() const;
+    [[nodiscard]] int tileSize(size_t level) const;
+    // The level to draw tile_size pixel tiles from: the smallest that is not
+    // smaller, so sprites are only ever scaled down, or else the largest.
+    [[nodiscard]] size_t nearestLevel(int tile_size) const;
+    // Sprite index by name, or -1.
+    [[nodiscard]] int find(std::string_view name) const;
+    [[nodiscard]] std::string_view name(size_t sprite) const;
+    [[nodiscard]] uint64_t sourceHash(size_t sprite) const;
+    [[nodiscard]] Sprite sprite(size_t level, size_t sprite) const;
+};
+
+#endif // SPRITE_ATLAS_H
@@ -0,0 +1,83 @@
+// writeSpriteAtlas, apart from the reader so that the GUI, which only reads
+// atlases, links sprite_atlas.cpp without the image codec.
+#include "sprite_atlas.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr uint64_t level_alignment{64};
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + level_alignment - 1) / level_alignment * level_alignment;
+    }
+}
+
+void writeSpriteAtlas(const string& path, const vector<AtlasSource>& sprites, vector<int> tile_sizes) {
+    if (sprites.empty() || tile_sizes.empty()) {
+        throw std::invalid_argument("An atlas needs at least one sprite and one tile size");
+    }
+    std::sort(tile_sizes.begin(), tile_sizes.end());
+    tile_sizes.erase(std::unique(tile_sizes.begin(), tile_sizes.end()), tile_sizes.end());
+    if (tile_sizes.front() <= 0) {
+        throw std::invalid_argument("Tile sizes must be positive");
+    }
+
+    AtlasHeader header;
+    header.spriteCount = static_cast<uint32_t>(sprites.size());
+    header.levelCount = static_cast<uint32_t>(tile_sizes.size());
+    vector<AtlasSprite> names(sprites.size());
+    for (size_t i{0}; i < sprites.size(); ++i) {
+        if (sprites[i].name.size() >= names[i].name.size()) {
+            throw std::invalid_argument("Sprite name too long: " + sprites[i].name);
+        }
+        std::copy(sprites[i].name.begin(), sprites[i].name.end(), names[i].name.begin());
+        names[i].sourceHash = sprites[i].sourceHash;
+    }
+    uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(sprites.size()))));
+    uint32_t rows = (header.spriteCount + columns - 1) / columns;
+    vector<AtlasLevel> levels(tile_sizes.size());
+    uint64_t offset = alignUp(sizeof(AtlasHeader) + names.size() * sizeof(AtlasSprite) + levels.size() * sizeof(AtlasLevel));
+    for (size_t l{0}; l < levels.size(); ++l) {
+        uint32_t tile = static_cast<uint32_t>(tile_sizes[l]);
+        levels[l] = {tile, columns, columns * tile, rows * tile, offset};
+        offset = alignUp(offset + uint64_t{levels[l].width} * levels[l].height * 4);
+    }
+
+    vector<uint8_t> file(offset, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    std::memcpy(file.data() + sizeof(header), names.data(), names.size() * sizeof(AtlasSprite));
+    std::memcpy(file.data() + sizeof(header) + names.size() * sizeof(AtlasSprite), levels.data(), levels.size() * sizeof(AtlasLevel));
+    for (size_t i{0}; i < sprites.size(); ++i) {
+        Image premultiplied = sprites[i].image;
+        premultiplyAlpha(premultiplied);
+        for (const AtlasLevel& level : levels) {
+            int tile = static_cast<int>(level.tileSize);
+            Image scaled = resizeImage(premultiplied, tile, tile);
+            size_t stride = size_t{level.width} * 4;
+            uint8_t* origin = file.data() + level.offset + (i / columns) * tile * stride + (i % columns) * tile * 4;
+            for (int y{0}; y < tile; ++y) {
+                uint8_t* dst = origin + y * stride;
+                const uint32_t* src = scaled.row(y);
+                for (int x{0}; x < tile; ++x) {
+                    uint32_t p = src[x]; // 0xAABBGGRR
+                    dst[4 * x] = static_cast<uint8_t>(p >> 16);
+                    dst[4 * x + 1] = static_cast<uint8_t>(p >> 8);
+                    dst[4 * x + 2] = static_cast<uint8_t>(p);
+                    dst[4 * x + 3] = static_cast<uint8_t>(p >> 24);
+                }
+            }
+        }
+    }
+
+    std::FILE* out = std::fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    size_t written = std::fwrite(file.data(), 1, file.size(), out);
+    if (std::fclose(out) != 0 || written != file.size()) {
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
@@ -0,0 +1,104 @@
+#include "text_renderer.h"
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+    constexpr size_t rank_line_size{11}; // "8 rnbqkbnr\n"
+
+    // Appends to a buffer whose capacity was checked up front.
+    struct Output {
+        char* next;
+
+        void put(char c) {
+            *next++ = c;
+        }
+
+        void put(const char* s, size_t n) {
+            for (size_t i{0}; i < n; ++i) {
+                *next++ = s[i];
+            }
+        }
+
+        // CUP, "ESC [ row ; column H", 1-based
+        void moveCursor(int row, int column) {
+            put("\x1b[", 2);
+            next = std::to_chars(next, next + 11, row).ptr;
+            put(';');
+            next = std::to_chars(next, next + 11, column).ptr;
+            put('H');
+        }
+    };
+}
+
+TextCells textCells(const BoardSnapshot& snapshot) {
+    TextCells cells;
+    for (size_t i{0}; i < cells.size(); ++i) {
+        cells[i] = (snapshot.squares[i] == '\0') ? '.' : snapshot.squares[i];
+    }
+    return cells;
+}
+
+size_t writeBoardText(const TextCells& cells, std::span<char> out, bool file_letters) {
+    size_t needed = file_letters ? board_text_size : board_text_size - rank_line_size;
+    if (out.size() < needed) {
+        throw std::length_error("Board text needs " + std::to_string(needed) + " characters");
+    }
+    Output o{out.data()};
+    for (int row{7}; row >= 0; --row) {
+        o.put(static_cast<char>('1' + row));
+        o.put(' ');
+        o.put(&cells[static_cast<size_t>(row * 8)], 8);
+        o.put('\n');
+    }
+    if (file_letters) {
+        o.put("  ABCDEFGH\n", rank_line_size);
+    }
+    return static_cast<size_t>(o.next - out.data());
+}
+
+AnsiBoardStream::AnsiBoardStream(int top, int left) : top(top), left(left) {
+    if (top < 1 || left < 1 || top > 9999 || left > 9999) {
+        throw std::out_of_range("Board corner outside the terminal");
+    }
+}
+
+void AnsiBoardStream::reset() {
+    drawn = false;
+}
+
+size_t AnsiBoardStream::write(const TextCells& cells, std::span<char> out) {
+    if (out.size() < ansi_frame_capacity) {
+        throw std::length_error("An ANSI frame needs " + std::to_string(ansi_frame_capacity) + " characters");
+    }
+    Output o{out.data()};
+    if (!drawn) {
+        char text[board_text_size];
+        writeBoardText(cells, text);
+        for (int line{0}; line < 9; ++line) {
+            o.moveCursor(top + line, left);
+            o.put(text + line * rank_line_size, rank_line_size - 1);
+        }
+        drawn = true;
+    } else {
+        for (int row{7}; row >= 0; --row) {
+            for (int col{0}; col < 8;) {
+                size_t index = static_cast<size_t>(row * 8 + col);
+                if (cells[index] == shown[index]) {
+                    ++col;
+                    continue;
+                }
+                // one cursor move for a run of changed cells
+                o.moveCursor(top + 7 - row, left + 2 + col);
+                for (; col < 8 && cells[static_cast<size_t>(row * 8 + col)] != shown[static_cast<size_t>(row * 8 + col)]; ++col) {
+                    o.put(cells[static_cast<size_t>(row * 8 + col)]);
+                }
+            }
+        }
+        if (o.next == out.data()) {
+            return 0;
+        }
+    }
+    shown = cells;
+    o.moveCursor(top + 9, left);
+    return static_cast<size_t>(o.next - out.data());
+}
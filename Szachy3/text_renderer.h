@@ -0,0 +1,48 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include "board_snapshot.h"
+
+// One character per square, printed as it is, row 0 at the bottom.
+using TextCells = std::array<char, 64>;
+
+// Board::boardString's layout: rank number, space and eight cells per rank,
+// top rank first, then the file letters.
+constexpr size_t board_text_size{8 * 11 + 11};
+// Bound on one AnsiBoardStream::write, a full redraw included.
+constexpr size_t ansi_frame_capacity{1024};
+
+// FEN letters (uppercase white) from a snapshot, '.' on empty squares.
+[[nodiscard]] TextCells textCells(const BoardSnapshot& snapshot);
+
+// Writes the board into out without allocating and returns the number of
+// characters written. Throws std::length_error if out is shorter than
+// board_text_size (or board_text_size - 11 without the file letters).
+size_t writeBoardText(const TextCells& cells, std::span<char> out, bool file_letters = true);
+
+// Draws consecutive positions of one game on a terminal (or into a log that
+// is replayed by one) with ANSI escape codes. The first frame draws the whole
+// board at a fixed place; later frames only move the cursor to the cells that
+// changed and rewrite them, usually two or three of them per move. Every
+// frame ends with the cursor on the line below the board.
+class AnsiBoardStream {
+private:
+    TextCells shown{};
+    bool drawn{false};
+    int top;
+    int left;
+public:
+    // top and left are the 1-based terminal row and column of the board's corner.
+    explicit AnsiBoardStream(int top = 1, int left = 1);
+    // Writes the escape codes turning the previous frame into cells and
+    // returns their length, 0 when nothing changed. out must hold at least
+    // ansi_frame_capacity characters.
+    size_t write(const TextCells& cells, std::span<char> out);
+    // Makes the next write a full redraw, e.g. after the terminal was cleared.
+    void reset();
+};
+
+#endif // TEXT_RENDERER_H
@@ -0,0 +1,110 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace {
+    thread_local int worker_index{-1};
+    thread_local const ThreadPool* worker_pool{nullptr};
+}
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    thread_count = std::max<size_t>(1, thread_count);
+    for (size_t i{0}; i < thread_count; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i{0}; i < thread_count; ++i) {
+        threads.emplace_back([this, i] { run(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t target = (worker_pool == this) ? static_cast<size_t>(worker_index)
+                                          : nextQueue.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard lock(workers[target]->mutex);
+        workers[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // pairs with the predicate check of a worker going to sleep
+        std::lock_guard lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::popTask(size_t self, std::function<void()>& task) {
+    {
+        std::lock_guard lock(workers[self]->mutex);
+        if (!workers[self]->tasks.empty()) {
+            task = std::move(workers[self]->tasks.back());
+            workers[self]->tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset{1}; offset < workers.size(); ++offset) {
+        Worker& victim = *workers[(self + offset) % workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t self) {
+    worker_index = static_cast<int>(self);
+    worker_pool = this;
+    std::function<void()> task;
+    while (true) {
+        if (popTask(self, task)) {
+            task();
+            task = nullptr;
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard lock(sleepMutex);
+                idle.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        if (stopping) {
+            return;
+        }
+        // re-check under the lock so a submit cannot slip in unnoticed
+        bool has_work{false};
+        for (auto& w : workers) {
+            std::lock_guard queue_lock(w->mutex);
+            if (!w->tasks.empty()) {
+                has_work = true;
+                break;
+            }
+        }
+        if (!has_work) {
+            wakeUp.wait(lock);
+        }
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(sleepMutex);
+    idle.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+int ThreadPool::currentWorker() {
+    return worker_index;
+}
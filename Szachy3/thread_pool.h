@@ -0,0 +1,86 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pops its own newest
+// task first and, when empty, steals the oldest task of another worker.
+// Tasks submitted from inside a worker go to that worker's deque.
+class ThreadPool {
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable idle;
+    std::atomic<size_t> pending{0}; // submitted but not finished
+    std::atomic<size_t> nextQueue{0};
+    bool stopping{false};
+
+    bool popTask(size_t self, std::function<void()>& task);
+    void run(size_t self);
+public:
+    explicit ThreadPool(size_t thread_count = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until every submitted task has finished.
+    void wait();
+    [[nodiscard]] size_t size() const;
+    // Index of the calling worker thread, or -1 outside the pool.
+    [[nodiscard]] static int currentWorker();
+};
+
+// Remembers the first exception thrown by a pool task, since the pool
+// cannot pass it on: tasks run their work through run(), and the thread
+// that waited for them calls rethrow().
+class FirstError {
+private:
+    std::mutex mutex;
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+public:
+    // Runs f unless an earlier task failed, catching what it throws.
+    template<typename F>
+    void run(F&& f) {
+        if (failed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        try {
+            f();
+        } catch (...) {
+            std::lock_guard lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            failed = true;
+        }
+    }
+
+    [[nodiscard]] bool any() const {
+        return failed.load(std::memory_order_relaxed);
+    }
+
+    void rethrow() {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif // THREAD_POOL_H
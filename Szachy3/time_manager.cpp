@@ -0,0 +1,56 @@
+#include "time_manager.h"
+#include <algorithm>
+
+namespace {
+    constexpr int default_moves_to_go{30}; // expected remaining moves in sudden death
+    constexpr int score_drop_margin{30};
+    constexpr int stable_iterations_to_stop{4};
+}
+
+void TimeManager::start(const TimeControl& clock, size_t legal_moves) {
+    milliseconds available = std::max(clock.remaining - clock.moveOverhead, milliseconds(1));
+    int moves_to_go = (clock.movesToGo > 0) ? std::min(clock.movesToGo, 50) : default_moves_to_go;
+    optimum = available / moves_to_go + clock.increment * 3 / 4;
+    // never plan to use more than half the clock on one move, unless it is the last before the control
+    milliseconds cap = (moves_to_go == 1) ? available * 9 / 10 : available / 2;
+    optimum = std::clamp(optimum, milliseconds(1), cap);
+    maximum = std::clamp(optimum * 4, optimum, (moves_to_go == 1) ? cap : available * 4 / 5);
+    lastBestMove = {};
+    lastScore = 0;
+    stableIterations = 0;
+    instability = 0.0;
+    singleReply = legal_moves == 1;
+}
+
+bool TimeManager::shouldContinue(int depth, Move best_move, int score, milliseconds elapsed) {
+    if (singleReply) {
+        return false;
+    }
+    instability *= 0.5;
+    if (depth > 1 && best_move != lastBestMove) {
+        instability += 1.0;
+        stableIterations = 0;
+    } else {
+        ++stableIterations;
+    }
+    double factor = 1.0 + std::min(instability, 3.0) * 0.5;
+    if (depth > 1 && score < lastScore - score_drop_margin) {
+        factor *= (score < lastScore - 2 * score_drop_margin) ? 2.0 : 1.5;
+    }
+    if (stableIterations >= stable_iterations_to_stop) {
+        factor *= 0.6;
+    }
+    lastBestMove = best_move;
+    lastScore = score;
+    auto budget = std::min(milliseconds(static_cast<long long>(static_cast<double>(optimum.count()) * factor)), maximum);
+    // the next iteration usually takes longer than all previous ones together
+    return elapsed < budget / 2;
+}
+
+milliseconds TimeManager::getOptimum() const {
+    return optimum;
+}
+
+milliseconds TimeManager::getMaximum() const {
+    return maximum;
+}
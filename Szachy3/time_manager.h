@@ -0,0 +1,38 @@
+#ifndef TIME_MANAGER_H
+#define TIME_MANAGER_H
+
+#include <chrono>
+#include "board.h"
+
+using std::chrono::milliseconds;
+
+// The clock of the side to move.
+struct TimeControl {
+    milliseconds remaining{0};
+    milliseconds increment{0};
+    int movesToGo{0}; // moves until the next time control, 0 - sudden death
+    milliseconds moveOverhead{20}; // reserved per move for communication and GUI lag
+};
+
+// Splits the clock into a budget for one move. The optimum is the time we
+// aim for; the search may run past it when the best move keeps changing or
+// the score drops, and stops early when the best move is stable, but never
+// passes the maximum, which is enforced inside the search as a hard limit.
+class TimeManager {
+private:
+    milliseconds optimum{0};
+    milliseconds maximum{0};
+    Move lastBestMove;
+    int lastScore{0};
+    int stableIterations{0};
+    double instability{0.0}; // decaying count of best move changes
+    bool singleReply{false};
+public:
+    void start(const TimeControl& clock, size_t legal_moves);
+    // Called after each completed iteration; false if the next one should not be started.
+    [[nodiscard]] bool shouldContinue(int depth, Move best_move, int score, milliseconds elapsed);
+    [[nodiscard]] milliseconds getOptimum() const;
+    [[nodiscard]] milliseconds getMaximum() const;
+};
+
+#endif // TIME_MANAGER_H
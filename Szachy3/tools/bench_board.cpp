@@ -0,0 +1,425 @@
+// Micro-benchmarks of the Board primitives over a corpus of positions.
+//
+//   g++ -std=c++20 -O2 -I.. bench_board.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp
+//       ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp ../board_batch.cpp
+//       ../board_batch_avx2.cpp ../board_batch_avx512.cpp -o bench_board
+//   ./bench_board [--json] [--corpus positions.fen] [--min-time-ms 200] [--filter substring]
+//
+// Reports nanoseconds and heap allocations per operation. --json prints one
+// benchmark per line, so results of two commits can be compared with diff.
+// The BoardBatch benchmarks run every kernel this CPU supports over the
+// corpus repeated to batch_positions positions.
+#include "board.h"
+#include "board_batch.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+    uint64_t allocations{0};
+    volatile uint64_t sink{0};
+    constexpr size_t batch_positions{4096};
+
+    const vector<string> default_corpus{
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+        "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w - - 4 4",
+        "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/2N5/PPP2PPP/R1BQKB1R b - - 2 5",
+        "r1bq1rk1/pp2bppp/2n1pn2/2pp4/2PP4/2N1PN2/PP2BPPP/R1BQ1RK1 w - - 0 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w - - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w - - 1 8",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+        "8/5pk1/6p1/7p/7P/6P1/5PK1/8 w - - 0 1",
+        "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    };
+
+    struct Position {
+        string fen;
+        std::shared_ptr<Board> board;
+        vector<pair<int, int>> legalMoves;
+    };
+
+    // Brackets the measured part of a benchmark body.
+    class Meter {
+    private:
+        std::chrono::steady_clock::time_point started;
+        uint64_t allocations_at_start{0};
+    public:
+        std::chrono::nanoseconds elapsed{0};
+        uint64_t allocated{0};
+        uint64_t ops{0};
+
+        void begin() {
+            allocations_at_start = allocations;
+            started = std::chrono::steady_clock::now();
+        }
+        void end(uint64_t n) {
+            elapsed += std::chrono::steady_clock::now() - started;
+            allocated += allocations - allocations_at_start;
+            ops += n;
+        }
+    };
+
+    struct Result {
+        string name;
+        uint64_t ops;
+        double nsPerOp;
+        double allocsPerOp;
+    };
+
+    vector<int> legalTargets(Board& board, int from) {
+        vector<int> legal;
+        for (int to : board.getPiece(from)->getPossibleMoves(from)) {
+            auto probe = std::make_shared<Board>();
+            probe->initFromFen(board.toFen());
+            try {
+                probe->move(from, to);
+                legal.push_back(to);
+            } catch (const std::exception&) {
+            }
+        }
+        return legal;
+    }
+
+    vector<Position> loadCorpus(const vector<string>& fens) {
+        vector<Position> corpus;
+        for (const auto& fen : fens) {
+            Position p{fen, std::make_shared<Board>(), {}};
+            p.board->initFromFen(fen);
+            for (int from{0}; from < board_width * board_height; ++from) {
+                if (p.board->isPositionOccupied(from) && p.board->getPiece(from)->getColor() == p.board->getTurn()) {
+                    for (int to : legalTargets(*p.board, from)) {
+                        p.legalMoves.emplace_back(from, to);
+                    }
+                }
+            }
+            corpus.push_back(std::move(p));
+        }
+        return corpus;
+    }
+
+    vector<int> squaresWith(const Board& board, PieceType type) {
+        vector<int> squares;
+        for (auto& [index, piece] : board.getPositionMap()) {
+            if (piece->getType() == type) {
+                squares.push_back(index);
+            }
+        }
+        return squares;
+    }
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main(int argc, char** argv) {
+    bool json{false};
+    string corpus_file;
+    string filter;
+    std::chrono::milliseconds min_time{200};
+    for (int i{1}; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg == "--corpus" && i + 1 < argc) {
+            corpus_file = argv[++i];
+        } else if (arg == "--min-time-ms" && i + 1 < argc) {
+            min_time = std::chrono::milliseconds(std::stoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "usage: bench_board [--json] [--corpus file] [--min-time-ms n] [--filter substring]\n";
+            return 2;
+        }
+    }
+
+    vector<string> fens = default_corpus;
+    if (!corpus_file.empty()) {
+        std::ifstream in(corpus_file);
+        if (!in) {
+            std::cerr << "cannot open " << corpus_file << "\n";
+            return 1;
+        }
+        fens.clear();
+        for (string line; std::getline(in, line);) {
+            if (!line.empty()) {
+                fens.push_back(line);
+            }
+        }
+    }
+    vector<Position> corpus = loadCorpus(fens);
+    vector<string> notations;
+    for (int i{0}; i < board_width * board_height; ++i) {
+        notations.push_back(Board::getNotation(i));
+    }
+
+    vector<Result> results;
+    auto bench = [&](const string& name, const std::function<void(Meter&)>& body) {
+        if (!filter.empty() && name.find(filter) == string::npos) {
+            return;
+        }
+        Meter meter;
+        body(meter); // warm up
+        meter = Meter{};
+        auto deadline = std::chrono::steady_clock::now() + min_time;
+        while (std::chrono::steady_clock::now() < deadline || meter.ops == 0) {
+            body(meter);
+        }
+        results.push_back({name, meter.ops,
+                           static_cast<double>(meter.elapsed.count()) / static_cast<double>(meter.ops),
+                           static_cast<double>(meter.allocated) / static_cast<double>(meter.ops)});
+    };
+
+    bench("Board::getPositionIndex", [&](Meter& m) {
+        m.begin();
+        for (int row{0}; row < board_height; ++row) {
+            for (int col{0}; col < board_width; ++col) {
+                sink = sink + Board::getPositionIndex(row, col);
+            }
+        }
+        m.end(board_width * board_height);
+    });
+    bench("Board::getPosition", [&](Meter& m) {
+        m.begin();
+        for (int i{0}; i < board_width * board_height; ++i) {
+            auto [row, col] = Board::getPosition(i);
+            sink = sink + row + col;
+        }
+        m.end(board_width * board_height);
+    });
+    bench("Board::indexFromNotation", [&](Meter& m) {
+        m.begin();
+        for (const auto& n : notations) {
+            sink = sink + Board::indexFromNotation(n);
+        }
+        m.end(notations.size());
+    });
+
+    // every attacker of the given type against all 64 targets
+    auto attack_bench = [&](const string& name, PieceType type, const std::function<bool(Board&, int, int)>& attacks) {
+        bench(name, [&, type](Meter& m) {
+            for (auto& p : corpus) {
+                vector<int> attackers = squaresWith(*p.board, type);
+                m.begin();
+                for (int from : attackers) {
+                    for (int target{0}; target < board_width * board_height; ++target) {
+                        sink = sink + attacks(*p.board, from, target);
+                    }
+                }
+                m.end(attackers.size() * board_width * board_height);
+            }
+        });
+    };
+    attack_bench("Board::isPawnAttacking", PAWN, [](Board& b, int from, int to) {
+        return Board::isPawnAttacking(from, to, b.getPiece(from)->getColor());
+    });
+    attack_bench("Board::isRookAttacking", ROOK, [](Board& b, int from, int to) { return b.isRookAttacking(from, to); });
+    attack_bench("Board::isKnightAttacking", KNIGHT, [](Board&, int from, int to) { return Board::isKnightAttacking(from, to); });
+    attack_bench("Board::isBishopAttacking", BISHOP, [](Board& b, int from, int to) { return b.isBishopAttacking(from, to); });
+    attack_bench("Board::isQueenAttacking", QUEEN, [](Board& b, int from, int to) { return b.isQueenAttacking(from, to); });
+    attack_bench("Board::isKingAttacking", KING, [](Board&, int from, int to) { return Board::isKingAttacking(from, to); });
+
+    bench("Board::checkIfChecked", [&](Meter& m) {
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + p.board->checkIfChecked(WHITE) + p.board->checkIfChecked(BLACK);
+        }
+        m.end(2 * corpus.size());
+    });
+    bench("Board::isSquareAttacked", [&](Meter& m) {
+        m.begin();
+        for (auto& p : corpus) {
+            for (int square{0}; square < board_width * board_height; ++square) {
+                sink = sink + p.board->isSquareAttacked(square, WHITE) + p.board->isSquareAttacked(square, BLACK);
+            }
+        }
+        m.end(2 * board_width * board_height * corpus.size());
+    });
+    bench("Board::attackedSquares", [&](Meter& m) {
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + p.board->attackedSquares(WHITE) + p.board->attackedSquares(BLACK);
+        }
+        m.end(2 * corpus.size());
+    });
+    BoardBatch batch;
+    batch.reserve(batch_positions);
+    while (batch.size() < batch_positions) {
+        for (auto& p : corpus) {
+            batch.add(*p.board);
+        }
+    }
+    vector<uint64_t> batch_squares(batch.size());
+    std::unique_ptr<bool[]> batch_checks(new bool[batch.size()]);
+    for (BatchKernel kernel : {BatchKernel::SCALAR, BatchKernel::AVX2, BatchKernel::AVX512}) {
+        if (!BoardBatch::isSupported(kernel)) {
+            continue;
+        }
+        string suffix = string(" (") + BoardBatch::kernelName(kernel) + ")";
+        bench("BoardBatch::inCheck" + suffix, [&, kernel](Meter& m) {
+            batch.setKernel(kernel);
+            m.begin();
+            batch.inCheck(WHITE, {batch_checks.get(), batch.size()});
+            batch.inCheck(BLACK, {batch_checks.get(), batch.size()});
+            m.end(2 * batch.size());
+            sink = sink + batch_checks[0];
+        });
+        bench("BoardBatch::attackedSquares" + suffix, [&, kernel](Meter& m) {
+            batch.setKernel(kernel);
+            m.begin();
+            batch.attackedSquares(WHITE, batch_squares);
+            batch.attackedSquares(BLACK, batch_squares);
+            m.end(2 * batch.size());
+            sink = sink + batch_squares[0];
+        });
+    }
+    bench("Board::hangingPieces", [&](Meter& m) {
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + p.board->hangingPieces(WHITE) + p.board->hangingPieces(BLACK);
+        }
+        m.end(2 * corpus.size());
+    });
+    bench("Piece::getPossibleMoves", [&](Meter& m) {
+        for (auto& p : corpus) {
+            m.begin();
+            int pieces{0};
+            for (auto& [index, piece] : p.board->getPositionMap()) {
+                sink = sink + piece->getPossibleMoves(index).size();
+                ++pieces;
+            }
+            m.end(pieces);
+        }
+    });
+    bench("Board::move", [&](Meter& m) {
+        for (auto& p : corpus) {
+            for (auto [from, to] : p.legalMoves) {
+                p.board->initFromFen(p.fen);
+                m.begin();
+                p.board->move(from, to);
+                m.end(1);
+            }
+            p.board->initFromFen(p.fen);
+        }
+    });
+    // illegal input as a bot or network client sends it: own pieces to every square
+    vector<vector<Move>> candidates;
+    for (auto& p : corpus) {
+        vector<Move>& c = candidates.emplace_back();
+        vector<int> own; // isLegalMove makes and unmakes, so not while iterating the map
+        for (auto& [from, piece] : p.board->getPositionMap()) {
+            if (piece->getColor() == p.board->getTurn()) {
+                own.push_back(from);
+            }
+        }
+        for (int from : own) {
+            for (int to{0}; to < board_width * board_height; ++to) {
+                if (to != from && !p.board->isLegalMove({from, to})) {
+                    c.push_back({from, to});
+                }
+            }
+        }
+    }
+    bench("Board::move (illegal)", [&](Meter& m) {
+        for (size_t i{0}; i < corpus.size(); ++i) {
+            m.begin();
+            for (Move c : candidates[i]) {
+                try {
+                    corpus[i].board->move(c.from, c.to);
+                } catch (const std::exception&) {
+                    sink = sink + 1;
+                }
+            }
+            m.end(candidates[i].size());
+        }
+    });
+    bench("Board::tryMove (illegal)", [&](Meter& m) {
+        for (size_t i{0}; i < corpus.size(); ++i) {
+            m.begin();
+            for (Move c : candidates[i]) {
+                sink = sink + static_cast<int>(corpus[i].board->tryMove(c));
+            }
+            m.end(candidates[i].size());
+        }
+    });
+    bench("Board::validateMoves", [&](Meter& m) {
+        vector<MoveStatus> statuses;
+        for (size_t i{0}; i < corpus.size(); ++i) {
+            statuses.resize(candidates[i].size());
+            m.begin();
+            corpus[i].board->validateMoves(candidates[i], statuses);
+            m.end(candidates[i].size());
+            sink = sink + static_cast<int>(statuses.empty() ? MoveStatus::OK : statuses.front());
+        }
+    });
+    bench("Board::boardString", [&](Meter& m) {
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + p.board->boardString().size();
+        }
+        m.end(corpus.size());
+    });
+    bench("Board::writeBoardString", [&](Meter& m) {
+        std::array<char, board_text_size> text;
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + p.board->writeBoardString(text);
+        }
+        m.end(corpus.size());
+    });
+    bench("AnsiBoardStream::write", [&](Meter& m) {
+        // the corpus played as one game: consecutive frames differ in a few cells
+        AnsiBoardStream stream;
+        std::array<char, ansi_frame_capacity> frame;
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + stream.write(p.board->textCells(), frame);
+        }
+        m.end(corpus.size());
+    });
+    bench("Board::indexToPieceMap", [&](Meter& m) {
+        m.begin();
+        for (auto& p : corpus) {
+            sink = sink + p.board->indexToPieceMap().size();
+        }
+        m.end(corpus.size());
+    });
+
+    if (json) {
+        std::printf("{\"positions\":%zu,\"benchmarks\":[\n", corpus.size());
+        for (size_t i{0}; i < results.size(); ++i) {
+            const auto& r = results[i];
+            std::printf("{\"name\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f}%s\n", r.name.c_str(),
+                        static_cast<unsigned long long>(r.ops), r.nsPerOp, r.allocsPerOp, (i + 1 < results.size()) ? "," : "");
+        }
+        std::printf("]}\n");
+    } else {
+        std::printf("%-38s %14s %12s %14s\n", "benchmark", "ops", "ns/op", "allocs/op");
+        for (const auto& r : results) {
+            std::printf("%-38s %14llu %12.2f %14.3f\n", r.name.c_str(), static_cast<unsigned long long>(r.ops), r.nsPerOp, r.allocsPerOp);
+        }
+    }
+    return 0;
+}
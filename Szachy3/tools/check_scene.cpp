@@ -0,0 +1,138 @@
+// Headless checks of RenderScene's dirty rectangles (see diffScenes).
+//
+//   g++ -std=c++20 -O2 -I.. -o check_scene check_scene.cpp ../render_scene.cpp
+//   ./check_scene
+//
+// Builds the GUI's frames for a few typical changes on a 50 px board at
+// (100, 100) and compares the rectangles diffScenes returns with the ones
+// worked out by hand: a move, an unchanged frame, a pulse step of the
+// checked king, and a dragged piece following the mouse. Prints one line
+// per check and exits with the number of failures.
+#include "render_scene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <tuple>
+
+using std::string;
+
+namespace {
+    constexpr float board_left{100.0f};
+    constexpr float board_top{100.0f};
+    constexpr float tile{50.0f};
+    const SceneRect viewport{0.0f, 0.0f, 600.0f, 600.0f};
+
+    // square is rank * 8 + file, rank 0 at the bottom of the screen
+    SceneRect squareRect(int square) {
+        float left = board_left + static_cast<float>(square % 8) * tile;
+        float top = board_top + static_cast<float>(7 - square / 8) * tile;
+        return {left, top, left + tile, top + tile};
+    }
+
+    // whole pixels and one more on each side, as diffScenes reports them
+    SceneRect dirty(const SceneRect& r) {
+        return {std::floor(r.left) - 1.0f, std::floor(r.top) - 1.0f, std::ceil(r.right) + 1.0f, std::ceil(r.bottom) + 1.0f};
+    }
+
+    SceneRect scaled(const SceneRect& r, float scale_x, float scale_y) {
+        float center_x = 0.5f * (r.left + r.right);
+        float center_y = 0.5f * (r.top + r.bottom);
+        float half_width = 0.5f * (r.right - r.left) * scale_x;
+        float half_height = 0.5f * (r.bottom - r.top) * scale_y;
+        return {center_x - half_width, center_y - half_height, center_x + half_width, center_y + half_height};
+    }
+
+    BoardSceneState baseState() {
+        BoardSceneState state;
+        for (int square{0}; square < 64; ++square) {
+            state.squares[square] = squareRect(square);
+        }
+        return state;
+    }
+
+    void place(BoardSceneState& state, int rank, const char* pieces) {
+        for (int file{0}; pieces[file] != '\0'; ++file) {
+            state.position.squares[rank * 8 + file] = (pieces[file] == '.') ? '\0' : pieces[file];
+        }
+    }
+
+    BoardSceneState initialPosition() {
+        BoardSceneState state = baseState();
+        place(state, 0, "RNBQKBNR");
+        place(state, 1, "PPPPPPPP");
+        place(state, 6, "pppppppp");
+        place(state, 7, "rnbqkbnr");
+        return state;
+    }
+
+    string describe(vector<SceneRect> rects) {
+        std::sort(rects.begin(), rects.end(), [](const SceneRect& a, const SceneRect& b) {
+            return std::tie(a.top, a.left, a.bottom, a.right) < std::tie(b.top, b.left, b.bottom, b.right);
+        });
+        string text;
+        for (const SceneRect& r : rects) {
+            char item[96];
+            std::snprintf(item, sizeof(item), "%s{%g %g %g %g}", text.empty() ? "" : " ", r.left, r.top, r.right, r.bottom);
+            text += item;
+        }
+        return text.empty() ? "none" : text;
+    }
+
+    int failures{0};
+
+    void check(const char* name, const BoardSceneState& before, const BoardSceneState& after, const vector<SceneRect>& expected) {
+        RenderScene previous;
+        RenderScene next;
+        previous.build(before);
+        next.build(after);
+        string got = describe(diffScenes(previous, next, viewport));
+        string wanted = describe(expected);
+        if (got == wanted) {
+            std::printf("ok   %s: %s\n", name, got.c_str());
+        } else {
+            std::printf("FAIL %s: got %s, expected %s\n", name, got.c_str(), wanted.c_str());
+            ++failures;
+        }
+    }
+}
+
+int main() {
+    BoardSceneState start = initialPosition();
+    check("unchanged frame", start, start, {});
+
+    // e2-e4: the pawn leaves e2 and appears on e4, e3 between them stays clean
+    BoardSceneState moved = start;
+    moved.position.squares[12] = '\0';
+    moved.position.squares[28] = 'P';
+    check("move", start, moved, {dirty(squareRect(12)), dirty(squareRect(28))});
+
+    // the checked king pulses; its check overlay stays, so only the two scalings count
+    BoardSceneState checked = baseState();
+    place(checked, 0, "....K...");
+    place(checked, 7, "k...r...");
+    checked.position.whiteChecked = true;
+    checked.pulsing = 4;
+    BoardSceneState first_pulse = checked;
+    BoardSceneState second_pulse = checked;
+    first_pulse.pulse = 0.3f;
+    second_pulse.pulse = 0.6f;
+    auto pulsed = [](float pulse) {
+        return dirty(scaled(squareRect(4), 1.0f + 0.5f * std::sin(pulse), 0.5f + std::sin(pulse)));
+    };
+    check("check pulse", first_pulse, second_pulse, {pulsed(0.3f).united(pulsed(0.6f))});
+
+    // the knight from g1 follows the mouse; its square was emptied when the drag began
+    BoardSceneState dragging = start;
+    dragging.picked = 6;
+    dragging.mouseX = 410.0f;
+    dragging.mouseY = 460.0f;
+    BoardSceneState dragged = dragging;
+    dragged.mouseX = 430.0f;
+    dragged.mouseY = 470.0f;
+    auto under_mouse = [](float x, float y) { return dirty({x - tile / 2, y - tile / 2, x + tile / 2, y + tile / 2}); };
+    check("drag", dragging, dragged, {under_mouse(410.0f, 460.0f).united(under_mouse(430.0f, 470.0f))});
+
+    std::printf("%d failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,606 @@
+// Root-split search over several worker processes connected over TCP.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o cluster_search cluster_search.cpp ../board.cpp ../board_exceptions.cpp
+//       ../board_snapshot.cpp ../evaluation.cpp ../search.cpp ../search_stats.cpp ../trace.cpp ../time_manager.cpp
+//       ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp
+//   ./cluster_search coordinator --port 7800 --spawn 4 --depth 7 [--fen "..."] [--job-timeout-ms 60000]
+//                                [--connect-timeout-ms 10000]
+//   ./cluster_search coordinator --port 7800 --workers 4 --depth 7    (workers started elsewhere)
+//   ./cluster_search worker --connect 10.0.0.5:7800 [--hash 64] [--export-depth 4]
+//
+// The coordinator runs iterative deepening. At each depth the first root
+// move is searched with a full window; the other moves are searched with
+// null windows around the best score (speculatively around the previous
+// iteration's score while the first move is still running) and re-searched
+// with an open window when they fail high. Each result narrows the bounds
+// of its move, so a result arriving late or twice is still usable.
+//
+// Workers keep their Searcher (and its hash table) across jobs and report
+// entries of at least --export-depth, which the coordinator forwards to the
+// other workers. A worker that disconnects or exceeds the job timeout is
+// dropped and its job is handed to another worker. The search starts with
+// the workers connected within the connect timeout, or as soon as all are;
+// a spawned worker that exits before connecting is not waited for.
+//
+// Protocol, one message per line:
+//   worker -> coordinator: HELLO | RESULT <job> <score> <nodes> | HASH <key> <score> <depth> <bound> <from> <to>
+//   coordinator -> worker: POSITION <fen> | JOB <job> <move> <depth> <alpha> <beta> | HASH ... | QUIT
+#ifndef __linux__
+#error "cluster_search uses POSIX sockets and processes"
+#endif
+
+#include "board.h"
+#include "search.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Line-buffered socket.
+    class Link {
+    private:
+        int fd{-1};
+        string input;
+        string output;
+    public:
+        explicit Link(int fd) : fd(fd) {
+            int one{1};
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        [[nodiscard]] int handle() const {
+            return fd;
+        }
+
+        void send(const string& line) {
+            output += line;
+            output += '\n';
+        }
+
+        // Writes everything queued; false if the peer is gone.
+        bool flush() {
+            while (!output.empty()) {
+                ssize_t n = ::send(fd, output.data(), output.size(), MSG_NOSIGNAL);
+                if (n <= 0) {
+                    return false;
+                }
+                output.erase(0, static_cast<size_t>(n));
+            }
+            return true;
+        }
+
+        // One read(); false on EOF or error.
+        bool receive() {
+            char buffer[65536];
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                return false;
+            }
+            input.append(buffer, static_cast<size_t>(n));
+            return true;
+        }
+
+        bool nextLine(string& line) {
+            auto end = input.find('\n');
+            if (end == string::npos) {
+                return false;
+            }
+            line.assign(input, 0, end);
+            input.erase(0, end + 1);
+            return true;
+        }
+
+        void close() {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+
+    string hashLine(const TTEntry& e) {
+        std::ostringstream ss;
+        ss << "HASH " << e.key << ' ' << e.score << ' ' << static_cast<int>(e.depth) << ' ' << static_cast<int>(e.bound) << ' '
+           << static_cast<int>(e.from) << ' ' << static_cast<int>(e.to);
+        return ss.str();
+    }
+
+    bool parseHash(std::istringstream& ss, TTEntry& e) {
+        int score, depth, bound, from, to;
+        if (!(ss >> e.key >> score >> depth >> bound >> from >> to)) {
+            return false;
+        }
+        e.score = static_cast<int16_t>(score);
+        e.depth = static_cast<int8_t>(depth);
+        e.bound = static_cast<Bound>(bound);
+        e.from = static_cast<int8_t>(from);
+        e.to = static_cast<int8_t>(to);
+        return true;
+    }
+
+    // ----------------------------------------------------------------- worker
+
+    int runWorker(const string& address, size_t hash_megabytes, int export_depth) {
+        auto colon = address.rfind(':');
+        if (colon == string::npos) {
+            std::cerr << "expected host:port\n";
+            return 2;
+        }
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(std::stoi(address.substr(colon + 1))));
+        if (inet_pton(AF_INET, address.substr(0, colon).c_str(), &addr.sin_addr) != 1 ||
+            connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            std::cerr << "cannot connect to " << address << "\n";
+            return 1;
+        }
+        Link link(fd);
+        link.send("HELLO");
+        link.flush();
+
+        SearchOptions options;
+        options.hashMegabytes = hash_megabytes;
+        options.exportDepth = export_depth;
+        Searcher searcher(options);
+        auto board = std::make_shared<Board>();
+        board->init();
+        vector<TTEntry> exports;
+        string line;
+        while (link.receive()) {
+            while (link.nextLine(line)) {
+                std::istringstream ss(line);
+                string command;
+                ss >> command;
+                if (command == "POSITION") {
+                    string fen;
+                    std::getline(ss >> std::ws, fen);
+                    board->initFromFen(fen);
+                } else if (command == "HASH") {
+                    TTEntry e;
+                    if (parseHash(ss, e)) {
+                        searcher.importEntry(e);
+                    }
+                } else if (command == "JOB") {
+                    int job, depth, alpha, beta;
+                    string notation;
+                    ss >> job >> notation >> depth >> alpha >> beta;
+                    auto m = Board::parseMove(notation);
+                    if (!m || !board->isLegalMove(*m)) {
+                        link.send("RESULT " + std::to_string(job) + " " + std::to_string(-infinite_score) + " 0");
+                        continue;
+                    }
+                    MoveUndo undo;
+                    board->makeMove(*m, undo);
+                    uint64_t nodes{0};
+                    int score = -searcher.searchWindow(*board, depth - 1, -beta, -alpha, nodes);
+                    board->unmakeMove(undo);
+                    if (isMateScore(score)) {
+                        score += (score > 0) ? -1 : 1; // one ply further from the root
+                    }
+                    searcher.takeExports(exports);
+                    for (const auto& e : exports) {
+                        link.send(hashLine(e));
+                    }
+                    link.send("RESULT " + std::to_string(job) + " " + std::to_string(score) + " " + std::to_string(nodes));
+                } else if (command == "QUIT") {
+                    link.flush();
+                    link.close();
+                    return 0;
+                }
+            }
+            if (!link.flush()) {
+                break;
+            }
+        }
+        link.close();
+        return 0;
+    }
+
+    // ------------------------------------------------------------ coordinator
+
+    struct CoordinatorConfig {
+        int port{7800};
+        int workers{0};
+        int spawn{0};
+        int depth{6};
+        string fen{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1"};
+        std::chrono::milliseconds jobTimeout{60000};
+        std::chrono::milliseconds connectTimeout{10000};
+        size_t hashMegabytes{64};
+        int exportDepth{4};
+    };
+
+    struct WorkerState {
+        Link link;
+        int job{-1};
+        Clock::time_point jobStart{};
+        bool alive{true};
+    };
+
+    struct RootMove {
+        Move move;
+        int lower{-infinite_score};
+        int upper{infinite_score};
+        int job{-1}; // job in flight for this move
+        bool speculated{false};
+    };
+
+    struct Job {
+        size_t move;
+        int depth;
+        int alpha;
+        int beta;
+    };
+
+    class Coordinator {
+    private:
+        CoordinatorConfig config;
+        vector<WorkerState> workers;
+        vector<Job> jobs;
+        vector<RootMove> moves;
+        uint64_t nodes{0};
+        int depth{0};
+        bool haveBest{false};
+        int best{-infinite_score};
+        size_t bestIndex{0};
+        int previousScore{0};
+
+        [[nodiscard]] bool resolved(size_t i) const {
+            const RootMove& m = moves[i];
+            return m.lower == m.upper || (haveBest && i != bestIndex && m.upper <= best);
+        }
+
+        void dropWorker(WorkerState& w, const char* reason) {
+            std::fprintf(stderr, "worker dropped (%s)%s\n", reason, w.job >= 0 ? ", requeueing its job" : "");
+            w.alive = false;
+            w.link.close();
+            if (w.job >= 0 && moves[jobs[w.job].move].job == w.job) {
+                moves[jobs[w.job].move].job = -1;
+            }
+            w.job = -1;
+        }
+
+        void dispatch(WorkerState& w, size_t i, int alpha, int beta) {
+            int id = static_cast<int>(jobs.size());
+            jobs.push_back({i, depth, alpha, beta});
+            moves[i].job = id;
+            w.job = id;
+            w.jobStart = Clock::now();
+            w.link.send("JOB " + std::to_string(id) + " " + Board::moveToString(moves[i].move) + " " + std::to_string(depth) + " " +
+                        std::to_string(alpha) + " " + std::to_string(beta));
+        }
+
+        // Picks the next useful job for an idle worker.
+        void assign(WorkerState& w) {
+            for (size_t i{0}; i < moves.size(); ++i) {
+                RootMove& m = moves[i];
+                if (m.job >= 0 || resolved(i)) {
+                    continue;
+                }
+                if (!haveBest) {
+                    if (i == 0) {
+                        dispatch(w, i, -infinite_score, infinite_score);
+                        return;
+                    }
+                    // speculative null window around the previous iteration's score
+                    if (!m.speculated && m.lower <= previousScore && m.upper > previousScore) {
+                        m.speculated = true;
+                        dispatch(w, i, previousScore, previousScore + 1);
+                        return;
+                    }
+                    continue;
+                }
+                if (m.lower > best) {
+                    dispatch(w, i, best, infinite_score);
+                } else {
+                    dispatch(w, i, best, best + 1);
+                }
+                return;
+            }
+        }
+
+        void applyResult(int id, int score) {
+            const Job& job = jobs[id];
+            if (job.depth != depth) {
+                return; // from an earlier iteration
+            }
+            RootMove& m = moves[job.move];
+            if (m.job == id) {
+                m.job = -1;
+            }
+            if (score <= job.alpha) {
+                m.upper = std::min(m.upper, score);
+            } else if (score >= job.beta) {
+                m.lower = std::max(m.lower, score);
+            } else {
+                m.lower = m.upper = score;
+            }
+            if (m.lower == m.upper && (!haveBest || m.lower > best)) {
+                haveBest = true;
+                best = m.lower;
+                bestIndex = job.move;
+            }
+        }
+
+        void broadcast(const string& line, const WorkerState* except) {
+            for (auto& w : workers) {
+                if (w.alive && &w != except) {
+                    w.link.send(line);
+                }
+            }
+        }
+
+        void handleLine(WorkerState& w, const string& line) {
+            std::istringstream ss(line);
+            string command;
+            ss >> command;
+            if (command == "HASH") {
+                broadcast(line, &w);
+            } else if (command == "RESULT") {
+                int id, score;
+                uint64_t job_nodes;
+                ss >> id >> score >> job_nodes;
+                nodes += job_nodes;
+                if (w.job == id) {
+                    w.job = -1;
+                }
+                if (id >= 0 && id < static_cast<int>(jobs.size())) {
+                    applyResult(id, score);
+                }
+            }
+        }
+
+        bool searchDepth() {
+            haveBest = false;
+            best = -infinite_score;
+            for (auto& m : moves) {
+                m = RootMove{m.move};
+            }
+            while (true) {
+                bool done = haveBest;
+                for (size_t i{0}; i < moves.size() && done; ++i) {
+                    done = resolved(i);
+                }
+                if (done) {
+                    return true;
+                }
+                size_t alive{0};
+                for (auto& w : workers) {
+                    if (!w.alive) {
+                        continue;
+                    }
+                    ++alive;
+                    if (w.job < 0) {
+                        assign(w);
+                    }
+                    if (!w.link.flush()) {
+                        dropWorker(w, "write failed");
+                    }
+                }
+                if (alive == 0) {
+                    std::cerr << "no workers left\n";
+                    return false;
+                }
+                vector<pollfd> fds;
+                vector<WorkerState*> owners;
+                for (auto& w : workers) {
+                    if (w.alive) {
+                        fds.push_back({w.link.handle(), POLLIN, 0});
+                        owners.push_back(&w);
+                    }
+                }
+                poll(fds.data(), fds.size(), 10);
+                auto now = Clock::now();
+                for (size_t i{0}; i < fds.size(); ++i) {
+                    WorkerState& w = *owners[i];
+                    if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                        if (!w.link.receive()) {
+                            dropWorker(w, "disconnected");
+                            continue;
+                        }
+                        string line;
+                        while (w.link.nextLine(line)) {
+                            handleLine(w, line);
+                        }
+                    }
+                    if (w.alive && w.job >= 0 && now - w.jobStart > config.jobTimeout) {
+                        dropWorker(w, "job timeout");
+                    }
+                }
+            }
+        }
+    public:
+        explicit Coordinator(const CoordinatorConfig& config) : config(config) {}
+
+        int run(const char* self_path) {
+            int listener = socket(AF_INET, SOCK_STREAM, 0);
+            int one{1};
+            setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(config.port));
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+                std::cerr << "cannot listen on port " << config.port << "\n";
+                return 1;
+            }
+            vector<pid_t> children;
+            for (int i{0}; i < config.spawn; ++i) {
+                pid_t pid = fork();
+                if (pid == 0) {
+                    string target = "127.0.0.1:" + std::to_string(config.port);
+                    string hash = std::to_string(config.hashMegabytes);
+                    string export_depth = std::to_string(config.exportDepth);
+                    execl(self_path, self_path, "worker", "--connect", target.c_str(), "--hash", hash.c_str(), "--export-depth",
+                          export_depth.c_str(), static_cast<char*>(nullptr));
+                    _exit(127);
+                }
+                children.push_back(pid);
+            }
+            // spawned workers exit on QUIT; a hung or dropped one is killed after a grace period
+            auto stop_children = [&] {
+                auto deadline = Clock::now() + std::chrono::seconds(2);
+                for (pid_t pid : children) {
+                    while (waitpid(pid, nullptr, WNOHANG) == 0) {
+                        if (Clock::now() > deadline) {
+                            kill(pid, SIGKILL);
+                            waitpid(pid, nullptr, 0);
+                            break;
+                        }
+                        usleep(10000);
+                    }
+                }
+            };
+            int expected = std::max(config.workers, config.spawn);
+            auto connect_deadline = Clock::now() + config.connectTimeout;
+            while (static_cast<int>(workers.size()) < expected && Clock::now() < connect_deadline) {
+                // a child that failed to start (execl, or exited early) will never connect
+                for (auto it = children.begin(); it != children.end();) {
+                    if (waitpid(*it, nullptr, WNOHANG) == *it) {
+                        std::cerr << "worker process " << *it << " exited\n";
+                        it = children.erase(it);
+                        --expected;
+                    } else {
+                        ++it;
+                    }
+                }
+                pollfd pending{listener, POLLIN, 0};
+                if (poll(&pending, 1, 100) <= 0) {
+                    continue;
+                }
+                int fd = accept(listener, nullptr, nullptr);
+                if (fd < 0) {
+                    continue;
+                }
+                workers.push_back(WorkerState{.link = Link(fd)});
+            }
+            close(listener);
+            if (workers.empty()) {
+                std::cerr << "no worker connected\n";
+                stop_children();
+                return 1;
+            }
+
+            auto board = std::make_shared<Board>();
+            board->initFromFen(config.fen);
+            vector<Move> legal;
+            board->generateLegalMoves(legal);
+            if (legal.empty()) {
+                std::cerr << "no legal moves\n";
+                return 1;
+            }
+            for (Move m : legal) {
+                moves.push_back({m});
+            }
+            broadcast("POSITION " + config.fen, nullptr);
+            previousScore = 0;
+
+            auto start = Clock::now();
+            int exit_code{0};
+            for (depth = 1; depth <= config.depth; ++depth) {
+                if (!searchDepth()) {
+                    exit_code = 1;
+                    break;
+                }
+                auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+                std::printf("depth %d score %d best %s nodes %llu time_ms %lld workers %zu\n", depth, best,
+                            Board::moveToString(moves[bestIndex].move).c_str(), static_cast<unsigned long long>(nodes),
+                            static_cast<long long>(ms),
+                            static_cast<size_t>(std::count_if(workers.begin(), workers.end(), [](const WorkerState& w) { return w.alive; })));
+                std::fflush(stdout);
+                if (isMateScore(best) && mate_score - std::abs(best) <= depth) {
+                    break;
+                }
+                previousScore = best;
+                // best move first, the others by how good they were shown to be
+                std::swap(moves[0], moves[bestIndex]);
+                std::stable_sort(moves.begin() + 1, moves.end(), [](const RootMove& a, const RootMove& b) { return a.upper > b.upper; });
+                bestIndex = 0;
+            }
+            broadcast("QUIT", nullptr);
+            for (auto& w : workers) {
+                if (w.alive) {
+                    w.link.flush();
+                    w.link.close();
+                }
+            }
+            stop_children();
+            return exit_code;
+        }
+    };
+
+    int usage() {
+        std::cerr << "usage: cluster_search coordinator [--port n] [--workers n] [--spawn n] [--depth n] [--fen fen]\n"
+                     "                                  [--job-timeout-ms n] [--connect-timeout-ms n] [--hash mb] [--export-depth n]\n"
+                     "       cluster_search worker --connect host:port [--hash mb] [--export-depth n]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    string mode = argv[1];
+    CoordinatorConfig config;
+    string connect_to;
+    try {
+        for (int i{2}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--port") {
+                config.port = std::stoi(value);
+            } else if (arg == "--workers") {
+                config.workers = std::stoi(value);
+            } else if (arg == "--spawn") {
+                config.spawn = std::stoi(value);
+            } else if (arg == "--depth") {
+                config.depth = std::stoi(value);
+            } else if (arg == "--fen") {
+                config.fen = value;
+            } else if (arg == "--job-timeout-ms") {
+                config.jobTimeout = std::chrono::milliseconds(std::stoll(value));
+            } else if (arg == "--connect-timeout-ms") {
+                config.connectTimeout = std::chrono::milliseconds(std::stoll(value));
+            } else if (arg == "--hash") {
+                config.hashMegabytes = std::stoul(value);
+            } else if (arg == "--export-depth") {
+                config.exportDepth = std::stoi(value);
+            } else if (arg == "--connect") {
+                connect_to = value;
+            } else {
+                return usage();
+            }
+        }
+        if (mode == "worker" && !connect_to.empty()) {
+            return runWorker(connect_to, config.hashMegabytes, config.exportDepth);
+        }
+        if (mode == "coordinator" && (config.workers > 0 || config.spawn > 0)) {
+            signal(SIGPIPE, SIG_IGN);
+            return Coordinator(config).run("/proc/self/exe");
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return usage();
+}
@@ -0,0 +1,196 @@
+// Self-play training data generator and tools for the packed record files.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o datagen datagen.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp
+//       ../evaluation.cpp ../search.cpp ../search_stats.cpp ../trace.cpp ../thread_pool.cpp ../training_data.cpp
+//       ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp ../time_manager.cpp ../mapped_file.cpp
+//   ./datagen generate --out data.bin [--positions 1000000] [--threads n] [--nodes 256] [--random-plies 8] [--seed 1]
+//   ./datagen shuffle --in data.bin --out shuffled.bin [--seed 1]
+//   ./datagen stats --in data.bin
+//
+// Games start from Board::init with a few random plies, then both sides play
+// the Searcher's best move under a node limit. Every position after the
+// random opening that is not in check is recorded with the search score and,
+// once the game ends, the game result (see PackedPosition). Each worker
+// thread buffers its records and appends whole blocks to the shared file.
+#include "board.h"
+#include "search.h"
+#include "training_data.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct GeneratorConfig {
+        string out;
+        uint64_t positions{1000000};
+        size_t threads{std::thread::hardware_concurrency()};
+        uint64_t nodes{256};
+        int randomPlies{8};
+        int maxPlies{300};
+        int resignScore{1500};
+        uint64_t seed{1};
+    };
+
+    // Plays one game and appends its positions to buffer. Returns the number of positions.
+    size_t playGame(const GeneratorConfig& config, Searcher& searcher, std::mt19937_64& rng, TrainingDataWriter::Buffer& buffer) {
+        auto board = std::make_shared<Board>();
+        board->init();
+        searcher.newGame();
+        vector<Move> moves;
+        // a few random plies, with random parity so either side can be to move afterwards
+        int random_plies = config.randomPlies + static_cast<int>(rng() % 2);
+        for (int i{0}; i < random_plies; ++i) {
+            moves.clear();
+            board->generateLegalMoves(moves);
+            if (moves.empty()) {
+                return 0;
+            }
+            Move m = moves[rng() % moves.size()];
+            board->move(m.from, m.to);
+        }
+
+        SearchLimits limits{.depth = max_ply, .nodes = config.nodes};
+        vector<PackedPosition> game;
+        GameResult result{GameResult::DRAW};
+        for (int ply{random_plies}; ply < config.maxPlies; ++ply) {
+            bool white_to_move = board->getTurn() == WHITE;
+            SearchResult found = searcher.search(*board, limits);
+            if (found.bestMove.isNull()) {
+                if (found.score != 0) {
+                    result = white_to_move ? GameResult::BLACK_WIN : GameResult::WHITE_WIN;
+                }
+                break;
+            }
+            int white_score = white_to_move ? found.score : -found.score;
+            if (std::abs(white_score) >= config.resignScore) {
+                result = (white_score > 0) ? GameResult::WHITE_WIN : GameResult::BLACK_WIN;
+                break;
+            }
+            if (!board->isChecked(board->getTurn())) {
+                game.push_back(PackedPosition::pack(board->toCompact(), white_score, ply, GameResult::DRAW));
+            }
+            board->move(found.bestMove.from, found.bestMove.to);
+            if (board->isThreefoldRepetition() || board->isFiftyMoveDraw()) {
+                break;
+            }
+        }
+        for (auto& record : game) {
+            record.result = result;
+            buffer.add(record);
+        }
+        return game.size();
+    }
+
+    int generate(const GeneratorConfig& config) {
+        TrainingDataWriter writer(config.out);
+        std::atomic<uint64_t> produced{0};
+        auto start = std::chrono::steady_clock::now();
+        vector<std::thread> workers;
+        for (size_t t{0}; t < config.threads; ++t) {
+            workers.emplace_back([&, t] {
+                SearchOptions options;
+                options.hashMegabytes = 4;
+                Searcher searcher(options);
+                std::mt19937_64 rng(config.seed * 1000003 + t);
+                TrainingDataWriter::Buffer buffer(writer);
+                while (produced.load(std::memory_order_relaxed) < config.positions) {
+                    produced.fetch_add(playGame(config, searcher, rng, buffer), std::memory_order_relaxed);
+                }
+            });
+        }
+        // progress from the main thread
+        while (produced.load() < config.positions) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            uint64_t n = produced.load();
+            std::printf("\rpositions %llu  %.0f/s  %.2fM/hour/thread", static_cast<unsigned long long>(n), n / seconds,
+                        n / seconds * 3600.0 / 1e6 / static_cast<double>(config.threads));
+            std::fflush(stdout);
+        }
+        for (auto& w : workers) {
+            w.join();
+        }
+        std::printf("\nwrote %llu records to %s\n", static_cast<unsigned long long>(writer.recordsWritten()), config.out.c_str());
+        return 0;
+    }
+
+    int stats(const string& path) {
+        MappedTrainingData data(path);
+        std::array<uint64_t, 3> results{};
+        double score_sum{0.0};
+        for (const auto& record : data.records()) {
+            ++results[static_cast<int>(record.result)];
+            score_sum += std::abs(record.score);
+        }
+        std::printf("records=%zu white_wins=%llu draws=%llu black_wins=%llu mean_abs_score=%.1f\n", data.size(),
+                    static_cast<unsigned long long>(results[2]), static_cast<unsigned long long>(results[1]),
+                    static_cast<unsigned long long>(results[0]), data.size() ? score_sum / static_cast<double>(data.size()) : 0.0);
+        return 0;
+    }
+
+    int usage() {
+        std::cerr << "usage: datagen generate --out file [--positions n] [--threads n] [--nodes n] [--random-plies n]\n"
+                     "                        [--max-plies n] [--resign-score cp] [--seed n]\n"
+                     "       datagen shuffle --in file --out file [--seed n]\n"
+                     "       datagen stats --in file\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    string command = argv[1];
+    GeneratorConfig config;
+    string in;
+    try {
+        for (int i{2}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--out") {
+                config.out = value;
+            } else if (arg == "--in") {
+                in = value;
+            } else if (arg == "--positions") {
+                config.positions = std::stoull(value);
+            } else if (arg == "--threads") {
+                config.threads = std::stoul(value);
+            } else if (arg == "--nodes") {
+                config.nodes = std::stoull(value);
+            } else if (arg == "--random-plies") {
+                config.randomPlies = std::stoi(value);
+            } else if (arg == "--max-plies") {
+                config.maxPlies = std::stoi(value);
+            } else if (arg == "--resign-score") {
+                config.resignScore = std::stoi(value);
+            } else if (arg == "--seed") {
+                config.seed = std::stoull(value);
+            } else {
+                return usage();
+            }
+        }
+        if (command == "generate" && !config.out.empty()) {
+            return generate(config);
+        }
+        if (command == "shuffle" && !in.empty() && !config.out.empty()) {
+            shuffleTrainingData(in, config.out, config.seed);
+            return 0;
+        }
+        if (command == "stats" && !in.empty()) {
+            return stats(in);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return usage();
+}
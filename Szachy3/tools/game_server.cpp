@@ -0,0 +1,622 @@
+// Headless game server holding many concurrent games in one process.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o game_server game_server.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp
+//       ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp ../search_stats.cpp ../trace.cpp
+//   ./game_server --port 7777 [--unix /tmp/szachy.sock]
+//   ./game_server --bench-clients 8 --bench-games 1000 --bench-plies 40
+//
+// Games are kept as 32-byte CompactBoards in a slab with a free list, not as
+// Boards with heap pieces; a move is validated by loading the game into one
+// scratch Board. Clients talk a line protocol over TCP or a Unix socket,
+// served by a single epoll loop:
+//
+//   NEW                -> OK <game id>
+//   MOVE <id> <e2e4>   -> OK | ERR <reason>
+//   FEN <id>           -> OK <fen>
+//   END <id>           -> OK
+//   STATS              -> OK games=.. accepted=.. rejected=.. p50_us=.. p99_us=.. max_us=..
+//
+// accepted counts legal moves, rejected every ERR reply. A line longer than
+// max_line_bytes gets "ERR line too long" and the connection is closed.
+//
+// --bench-* starts loopback clients against the server and reports the
+// move acknowledge latency seen by the clients and by the server.
+#ifndef __linux__
+#error "game_server uses epoll and only builds on Linux"
+#endif
+
+#include "board.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct GameSlot {
+        CompactBoard position;
+        uint32_t generation{0};
+        uint16_t plies{0};
+        bool active{false};
+    };
+
+    // Games live in one contiguous vector; freed slots are reused. Ids carry
+    // the slot generation so a stale id never reaches a reused slot.
+    class GameSlab {
+    private:
+        vector<GameSlot> slots;
+        vector<uint32_t> freeSlots;
+        size_t activeGames{0};
+    public:
+        uint64_t create(const CompactBoard& start) {
+            uint32_t index;
+            if (!freeSlots.empty()) {
+                index = freeSlots.back();
+                freeSlots.pop_back();
+            } else {
+                index = static_cast<uint32_t>(slots.size());
+                slots.emplace_back();
+            }
+            GameSlot& slot = slots[index];
+            slot.position = start;
+            slot.plies = 0;
+            slot.active = true;
+            ++activeGames;
+            return (static_cast<uint64_t>(slot.generation) << 32) | index;
+        }
+
+        GameSlot* find(uint64_t id) {
+            uint32_t index = static_cast<uint32_t>(id);
+            if (index >= slots.size() || !slots[index].active || slots[index].generation != static_cast<uint32_t>(id >> 32)) {
+                return nullptr;
+            }
+            return &slots[index];
+        }
+
+        bool release(uint64_t id) {
+            GameSlot* slot = find(id);
+            if (slot == nullptr) {
+                return false;
+            }
+            slot->active = false;
+            ++slot->generation;
+            freeSlots.push_back(static_cast<uint32_t>(id));
+            --activeGames;
+            return true;
+        }
+
+        [[nodiscard]] size_t size() const {
+            return activeGames;
+        }
+    };
+
+    // Microsecond buckets: exact below 1 ms, then powers of two.
+    class LatencyHistogram {
+    private:
+        static constexpr size_t linear{1024};
+        std::array<uint64_t, linear + 40> buckets{};
+        uint64_t count{0};
+        uint64_t maxMicros{0};
+    public:
+        void record(Clock::duration d) {
+            auto us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+            size_t bucket = us < linear ? us : linear + (63 - __builtin_clzll(us)) - 10;
+            ++buckets[std::min(bucket, buckets.size() - 1)];
+            ++count;
+            maxMicros = std::max(maxMicros, us);
+        }
+
+        [[nodiscard]] uint64_t percentile(double p) const {
+            uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(count));
+            uint64_t seen{0};
+            for (size_t i{0}; i < buckets.size(); ++i) {
+                seen += buckets[i];
+                if (seen > rank) {
+                    return i < linear ? i : uint64_t{1} << (i - linear + 11);
+                }
+            }
+            return maxMicros;
+        }
+
+        [[nodiscard]] uint64_t max() const {
+            return maxMicros;
+        }
+
+        void merge(const LatencyHistogram& other) {
+            for (size_t i{0}; i < buckets.size(); ++i) {
+                buckets[i] += other.buckets[i];
+            }
+            count += other.count;
+            maxMicros = std::max(maxMicros, other.maxMicros);
+        }
+    };
+
+    bool setNonBlocking(int fd) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+    }
+
+    constexpr size_t max_line_bytes{4096};
+
+    struct Connection {
+        string input;
+        string output;
+        vector<Clock::time_point> pendingMoves; // receive times of moves not yet acknowledged on the wire
+        bool closing{false}; // nothing more is read; closed once output is written
+    };
+
+    class GameServer {
+    private:
+        int epollFd{-1};
+        vector<int> listeners;
+        std::unordered_map<int, Connection> connections;
+        GameSlab games;
+        std::shared_ptr<Board> scratch{std::make_shared<Board>()};
+        CompactBoard startPosition;
+        LatencyHistogram latency;
+        uint64_t accepted{0};
+        uint64_t rejected{0};
+        std::mutex statsMutex; // guards latency/accepted/rejected and the game count for statsLine() from other threads
+
+        void addListener(int fd) {
+            setNonBlocking(fd);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            listeners.push_back(fd);
+        }
+
+        void acceptAll(int listener) {
+            while (true) {
+                int fd = accept(listener, nullptr, nullptr);
+                if (fd < 0) {
+                    return;
+                }
+                setNonBlocking(fd);
+                int one{1};
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                epoll_event ev{};
+                ev.events = EPOLLIN | EPOLLRDHUP;
+                ev.data.fd = fd;
+                epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+                connections.emplace(fd, Connection{});
+            }
+        }
+
+        void closeConnection(int fd) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            connections.erase(fd);
+        }
+
+        static uint64_t parseId(string_view s) {
+            uint64_t id{0};
+            for (char c : s) {
+                if (c < '0' || c > '9') {
+                    return UINT64_MAX;
+                }
+                id = id * 10 + static_cast<uint64_t>(c - '0');
+            }
+            return s.empty() ? UINT64_MAX : id;
+        }
+
+        string handleMove(uint64_t id, string_view notation) {
+            GameSlot* slot = games.find(id);
+            if (slot == nullptr) {
+                return "ERR unknown game";
+            }
+            auto m = Board::parseMove(notation);
+            if (!m) {
+                return "ERR bad notation";
+            }
+            scratch->initFromCompact(slot->position);
+            switch (scratch->tryMove(*m)) {
+                case MoveStatus::OK:
+                    slot->position = scratch->toCompact();
+                    ++slot->plies;
+                    return "OK";
+                case MoveStatus::NOT_YOUR_TURN:
+                    return "ERR not your turn";
+                case MoveStatus::KING_IN_CHECK:
+                    return "ERR king in check";
+                default:
+                    return "ERR illegal move";
+            }
+        }
+
+        string handleLine(string_view line) {
+            auto space = line.find(' ');
+            string_view command = line.substr(0, space);
+            string_view rest = (space == string_view::npos) ? string_view{} : line.substr(space + 1);
+            auto second_space = rest.find(' ');
+            uint64_t id = parseId(rest.substr(0, second_space));
+            if (command == "NEW") {
+                std::lock_guard lock(statsMutex);
+                return "OK " + std::to_string(games.create(startPosition));
+            }
+            if (command == "MOVE" && second_space != string_view::npos) {
+                return handleMove(id, rest.substr(second_space + 1));
+            }
+            if (command == "FEN") {
+                GameSlot* slot = games.find(id);
+                if (slot == nullptr) {
+                    return "ERR unknown game";
+                }
+                scratch->initFromCompact(slot->position);
+                return "OK " + scratch->toFen();
+            }
+            if (command == "END") {
+                std::lock_guard lock(statsMutex);
+                return games.release(id) ? "OK" : "ERR unknown game";
+            }
+            if (command == "STATS") {
+                return "OK " + statsLine();
+            }
+            return "ERR unknown command";
+        }
+
+        void reply(Connection& c, string_view line, bool move) {
+            {
+                std::lock_guard lock(statsMutex);
+                if (line.starts_with("ERR")) {
+                    ++rejected;
+                } else if (move) {
+                    ++accepted;
+                }
+            }
+            c.output += line;
+            c.output += '\n';
+        }
+
+        void readFrom(int fd) {
+            Connection& c = connections[fd];
+            char buffer[4096];
+            while (!c.closing) {
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    c.input.append(buffer, static_cast<size_t>(n));
+                    continue;
+                }
+                if (n == 0) {
+                    c.closing = true; // the peer is done sending, answer what it sent
+                } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    closeConnection(fd);
+                    return;
+                }
+                break;
+            }
+            auto received = Clock::now();
+            size_t start{0};
+            for (size_t end; (end = c.input.find('\n', start)) != string::npos; start = end + 1) {
+                string_view line(c.input.data() + start, end - start);
+                if (!line.empty() && line.back() == '\r') {
+                    line.remove_suffix(1);
+                }
+                bool move = line.starts_with("MOVE ");
+                if (move) {
+                    c.pendingMoves.push_back(received);
+                }
+                reply(c, handleLine(line), move);
+            }
+            c.input.erase(0, start);
+            if (c.input.size() > max_line_bytes) {
+                reply(c, "ERR line too long", false);
+                c.input.clear();
+                c.closing = true;
+            }
+        }
+
+        void flush(int fd) {
+            Connection& c = connections[fd];
+            while (!c.output.empty()) {
+                // a peer gone for good must not kill the server with SIGPIPE
+                ssize_t n = send(fd, c.output.data(), c.output.size(), MSG_NOSIGNAL);
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                    closeConnection(fd);
+                    return;
+                }
+                if (n <= 0) {
+                    break;
+                }
+                c.output.erase(0, static_cast<size_t>(n));
+            }
+            if (c.output.empty() && !c.pendingMoves.empty()) {
+                auto now = Clock::now();
+                std::lock_guard lock(statsMutex);
+                for (auto t : c.pendingMoves) {
+                    latency.record(now - t);
+                }
+                c.pendingMoves.clear();
+            }
+            if (c.closing && c.output.empty()) {
+                closeConnection(fd);
+                return;
+            }
+            epoll_event ev{};
+            ev.events = (c.closing ? 0u : static_cast<uint32_t>(EPOLLIN | EPOLLRDHUP)) |
+                        (c.output.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+            ev.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    public:
+        GameServer() {
+            auto initial = std::make_shared<Board>();
+            initial->init();
+            startPosition = initial->toCompact();
+            epollFd = epoll_create1(0);
+        }
+
+        ~GameServer() {
+            for (auto& [fd, c] : connections) {
+                close(fd);
+            }
+            for (int fd : listeners) {
+                close(fd);
+            }
+            close(epollFd);
+        }
+
+        bool listenTcp(uint16_t port) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            int one{1};
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+                close(fd);
+                return false;
+            }
+            addListener(fd);
+            return true;
+        }
+
+        bool listenUnix(const string& path) {
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+            // only a socket left by an earlier run is replaced, never another file
+            struct stat st{};
+            if (lstat(path.c_str(), &st) == 0) {
+                if (!S_ISSOCK(st.st_mode)) {
+                    std::cerr << path << " exists and is not a socket\n";
+                    close(fd);
+                    return false;
+                }
+                unlink(path.c_str());
+            }
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+                close(fd);
+                return false;
+            }
+            addListener(fd);
+            return true;
+        }
+
+        string statsLine() {
+            std::lock_guard lock(statsMutex);
+            char line[256];
+            std::snprintf(line, sizeof(line), "games=%zu accepted=%llu rejected=%llu p50_us=%llu p99_us=%llu max_us=%llu",
+                          games.size(), static_cast<unsigned long long>(accepted), static_cast<unsigned long long>(rejected),
+                          static_cast<unsigned long long>(latency.percentile(0.50)),
+                          static_cast<unsigned long long>(latency.percentile(0.99)),
+                          static_cast<unsigned long long>(latency.max()));
+            return line;
+        }
+
+        void run(const std::atomic<bool>& stop) {
+            std::array<epoll_event, 256> events{};
+            while (!stop.load(std::memory_order_relaxed)) {
+                int n = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 100);
+                for (int i{0}; i < n; ++i) {
+                    int fd = events[i].data.fd;
+                    if (std::find(listeners.begin(), listeners.end(), fd) != listeners.end()) {
+                        acceptAll(fd);
+                        continue;
+                    }
+                    if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !connections[fd].closing) {
+                        readFrom(fd);
+                    }
+                    if (connections.contains(fd)) {
+                        flush(fd);
+                    }
+                }
+            }
+        }
+    };
+
+    // Blocking line client used by the loopback benchmark.
+    class Client {
+    private:
+        int fd{-1};
+        string buffer;
+    public:
+        explicit Client(const string& unix_path) {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, unix_path.c_str(), sizeof(addr.sun_path) - 1);
+            if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                throw std::runtime_error("cannot connect to " + unix_path);
+            }
+        }
+
+        ~Client() {
+            close(fd);
+        }
+
+        string request(const string& line) {
+            string out = line + '\n';
+            for (size_t sent{0}; sent < out.size();) {
+                ssize_t n = write(fd, out.data() + sent, out.size() - sent);
+                if (n <= 0) {
+                    throw std::runtime_error("write failed");
+                }
+                sent += static_cast<size_t>(n);
+            }
+            size_t end;
+            while ((end = buffer.find('\n')) == string::npos) {
+                char chunk[4096];
+                ssize_t n = read(fd, chunk, sizeof(chunk));
+                if (n <= 0) {
+                    throw std::runtime_error("server closed the connection");
+                }
+                buffer.append(chunk, static_cast<size_t>(n));
+            }
+            string response = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            return response;
+        }
+    };
+
+    // Each client keeps `games` games open at once and plays random legal
+    // moves round robin, with an illegal move mixed in now and then.
+    void benchClient(const string& path, int games, int plies, uint64_t seed, LatencyHistogram& rtt, std::atomic<int>& errors) {
+        Client client(path);
+        std::mt19937_64 rng(seed);
+        auto board = std::make_shared<Board>();
+        board->init();
+        vector<pair<uint64_t, CompactBoard>> open;
+        for (int g{0}; g < games; ++g) {
+            string r = client.request("NEW");
+            open.emplace_back(std::stoull(r.substr(3)), board->toCompact());
+        }
+        vector<Move> moves;
+        for (int ply{0}; ply < plies; ++ply) {
+            for (auto& [id, position] : open) {
+                board->initFromCompact(position);
+                moves.clear();
+                board->generateLegalMoves(moves);
+                if (moves.empty()) {
+                    continue;
+                }
+                if (rng() % 10 == 0) {
+                    // the opponent's piece, always rejected
+                    client.request("MOVE " + std::to_string(id) + " " + Board::moveToString({moves[0].to, moves[0].from}));
+                }
+                Move m = moves[rng() % moves.size()];
+                auto start = Clock::now();
+                string r = client.request("MOVE " + std::to_string(id) + " " + Board::moveToString(m));
+                rtt.record(Clock::now() - start);
+                if (r != "OK") {
+                    errors.fetch_add(1);
+                    continue;
+                }
+                board->move(m.from, m.to);
+                position = board->toCompact();
+            }
+        }
+        for (auto& [id, position] : open) {
+            client.request("END " + std::to_string(id));
+        }
+    }
+
+    int usage() {
+        std::cerr << "usage: game_server [--port n] [--unix path]\n"
+                     "       game_server --bench-clients n --bench-games n --bench-plies n\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    int port{-1};
+    string unix_path;
+    int bench_clients{0};
+    int bench_games{100};
+    int bench_plies{40};
+    for (int i{1}; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            return usage();
+        }
+        string value = argv[++i];
+        if (arg == "--port") {
+            port = std::stoi(value);
+        } else if (arg == "--unix") {
+            unix_path = value;
+        } else if (arg == "--bench-clients") {
+            bench_clients = std::stoi(value);
+        } else if (arg == "--bench-games") {
+            bench_games = std::stoi(value);
+        } else if (arg == "--bench-plies") {
+            bench_plies = std::stoi(value);
+        } else {
+            return usage();
+        }
+    }
+    if (bench_clients > 0 && unix_path.empty()) {
+        unix_path = "/tmp/szachy_bench_" + std::to_string(getpid()) + ".sock";
+    }
+    if (port < 0 && unix_path.empty()) {
+        port = 7777;
+    }
+
+    GameServer server;
+    if (port >= 0 && !server.listenTcp(static_cast<uint16_t>(port))) {
+        std::cerr << "cannot listen on port " << port << "\n";
+        return 1;
+    }
+    if (!unix_path.empty() && !server.listenUnix(unix_path)) {
+        std::cerr << "cannot listen on " << unix_path << "\n";
+        return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    if (bench_clients == 0) {
+        server.run(stop);
+        return 0;
+    }
+
+    std::thread server_thread([&] { server.run(stop); });
+    vector<LatencyHistogram> rtts(static_cast<size_t>(bench_clients));
+    std::atomic<int> errors{0};
+    auto start = Clock::now();
+    {
+        vector<std::thread> clients;
+        for (int c{0}; c < bench_clients; ++c) {
+            clients.emplace_back([&, c] {
+                benchClient(unix_path, bench_games, bench_plies, static_cast<uint64_t>(c), rtts[static_cast<size_t>(c)], errors);
+            });
+        }
+        for (auto& t : clients) {
+            t.join();
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    LatencyHistogram rtt;
+    for (auto& h : rtts) {
+        rtt.merge(h);
+    }
+    std::printf("clients=%d concurrent_games=%d seconds=%.2f\n", bench_clients, bench_clients * bench_games, seconds);
+    std::printf("client round trip: p50_us=%llu p99_us=%llu max_us=%llu unexpected_errors=%d\n",
+                static_cast<unsigned long long>(rtt.percentile(0.50)), static_cast<unsigned long long>(rtt.percentile(0.99)),
+                static_cast<unsigned long long>(rtt.max()), errors.load());
+    stop.store(true);
+    server_thread.join();
+    std::printf("server: %s\n", server.statsLine().c_str());
+    unlink(unix_path.c_str());
+    return 0;
+}
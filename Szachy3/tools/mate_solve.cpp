@@ -0,0 +1,188 @@
+// Batch forced-mate solver for puzzle files (see MateSolver).
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o mate_solve mate_solve.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp
+//       ../evaluation.cpp ../mate_solver.cpp ../search.cpp ../search_stats.cpp ../trace.cpp ../thread_pool.cpp
+//       ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp ../time_manager.cpp
+//   ./mate_solve --in puzzles.txt [--threads n] [--nodes 50000000] [--hash 32] [--max-ply 127] [--checks-only 1]
+//                [--shortest 1] [--alphabeta-nodes 0]
+//
+// One puzzle per line: a FEN, optionally followed by ';' and the expected
+// mate length in moves. Lines starting with '#' are skipped. Every puzzle
+// prints its line number, MATE/NO_MATE/UNKNOWN, the mate length, nodes, time
+// and the mating line; a mismatch with the expected length is marked. With
+// --alphabeta-nodes n the same puzzle is also given to the Searcher with
+// that node limit, to compare the effort needed to see the mate score.
+#include "board.h"
+#include "mate_solver.h"
+#include "search.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct Puzzle {
+        int line{0};
+        string fen;
+        int expected{0}; // 0 - not given
+    };
+
+    struct Config {
+        string in;
+        size_t threads{std::thread::hardware_concurrency()};
+        MateSolverOptions options;
+        uint64_t alphaBetaNodes{0};
+    };
+
+    vector<Puzzle> readPuzzles(const string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        vector<Puzzle> puzzles;
+        int line_number{0};
+        for (string line; std::getline(in, line);) {
+            ++line_number;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            Puzzle p{line_number, line, 0};
+            auto semicolon = line.find(';');
+            if (semicolon != string::npos) {
+                p.fen = line.substr(0, semicolon);
+                p.expected = std::stoi(line.substr(semicolon + 1));
+            }
+            puzzles.push_back(p);
+        }
+        return puzzles;
+    }
+
+    const char* statusName(MateStatus status) {
+        switch (status) {
+            case MateStatus::MATE:
+                return "MATE";
+            case MateStatus::NO_MATE:
+                return "NO_MATE";
+            default:
+                return "UNKNOWN";
+        }
+    }
+
+    // Nodes the Searcher needs until an iteration reports a mate score, 0 if it never does.
+    uint64_t alphaBetaNodes(Board& board, uint64_t node_limit) {
+        SearchOptions options;
+        options.hashMegabytes = 32;
+        Searcher searcher(options);
+        uint64_t found{0};
+        searcher.search(board, SearchLimits{.nodes = node_limit}, [&](const SearchResult& r) {
+            if (found == 0 && r.score > mate_score - max_ply) {
+                found = r.nodes;
+                searcher.stop();
+            }
+        });
+        return found;
+    }
+
+    int usage() {
+        std::cerr << "usage: mate_solve --in file [--threads n] [--nodes n] [--hash mb] [--max-ply n] [--checks-only 0/1]\n"
+                     "                  [--shortest 0/1] [--alphabeta-nodes n]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    try {
+        for (int i{1}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--in") {
+                config.in = value;
+            } else if (arg == "--threads") {
+                config.threads = std::stoul(value);
+            } else if (arg == "--nodes") {
+                config.options.maxNodes = std::stoull(value);
+            } else if (arg == "--hash") {
+                config.options.tableMegabytes = std::stoul(value);
+            } else if (arg == "--max-ply") {
+                config.options.maxPly = std::stoi(value);
+            } else if (arg == "--checks-only") {
+                config.options.checksOnly = std::stoi(value) != 0;
+            } else if (arg == "--shortest") {
+                config.options.shortest = std::stoi(value) != 0;
+            } else if (arg == "--alphabeta-nodes") {
+                config.alphaBetaNodes = std::stoull(value);
+            } else {
+                return usage();
+            }
+        }
+        if (config.in.empty()) {
+            return usage();
+        }
+
+        vector<Puzzle> puzzles = readPuzzles(config.in);
+        size_t threads = std::max<size_t>(config.threads, 1);
+        // one solver (and its table) per worker, reused for all its puzzles
+        vector<std::unique_ptr<MateSolver>> solvers;
+        for (size_t t{0}; t < threads; ++t) {
+            solvers.push_back(std::make_unique<MateSolver>(config.options));
+        }
+        std::mutex output;
+        std::atomic<int> solved{0};
+        std::atomic<int> mismatches{0};
+        auto start = std::chrono::steady_clock::now();
+        {
+            ThreadPool pool(threads);
+            for (const auto& puzzle : puzzles) {
+                pool.submit([&, puzzle] {
+                    MateSolver& solver = *solvers[ThreadPool::currentWorker()];
+                    auto board = std::make_shared<Board>();
+                    string line;
+                    try {
+                        board->initFromFen(puzzle.fen);
+                        auto t0 = std::chrono::steady_clock::now();
+                        MateResult result = solver.solve(*board);
+                        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                        line = std::to_string(puzzle.line) + " " + statusName(result.status) + " " + std::to_string(result.mateIn) +
+                               " nodes " + std::to_string(result.nodes) + " time " + std::to_string(static_cast<long>(ms)) + "ms";
+                        if (config.alphaBetaNodes != 0 && result.status == MateStatus::MATE) {
+                            uint64_t n = alphaBetaNodes(*board, config.alphaBetaNodes);
+                            line += " alphabeta " + (n ? std::to_string(n) : ">" + std::to_string(config.alphaBetaNodes));
+                        }
+                        line += " pv";
+                        for (Move m : result.pv) {
+                            line += " " + Board::moveToString(m);
+                        }
+                        if (result.status == MateStatus::MATE) {
+                            solved.fetch_add(1);
+                        }
+                        if (puzzle.expected != 0 && (result.status != MateStatus::MATE || result.mateIn != puzzle.expected)) {
+                            mismatches.fetch_add(1);
+                            line += "  expected mate in " + std::to_string(puzzle.expected);
+                        }
+                    } catch (const std::exception& e) {
+                        line = std::to_string(puzzle.line) + " error: " + e.what();
+                    }
+                    std::lock_guard lock(output);
+                    std::printf("%s\n", line.c_str());
+                });
+            }
+            pool.wait();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("puzzles %zu  mates %d  mismatches %d  time %.2fs\n", puzzles.size(), solved.load(), mismatches.load(), seconds);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Tactical puzzle miner over game collections (see PuzzleMiner).
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o mine_puzzles mine_puzzles.cpp ../puzzle_miner.cpp ../game_file.cpp
+//       ../thread_pool.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp ../evaluation.cpp ../search.cpp
+//       ../search_stats.cpp ../trace.cpp ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp
+//       ../time_manager.cpp
+//   ./mine_puzzles --games a.txt,b.txt [--out puzzles.txt] [--depth 6] [--nodes 0] [--threads n] [--hash 4]
+//                  [--min-gain 2] [--min-score 250] [--min-margin 150] [--max-mate 5] [--solution-moves 4]
+//
+// Game files have one game per line, the result followed by the moves from
+// the initial position (see game_file.h). One puzzle per line is written,
+// in the order they first occur in the games:
+//   <fen>;<solution moves>;mate <n>   or   <fen>;<solution moves>;cp <score>
+// The solver is to move in the FEN and plays the first solution move. How
+// many positions each stage let through goes to stderr.
+#include "puzzle_miner.h"
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Config {
+        vector<string> games;
+        string out;
+        PuzzleOptions options;
+    };
+
+    vector<string> split(const string& s, char separator) {
+        vector<string> parts;
+        std::stringstream in(s);
+        for (string part; std::getline(in, part, separator);) {
+            if (!part.empty()) {
+                parts.push_back(part);
+            }
+        }
+        return parts;
+    }
+
+    int mine(const Config& config) {
+        std::FILE* out = config.out.empty() ? stdout : std::fopen(config.out.c_str(), "w");
+        if (out == nullptr) {
+            throw std::runtime_error("cannot open " + config.out);
+        }
+        PuzzleMiner miner(config.options);
+        uint64_t shown{0};
+        MiningStats stats = miner.mine(
+                config.games,
+                [&](const Puzzle& puzzle) {
+                    string moves;
+                    for (Move m : puzzle.solution) {
+                        moves += moves.empty() ? "" : " ";
+                        moves += Board::moveToString(m);
+                    }
+                    if (puzzle.isMate()) {
+                        std::fprintf(out, "%s;%s;mate %d\n", puzzle.fen.c_str(), moves.c_str(), puzzle.mateIn());
+                    } else {
+                        std::fprintf(out, "%s;%s;cp %d\n", puzzle.fen.c_str(), moves.c_str(), puzzle.score);
+                    }
+                    std::fflush(out);
+                },
+                [&](uint64_t bytes) {
+                    if (bytes >= shown + (uint64_t{16} << 20)) {
+                        shown = bytes;
+                        std::fprintf(stderr, "\r%.0f MB", static_cast<double>(bytes) / 1e6);
+                    }
+                });
+        if (out != stdout) {
+            std::fclose(out);
+        }
+        auto share = [&](uint64_t n) { return stats.positions ? 100.0 * static_cast<double>(n) / static_cast<double>(stats.positions) : 0.0; };
+        std::fprintf(stderr, "\ngames %llu (%llu invalid), positions %llu in %.2fs (%.0f positions/s)\n",
+                     static_cast<unsigned long long>(stats.games), static_cast<unsigned long long>(stats.invalidGames),
+                     static_cast<unsigned long long>(stats.positions), stats.seconds,
+                     static_cast<double>(stats.positions) / stats.seconds);
+        std::fprintf(stderr, "candidates %llu (%.2f%%), cached %llu, searched %llu (%.2f%%) for %.2fs of thread time\n",
+                     static_cast<unsigned long long>(stats.candidates), share(stats.candidates),
+                     static_cast<unsigned long long>(stats.cached), static_cast<unsigned long long>(stats.verified),
+                     share(stats.verified), stats.verifySeconds);
+        std::fprintf(stderr, "puzzles %llu, duplicates %llu\n", static_cast<unsigned long long>(stats.puzzles),
+                     static_cast<unsigned long long>(stats.duplicates));
+        return 0;
+    }
+
+    int usage() {
+        std::cerr << "usage: mine_puzzles --games file[,file...] [--out file] [--depth n] [--nodes n] [--threads n]\n"
+                     "                    [--hash mb] [--min-gain pawns] [--min-score cp] [--min-margin cp]\n"
+                     "                    [--max-mate n] [--solution-moves n]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    try {
+        for (int i{1}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--games") {
+                config.games = split(value, ',');
+            } else if (arg == "--out") {
+                config.out = value;
+            } else if (arg == "--depth") {
+                config.options.depth = std::stoi(value);
+            } else if (arg == "--nodes") {
+                config.options.nodes = std::stoull(value);
+            } else if (arg == "--threads") {
+                config.options.threads = std::stoul(value);
+            } else if (arg == "--hash") {
+                config.options.hashMegabytes = std::stoul(value);
+            } else if (arg == "--min-gain") {
+                config.options.minGain = std::stoi(value);
+            } else if (arg == "--min-score") {
+                config.options.minScore = std::stoi(value);
+            } else if (arg == "--min-margin") {
+                config.options.minMargin = std::stoi(value);
+            } else if (arg == "--max-mate") {
+                config.options.maxMateMoves = std::stoi(value);
+            } else if (arg == "--solution-moves") {
+                config.options.maxSolutionMoves = std::stoi(value);
+            } else {
+                return usage();
+            }
+        }
+        if (config.games.empty()) {
+            return usage();
+        }
+        return mine(config);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,190 @@
+// Position frequency tables for opening statistics (see countPositions).
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o opening_stats opening_stats.cpp ../position_counts.cpp ../game_file.cpp
+//       ../mapped_file.cpp ../thread_pool.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp
+//       ../search_stats.cpp ../trace.cpp ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp
+//   ./opening_stats count --games a.txt,b.txt --out table.bin [--memory 256] [--threads n] [--temp dir]
+//                         [--fan-in 64] [--max-ply 0]
+//   ./opening_stats lookup --table table.bin [--moves "e2e4 e7e5"] [--fen fen]
+//   ./opening_stats top --table table.bin [--count 20]
+//
+// Game files have one game per line, the result followed by the moves from
+// the initial position: "1/2-1/2 e2e4 c7c5 g1f3 ...". lookup lists the
+// moves played from a position (the initial one, the one after --moves, or
+// --fen) with their white wins, draws and black wins; top lists the
+// positions reached most often.
+#include "board.h"
+#include "position_counts.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Config {
+        vector<string> games;
+        string out;
+        string table;
+        string moves;
+        string fen;
+        size_t count{20};
+        CountOptions options;
+    };
+
+    vector<string> split(const string& s, char separator) {
+        vector<string> parts;
+        std::stringstream in(s);
+        for (string part; std::getline(in, part, separator);) {
+            if (!part.empty()) {
+                parts.push_back(part);
+            }
+        }
+        return parts;
+    }
+
+    int count(const Config& config) {
+        uint64_t shown{0};
+        CountStats stats = countPositions(config.games, config.out, config.options, [&](const char* stage, uint64_t bytes) {
+            if (bytes >= shown + (uint64_t{16} << 20)) {
+                shown = bytes;
+                std::fprintf(stderr, "\r%-6s %.0f MB", stage, static_cast<double>(bytes) / 1e6);
+            }
+        });
+        double seconds = stats.replaySeconds + stats.mergeSeconds;
+        std::fprintf(stderr, "\n");
+        std::printf("games %llu (%llu invalid), positions %llu, distinct position-moves %llu\n",
+                    static_cast<unsigned long long>(stats.games), static_cast<unsigned long long>(stats.invalidGames),
+                    static_cast<unsigned long long>(stats.positions), static_cast<unsigned long long>(stats.records));
+        std::printf("replay %.2fs (%.0f positions/s), %llu runs, %d merge passes %.2fs\n", stats.replaySeconds,
+                    static_cast<double>(stats.positions) / stats.replaySeconds, static_cast<unsigned long long>(stats.runs),
+                    stats.mergePasses, stats.mergeSeconds);
+        std::printf("read %.1f MB, wrote %.1f MB, %.1f MB/s overall\n", static_cast<double>(stats.bytesRead) / 1e6,
+                    static_cast<double>(stats.bytesWritten) / 1e6,
+                    static_cast<double>(stats.bytesRead + stats.bytesWritten) / 1e6 / seconds);
+        return 0;
+    }
+
+    int lookup(const Config& config) {
+        auto board = std::make_shared<Board>();
+        if (config.fen.empty()) {
+            board->init();
+        } else {
+            board->initFromFen(config.fen);
+        }
+        for (const string& notation : split(config.moves, ' ')) {
+            if (board->tryMove(Board::moveFromString(notation)) != MoveStatus::OK) {
+                throw std::invalid_argument("Illegal move " + notation);
+            }
+        }
+        PositionTable table(config.table);
+        std::span<const PositionCount> moves = table.find(board->getPositionKey());
+        vector<PositionCount> sorted(moves.begin(), moves.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const PositionCount& a, const PositionCount& b) { return a.games() > b.games(); });
+        std::printf("%-6s %10s %10s %10s %10s\n", "move", "games", "white", "draw", "black");
+        for (const PositionCount& r : sorted) {
+            Move m = r.decode();
+            auto result = [&](GameResult g) { return static_cast<unsigned long long>(r.results[static_cast<size_t>(g)]); };
+            std::printf("%-6s %10llu %10llu %10llu %10llu\n", m.isNull() ? "(end)" : Board::moveToString(m).c_str(),
+                        static_cast<unsigned long long>(r.games()), result(GameResult::WHITE_WIN), result(GameResult::DRAW),
+                        result(GameResult::BLACK_WIN));
+        }
+        return 0;
+    }
+
+    int top(const Config& config) {
+        PositionTable table(config.table);
+        // records of a position are adjacent, keep the most frequent in a min-heap
+        using Entry = std::pair<uint64_t, uint64_t>; // games, key
+        std::priority_queue<Entry, vector<Entry>, std::greater<>> best;
+        std::span<const PositionCount> all = table.all();
+        uint64_t positions{0};
+        for (size_t i{0}; i < all.size();) {
+            uint64_t key = all[i].key;
+            uint64_t games{0};
+            for (; i < all.size() && all[i].key == key; ++i) {
+                games += all[i].games();
+            }
+            ++positions;
+            best.emplace(games, key);
+            if (best.size() > config.count) {
+                best.pop();
+            }
+        }
+        vector<Entry> sorted;
+        for (; !best.empty(); best.pop()) {
+            sorted.push_back(best.top());
+        }
+        std::printf("%llu distinct positions\n", static_cast<unsigned long long>(positions));
+        for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
+            std::printf("%016llx %llu\n", static_cast<unsigned long long>(it->second), static_cast<unsigned long long>(it->first));
+        }
+        return 0;
+    }
+
+    int usage() {
+        std::cerr << "usage: opening_stats count --games file[,file...] --out file [--memory mb] [--threads n] [--temp dir]\n"
+                     "                           [--fan-in n] [--max-ply n]\n"
+                     "       opening_stats lookup --table file [--moves \"e2e4 e7e5\"] [--fen fen]\n"
+                     "       opening_stats top --table file [--count n]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        return usage();
+    }
+    string command = argv[1];
+    Config config;
+    try {
+        for (int i{2}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--games") {
+                config.games = split(value, ',');
+            } else if (arg == "--out") {
+                config.out = value;
+            } else if (arg == "--table") {
+                config.table = value;
+            } else if (arg == "--moves") {
+                config.moves = value;
+            } else if (arg == "--fen") {
+                config.fen = value;
+            } else if (arg == "--count") {
+                config.count = std::stoul(value);
+            } else if (arg == "--memory") {
+                config.options.memoryBytes = std::stoull(value) << 20;
+            } else if (arg == "--threads") {
+                config.options.threads = std::stoul(value);
+            } else if (arg == "--temp") {
+                config.options.tempDirectory = value;
+            } else if (arg == "--fan-in") {
+                config.options.fanIn = std::stoul(value);
+            } else if (arg == "--max-ply") {
+                config.options.maxPly = std::stoi(value);
+            } else {
+                return usage();
+            }
+        }
+        if (command == "count" && !config.games.empty() && !config.out.empty()) {
+            return count(config);
+        }
+        if (command == "lookup" && !config.table.empty()) {
+            return lookup(config);
+        }
+        if (command == "top" && !config.table.empty()) {
+            return top(config);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return usage();
+}
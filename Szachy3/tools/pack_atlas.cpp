@@ -0,0 +1,111 @@
+// Build-time packer for the GUI's sprite atlas (see SpriteAtlas).
+//
+//   g++ -std=c++20 -O2 -I.. -o pack_atlas pack_atlas.cpp ../image_codec.cpp ../sprite_atlas.cpp ../sprite_atlas_writer.cpp
+//   ./pack_atlas --assets .. --out ../sprites.atlas [--sizes 25,50,75,100,150,200]
+//   ./pack_atlas --list ../sprites.atlas
+//
+// Packs every .png and .bmp file of the assets directory, named by the file
+// name without extension, so the fairy pieces are included as they are added.
+// Each sprite keeps a hash of its file. The GUI maps sprites.atlas from its
+// working directory at startup and falls back to decoding the image files
+// when the atlas is missing, lacks a sprite, or a file's hash differs; the
+// project's PackSpriteAtlas target repacks it whenever an image changes.
+#include "image_codec.h"
+#include "sprite_atlas.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    vector<int> parseSizes(const string& list) {
+        vector<int> sizes;
+        std::stringstream in(list);
+        for (string item; std::getline(in, item, ',');) {
+            sizes.push_back(std::stoi(item));
+        }
+        return sizes;
+    }
+
+    int pack(const string& assets, const string& out, const vector<int>& sizes) {
+        vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(assets)) {
+            string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (entry.is_regular_file() && (extension == ".png" || extension == ".bmp")) {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        vector<AtlasSource> sprites;
+        for (const auto& file : files) {
+            sprites.push_back({file.stem().string(), loadImage(file.string()), hashSpriteSource(file.string())});
+        }
+        writeSpriteAtlas(out, sprites, sizes);
+        std::printf("packed %zu sprites at %zu sizes into %s (%ju bytes)\n", sprites.size(), sizes.size(), out.c_str(),
+                    static_cast<uintmax_t>(std::filesystem::file_size(out)));
+        return 0;
+    }
+
+    int list(const string& path) {
+        auto start = std::chrono::steady_clock::now();
+        SpriteAtlas atlas(path);
+        double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%zu sprites, opened in %.0fus\n", atlas.spriteCount(), microseconds);
+        for (size_t l{0}; l < atlas.levelCount(); ++l) {
+            std::printf("level %zu: %dpx tiles\n", l, atlas.tileSize(l));
+        }
+        for (size_t i{0}; i < atlas.spriteCount(); ++i) {
+            std::printf("%3zu %.*s %016llx\n", i, static_cast<int>(atlas.name(i).size()), atlas.name(i).data(),
+                        static_cast<unsigned long long>(atlas.sourceHash(i)));
+        }
+        return 0;
+    }
+
+    int usage() {
+        std::cerr << "usage: pack_atlas --assets dir --out file [--sizes 25,50,75,100,150,200]\n"
+                     "       pack_atlas --list file\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    string assets;
+    string out;
+    string listed;
+    vector<int> sizes{25, 50, 75, 100, 150, 200};
+    try {
+        for (int i{1}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--assets") {
+                assets = value;
+            } else if (arg == "--out") {
+                out = value;
+            } else if (arg == "--sizes") {
+                sizes = parseSizes(value);
+            } else if (arg == "--list") {
+                listed = value;
+            } else {
+                return usage();
+            }
+        }
+        if (!listed.empty()) {
+            return list(listed);
+        }
+        if (!assets.empty() && !out.empty()) {
+            return pack(assets, out, sizes);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return usage();
+}
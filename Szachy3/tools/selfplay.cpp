@@ -0,0 +1,375 @@
+// Headless engine-vs-engine match runner with live Elo and SPRT statistics.
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o selfplay selfplay.cpp ../board.cpp ../board_exceptions.cpp ../board_snapshot.cpp
+//       ../evaluation.cpp ../search.cpp ../search_stats.cpp ../trace.cpp ../thread_pool.cpp
+//       ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp ../time_manager.cpp
+//   ./selfplay --games 2000 --engine-a depth=4 --engine-b depth=4,lmr=0 --openings book.fen
+//   ./selfplay --games 200 --engine-a time=10000,inc=100 --engine-b time=10000,inc=100
+//
+// Engine options (comma separated key=value): depth, nodes, movetime (ms per
+// move), time and inc (ms on the clock and added per move; the engine budgets
+// its moves with TimeManager, loses when its flag falls and has no default
+// depth limit), qsearch (0/1), lmr (0/1), hash (MB). Every opening is played
+// twice with colors reversed. Each game owns its Board and Searchers; games
+// only share the result counters. The match stops as soon as the SPRT for
+// [elo0, elo1] accepts either hypothesis.
+#include "board.h"
+#include "search.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct EngineConfig {
+        SearchLimits limits{.depth = 4};
+        SearchOptions options{.hashMegabytes = 4};
+        std::chrono::milliseconds time{0}; // 0 - no clock
+        std::chrono::milliseconds increment{0};
+    };
+
+    struct MatchConfig {
+        int games{1000};
+        size_t threads{std::thread::hardware_concurrency()};
+        int randomPlies{0};
+        int maxPlies{300};
+        int resignScore{1000};
+        int resignPlies{6};
+        int drawAfter{80};
+        int drawScore{10};
+        int drawPlies{16};
+        double elo0{0.0};
+        double elo1{5.0};
+        double alpha{0.05};
+        double beta{0.05};
+        EngineConfig a;
+        EngineConfig b;
+        vector<string> openings;
+    };
+
+    const vector<string> default_openings{
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w - - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+        "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+        "rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w - - 0 2",
+        "rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w - - 1 2",
+        "rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+        "rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w - - 0 2",
+        "rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b - - 0 1",
+    };
+
+    enum class Outcome { WHITE_WINS, BLACK_WINS, DRAW, ABORTED };
+
+    struct Tally {
+        std::atomic<int> wins{0}; // from engine A's point of view
+        std::atomic<int> draws{0};
+        std::atomic<int> losses{0};
+        std::atomic<int> finished{0};
+        std::atomic<int> timeForfeits{0};
+        std::atomic<bool> stop{false};
+    };
+
+    double eloToScore(double elo) {
+        return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+    }
+
+    double scoreToElo(double score) {
+        score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+        return -400.0 * std::log10(1.0 / score - 1.0);
+    }
+
+    struct Statistics {
+        double elo{0.0};
+        double eloError{0.0}; // 95% confidence
+        double llr{0.0};
+    };
+
+    // Generalized SPRT on the trinomial (win/draw/loss) distribution.
+    Statistics statistics(int w, int d, int l, const MatchConfig& config) {
+        Statistics st;
+        double n = w + d + l;
+        if (n == 0) {
+            return st;
+        }
+        double score = (w + 0.5 * d) / n;
+        double variance = (w + 0.25 * d) / n - score * score;
+        st.elo = scoreToElo(score);
+        if (variance <= 0.0) {
+            return st;
+        }
+        double error = 1.959964 * std::sqrt(variance / n);
+        st.eloError = (scoreToElo(score + error) - scoreToElo(score - error)) / 2.0;
+        double s0 = eloToScore(config.elo0);
+        double s1 = eloToScore(config.elo1);
+        st.llr = n * (s1 - s0) * (2.0 * score - s0 - s1) / (2.0 * variance);
+        return st;
+    }
+
+    EngineConfig parseEngine(const string& spec) {
+        EngineConfig e;
+        bool has_depth{false};
+        std::stringstream ss(spec);
+        for (string item; std::getline(ss, item, ',');) {
+            auto eq = item.find('=');
+            if (eq == string::npos) {
+                throw std::invalid_argument("Invalid engine option: " + item);
+            }
+            string key = item.substr(0, eq);
+            long long value = std::stoll(item.substr(eq + 1));
+            if (key == "depth") {
+                e.limits.depth = static_cast<int>(value);
+                has_depth = true;
+            } else if (key == "nodes") {
+                e.limits.nodes = static_cast<uint64_t>(value);
+            } else if (key == "movetime") {
+                e.limits.moveTime = std::chrono::milliseconds(value);
+            } else if (key == "time") {
+                e.time = std::chrono::milliseconds(value);
+            } else if (key == "inc") {
+                e.increment = std::chrono::milliseconds(value);
+            } else if (key == "qsearch") {
+                e.options.quiescence = value != 0;
+            } else if (key == "lmr") {
+                e.options.lateMoveReductions = value != 0;
+            } else if (key == "hash") {
+                e.options.hashMegabytes = static_cast<size_t>(value);
+            } else {
+                throw std::invalid_argument("Unknown engine option: " + key);
+            }
+        }
+        if (e.time.count() != 0 && !has_depth) {
+            e.limits.depth = max_ply - 1;
+        }
+        return e;
+    }
+
+    Outcome playGame(const MatchConfig& config, const string& opening, uint64_t seed, bool a_is_white, Tally& tally) {
+        auto board = std::make_shared<Board>();
+        board->initFromFen(opening);
+        vector<Move> moves;
+        std::mt19937_64 rng(seed);
+        for (int i{0}; i < config.randomPlies; ++i) {
+            moves.clear();
+            board->generateLegalMoves(moves);
+            if (moves.empty()) {
+                break;
+            }
+            Move m = moves[rng() % moves.size()];
+            board->move(m.from, m.to);
+        }
+
+        Searcher white(a_is_white ? config.a.options : config.b.options);
+        Searcher black(a_is_white ? config.b.options : config.a.options);
+        const EngineConfig& white_engine = a_is_white ? config.a : config.b;
+        const EngineConfig& black_engine = a_is_white ? config.b : config.a;
+        std::chrono::milliseconds white_clock = white_engine.time;
+        std::chrono::milliseconds black_clock = black_engine.time;
+        int winning_streak{0}; // consecutive plies with a decisive score, positive for white
+        int drawn_streak{0};
+        for (int ply{0}; ply < config.maxPlies; ++ply) {
+            if (tally.stop.load(std::memory_order_relaxed)) {
+                return Outcome::ABORTED;
+            }
+            bool white_to_move = board->getTurn() == WHITE;
+            const EngineConfig& engine = white_to_move ? white_engine : black_engine;
+            std::chrono::milliseconds& clock = white_to_move ? white_clock : black_clock;
+            SearchLimits limits = engine.limits;
+            if (engine.time.count() != 0) {
+                limits.clock = TimeControl{clock, engine.increment};
+            }
+            auto start = std::chrono::steady_clock::now();
+            SearchResult result = white_to_move ? white.search(*board, limits) : black.search(*board, limits);
+            if (engine.time.count() != 0) {
+                clock -= std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+                if (clock.count() < 0) {
+                    tally.timeForfeits.fetch_add(1);
+                    return white_to_move ? Outcome::BLACK_WINS : Outcome::WHITE_WINS;
+                }
+                clock += engine.increment;
+            }
+            if (result.bestMove.isNull()) {
+                if (result.score == 0) {
+                    return Outcome::DRAW;
+                }
+                return white_to_move ? Outcome::BLACK_WINS : Outcome::WHITE_WINS;
+            }
+            int white_score = white_to_move ? result.score : -result.score;
+            if (white_score >= config.resignScore) {
+                winning_streak = std::max(winning_streak, 0) + 1;
+            } else if (white_score <= -config.resignScore) {
+                winning_streak = std::min(winning_streak, 0) - 1;
+            } else {
+                winning_streak = 0;
+            }
+            if (winning_streak >= config.resignPlies) {
+                return Outcome::WHITE_WINS;
+            }
+            if (winning_streak <= -config.resignPlies) {
+                return Outcome::BLACK_WINS;
+            }
+            drawn_streak = (ply >= config.drawAfter && std::abs(white_score) <= config.drawScore) ? drawn_streak + 1 : 0;
+            if (drawn_streak >= config.drawPlies) {
+                return Outcome::DRAW;
+            }
+            board->move(result.bestMove.from, result.bestMove.to);
+            if (board->isThreefoldRepetition() || board->isFiftyMoveDraw()) {
+                return Outcome::DRAW;
+            }
+        }
+        return Outcome::DRAW;
+    }
+
+    void printStatus(const Tally& tally, const MatchConfig& config, double lower, double upper) {
+        int w = tally.wins.load();
+        int d = tally.draws.load();
+        int l = tally.losses.load();
+        Statistics st = statistics(w, d, l, config);
+        std::printf("games %d  +%d =%d -%d  elo %.1f +- %.1f  llr %.2f [%.2f, %.2f]  time forfeits %d\n",
+                    w + d + l, w, d, l, st.elo, st.eloError, st.llr, lower, upper, tally.timeForfeits.load());
+        std::fflush(stdout);
+    }
+
+    int usage() {
+        std::cerr << "usage: selfplay [--games n] [--threads n] [--openings file] [--random-plies n]\n"
+                     "                [--engine-a spec] [--engine-b spec] [--max-plies n]\n"
+                     "                [--resign-score cp] [--resign-plies n] [--draw-after n] [--draw-score cp] [--draw-plies n]\n"
+                     "                [--elo0 x] [--elo1 x] [--alpha x] [--beta x]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    MatchConfig config;
+    string openings_file;
+    try {
+        for (int i{1}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--games") {
+                config.games = std::stoi(value);
+            } else if (arg == "--threads") {
+                config.threads = std::stoul(value);
+            } else if (arg == "--openings") {
+                openings_file = value;
+            } else if (arg == "--random-plies") {
+                config.randomPlies = std::stoi(value);
+            } else if (arg == "--engine-a") {
+                config.a = parseEngine(value);
+            } else if (arg == "--engine-b") {
+                config.b = parseEngine(value);
+            } else if (arg == "--max-plies") {
+                config.maxPlies = std::stoi(value);
+            } else if (arg == "--resign-score") {
+                config.resignScore = std::stoi(value);
+            } else if (arg == "--resign-plies") {
+                config.resignPlies = std::stoi(value);
+            } else if (arg == "--draw-after") {
+                config.drawAfter = std::stoi(value);
+            } else if (arg == "--draw-score") {
+                config.drawScore = std::stoi(value);
+            } else if (arg == "--draw-plies") {
+                config.drawPlies = std::stoi(value);
+            } else if (arg == "--elo0") {
+                config.elo0 = std::stod(value);
+            } else if (arg == "--elo1") {
+                config.elo1 = std::stod(value);
+            } else if (arg == "--alpha") {
+                config.alpha = std::stod(value);
+            } else if (arg == "--beta") {
+                config.beta = std::stod(value);
+            } else {
+                return usage();
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return usage();
+    }
+
+    config.openings = default_openings;
+    if (!openings_file.empty()) {
+        std::ifstream in(openings_file);
+        if (!in) {
+            std::cerr << "cannot open " << openings_file << "\n";
+            return 1;
+        }
+        config.openings.clear();
+        for (string line; std::getline(in, line);) {
+            if (!line.empty() && line[0] != '#') {
+                config.openings.push_back(line);
+            }
+        }
+        if (config.openings.empty()) {
+            std::cerr << "no openings in " << openings_file << "\n";
+            return 1;
+        }
+    }
+
+    double lower = std::log(config.beta / (1.0 - config.alpha));
+    double upper = std::log((1.0 - config.beta) / config.alpha);
+    Tally tally;
+    {
+        ThreadPool pool(config.threads);
+        for (int game{0}; game < config.games; ++game) {
+            pool.submit([&config, &tally, game] {
+                if (tally.stop.load(std::memory_order_relaxed)) {
+                    return;
+                }
+                int pair = game / 2;
+                bool a_is_white = game % 2 == 0;
+                const string& opening = config.openings[pair % config.openings.size()];
+                Outcome outcome = playGame(config, opening, static_cast<uint64_t>(pair), a_is_white, tally);
+                if (outcome == Outcome::ABORTED) {
+                    return;
+                }
+                if (outcome == Outcome::DRAW) {
+                    tally.draws.fetch_add(1);
+                } else if ((outcome == Outcome::WHITE_WINS) == a_is_white) {
+                    tally.wins.fetch_add(1);
+                } else {
+                    tally.losses.fetch_add(1);
+                }
+                tally.finished.fetch_add(1);
+            });
+        }
+
+        auto last_report = std::chrono::steady_clock::now();
+        int reported{0};
+        while (tally.finished.load() < config.games && !tally.stop.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            int finished = tally.finished.load();
+            Statistics st = statistics(tally.wins.load(), tally.draws.load(), tally.losses.load(), config);
+            if (st.llr <= lower || st.llr >= upper) {
+                tally.stop.store(true);
+            }
+            if (finished != reported && std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(1)) {
+                printStatus(tally, config, lower, upper);
+                last_report = std::chrono::steady_clock::now();
+                reported = finished;
+            }
+        }
+        pool.wait();
+    }
+
+    printStatus(tally, config, lower, upper);
+    Statistics st = statistics(tally.wins.load(), tally.draws.load(), tally.losses.load(), config);
+    if (st.llr >= upper) {
+        std::printf("H1 accepted: engine A is stronger by at least %.1f elo\n", config.elo1);
+    } else if (st.llr <= lower) {
+        std::printf("H0 accepted: engine A is not stronger by %.1f elo\n", config.elo1);
+    } else {
+        std::printf("inconclusive\n");
+    }
+    return 0;
+}
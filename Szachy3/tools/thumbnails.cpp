@@ -0,0 +1,178 @@
+// Batch board thumbnails for game-archive previews, rendered without a window (see SoftwareRenderer).
+//
+//   g++ -std=c++20 -O2 -pthread -I.. -o thumbnails thumbnails.cpp ../board.cpp ../board_exceptions.cpp
+//       ../board_snapshot.cpp ../image_codec.cpp ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp
+//       ../search_stats.cpp ../software_renderer.cpp ../thread_pool.cpp ../trace.cpp
+//   ./thumbnails --in positions.fen --out thumbs/ [--assets ..] [--tile 32] [--coordinates 1] [--flip 0] [--threads n]
+//   ./thumbnails --in positions.fen --bench 10 [--tile 32]
+//
+// One FEN per line; lines starting with '#' are skipped. Position i (0-based,
+// in file order) is written to <out>/<i>.png. --bench renders the whole list
+// the given number of times and reports thumbnails per second, first without
+// and then with PNG encoding, without writing anything.
+#include "board.h"
+#include "software_renderer.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr size_t chunk_size{256};
+
+    struct Config {
+        string in;
+        string out;
+        string assets{".."};
+        RenderOptions options;
+        size_t threads{std::thread::hardware_concurrency()};
+        int bench{0};
+    };
+
+    vector<string> readPositions(const string& path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        vector<string> fens;
+        for (string line; std::getline(in, line);) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#') {
+                fens.push_back(line);
+            }
+        }
+        return fens;
+    }
+
+    // Board snapshots of every position, so the timed part is only rendering.
+    vector<BoardSnapshot> loadSnapshots(const vector<string>& fens) {
+        vector<BoardSnapshot> snapshots(fens.size());
+        auto board = std::make_shared<Board>();
+        for (size_t i{0}; i < fens.size(); ++i) {
+            board->initFromFen(fens[i]);
+            board->snapshots().read(snapshots[i]);
+        }
+        return snapshots;
+    }
+
+    // Renders positions [begin, end) on the pool, one reused framebuffer per chunk.
+    template <typename Sink>
+    void renderAll(ThreadPool& pool, const SoftwareRenderer& renderer, const RenderOptions& options,
+                   const vector<BoardSnapshot>& positions, Sink sink) {
+        for (size_t begin{0}; begin < positions.size(); begin += chunk_size) {
+            pool.submit([&, begin, sink] {
+                Image frame;
+                size_t end = std::min(begin + chunk_size, positions.size());
+                for (size_t i{begin}; i < end; ++i) {
+                    renderer.render(positions[i], options, frame);
+                    sink(i, frame);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    int bench(const Config& config, const vector<BoardSnapshot>& positions) {
+        SpriteSet sprites(config.assets);
+        (void)sprites.scaled(config.options.tileSize); // scale outside the timed part
+        SoftwareRenderer renderer(sprites);
+        ThreadPool pool(config.threads);
+        auto [width, height] = SoftwareRenderer::frameSize(config.options);
+        for (bool encode : {false, true}) {
+            std::atomic<uint64_t> bytes{0};
+            auto start = std::chrono::steady_clock::now();
+            for (int round{0}; round < config.bench; ++round) {
+                renderAll(pool, renderer, config.options, positions, [&bytes, encode](size_t, const Image& frame) {
+                    if (encode) {
+                        bytes.fetch_add(encodePng(frame).size(), std::memory_order_relaxed);
+                    }
+                });
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double count = static_cast<double>(positions.size()) * config.bench;
+            std::printf("%s %dx%d: %.0f thumbnails/s on %zu threads", encode ? "render+png" : "render    ",
+                        width, height, count / seconds, pool.size());
+            if (encode) {
+                std::printf(", %.0f bytes/thumbnail", static_cast<double>(bytes.load()) / count);
+            }
+            std::printf("\n");
+        }
+        return 0;
+    }
+
+    int write(const Config& config, const vector<BoardSnapshot>& positions) {
+        SpriteSet sprites(config.assets);
+        SoftwareRenderer renderer(sprites);
+        ThreadPool pool(config.threads);
+        string prefix = config.out.back() == '/' ? config.out : config.out + "/";
+        std::atomic<size_t> failed{0};
+        auto start = std::chrono::steady_clock::now();
+        renderAll(pool, renderer, config.options, positions, [&prefix, &failed](size_t i, const Image& frame) {
+            try {
+                savePng(prefix + std::to_string(i) + ".png", frame);
+            } catch (const std::exception& e) {
+                if (failed.fetch_add(1) == 0) {
+                    std::cerr << e.what() << "\n";
+                }
+            }
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::printf("wrote %zu thumbnails to %s in %.2fs\n", positions.size() - failed.load(), config.out.c_str(), seconds);
+        return failed.load() == 0 ? 0 : 1;
+    }
+
+    int usage() {
+        std::cerr << "usage: thumbnails --in positions.fen --out dir [--assets dir] [--tile px] [--coordinates 0/1]\n"
+                     "                  [--flip 0/1] [--threads n]\n"
+                     "       thumbnails --in positions.fen --bench rounds [--assets dir] [--tile px] [--threads n]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    Config config;
+    try {
+        for (int i{1}; i < argc; ++i) {
+            string arg = argv[i];
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            string value = argv[++i];
+            if (arg == "--in") {
+                config.in = value;
+            } else if (arg == "--out") {
+                config.out = value;
+            } else if (arg == "--assets") {
+                config.assets = value;
+            } else if (arg == "--tile") {
+                config.options.tileSize = std::stoi(value);
+            } else if (arg == "--coordinates") {
+                config.options.coordinates = value != "0";
+            } else if (arg == "--flip") {
+                config.options.blackAtBottom = value != "0";
+            } else if (arg == "--threads") {
+                config.threads = std::max<size_t>(std::stoul(value), 1);
+            } else if (arg == "--bench") {
+                config.bench = std::stoi(value);
+            } else {
+                return usage();
+            }
+        }
+        if (config.in.empty() || (config.out.empty() && config.bench <= 0)) {
+            return usage();
+        }
+        vector<BoardSnapshot> positions = loadSnapshots(readPositions(config.in));
+        return config.bench > 0 ? bench(config, positions) : write(config, positions);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
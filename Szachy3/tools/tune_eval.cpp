@@ -0,0 +1,394 @@
+// Texel tuning of the evaluation parameters (EvalParams) on labelled positions.
+//
+//   g++ -std=c++20 -O3 -march=native -pthread -I.. -o tune_eval tune_eval.cpp ../board.cpp ../board_exceptions.cpp
+//       ../board_snapshot.cpp ../evaluation.cpp ../repetition_history.cpp ../attack_map.cpp ../text_renderer.cpp
+//       ../thread_pool.cpp ../training_data.cpp ../mapped_file.cpp
+//   ./tune_eval --data positions.txt [--data more.txt] [--epochs 200] [--lr 1.0] [--k 0]
+//               [--threads n] [--init params.txt] [--out params.txt]
+//
+// A data line is a FEN (placement and side to move at least) followed by the
+// game result: 1-0, 0-1, 1/2-1/2, [1.0], [0.5], [0.0] or 1, 0.5, 0.
+// Files ending in .bin are read as packed records written by datagen.
+//
+// The evaluation is linear in its parameters, so every position is reduced
+// once to its sparse feature vector and kept in flat arrays (results, feature
+// offsets, feature indices, coefficients). An epoch is then a pass over those
+// arrays: each worker accumulates the gradient of the mean squared error
+// between sigmoid(K * eval) and the result into its own buffer, the buffers
+// are summed and Adam updates the weights. K is fitted first unless given.
+#include "board.h"
+#include "evaluation.h"
+#include "thread_pool.h"
+#include "training_data.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct TrainingSet {
+        vector<float> results; // white's score: 1, 0.5 or 0
+        vector<uint32_t> offsets{0}; // features of position i are [offsets[i], offsets[i + 1])
+        vector<uint16_t> indices;
+        vector<int8_t> coefficients;
+
+        [[nodiscard]] size_t size() const {
+            return results.size();
+        }
+
+        void append(const TrainingSet& other) {
+            if (indices.size() + other.indices.size() > UINT32_MAX) {
+                throw std::length_error("Training set too large");
+            }
+            uint32_t base = offsets.back();
+            results.insert(results.end(), other.results.begin(), other.results.end());
+            for (size_t i{1}; i < other.offsets.size(); ++i) {
+                offsets.push_back(base + other.offsets[i]);
+            }
+            indices.insert(indices.end(), other.indices.begin(), other.indices.end());
+            coefficients.insert(coefficients.end(), other.coefficients.begin(), other.coefficients.end());
+        }
+    };
+
+    bool parseResult(string_view token, float& result) {
+        if (token.size() > 2 && token.front() == '[' && token.back() == ']') {
+            token = token.substr(1, token.size() - 2);
+        }
+        if (token == "1-0" || token == "1" || token == "1.0") {
+            result = 1.0f;
+        } else if (token == "0-1" || token == "0" || token == "0.0") {
+            result = 0.0f;
+        } else if (token == "1/2-1/2" || token == "0.5") {
+            result = 0.5f;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Converts lines to features; runs inside a pool task with its own Board.
+    void extractLines(const vector<string>& lines, size_t begin, size_t end, TrainingSet& out, size_t& rejected) {
+        auto board = std::make_shared<Board>();
+        vector<EvalFeature> features;
+        for (size_t i{begin}; i < end; ++i) {
+            string_view line = lines[i];
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+                line.remove_suffix(1);
+            }
+            auto split = line.find_last_of(' ');
+            float result;
+            if (split == string_view::npos || !parseResult(line.substr(split + 1), result)) {
+                ++rejected;
+                continue;
+            }
+            try {
+                board->initFromFen(line.substr(0, split));
+            } catch (const std::exception&) {
+                ++rejected;
+                continue;
+            }
+            features.clear();
+            extractEvalFeatures(*board, features);
+            out.results.push_back(result);
+            for (auto [index, coefficient] : features) {
+                out.indices.push_back(index);
+                out.coefficients.push_back(coefficient);
+            }
+            out.offsets.push_back(static_cast<uint32_t>(out.indices.size()));
+        }
+    }
+
+    // Same for packed records; a corrupt or foreign file's records are rejected.
+    void extractRecords(std::span<const PackedPosition> records, TrainingSet& out, size_t& rejected) {
+        auto board = std::make_shared<Board>();
+        vector<EvalFeature> features;
+        for (const auto& record : records) {
+            if (static_cast<int>(record.result) > static_cast<int>(GameResult::WHITE_WIN)) {
+                ++rejected;
+                continue;
+            }
+            try {
+                board->initFromCompact(record.board());
+            } catch (const std::exception&) {
+                ++rejected;
+                continue;
+            }
+            features.clear();
+            extractEvalFeatures(*board, features);
+            out.results.push_back(static_cast<float>(record.result) / 2.0f);
+            for (auto [index, coefficient] : features) {
+                out.indices.push_back(index);
+                out.coefficients.push_back(coefficient);
+            }
+            out.offsets.push_back(static_cast<uint32_t>(out.indices.size()));
+        }
+    }
+
+    void loadPackedFile(const string& path, ThreadPool& pool, TrainingSet& set, size_t& rejected) {
+        MappedTrainingData data(path);
+        constexpr size_t task_records{1 << 16};
+        size_t tasks = (data.size() + task_records - 1) / task_records;
+        vector<TrainingSet> parts(tasks);
+        vector<size_t> part_rejected(tasks);
+        FirstError error;
+        for (size_t t{0}; t < tasks; ++t) {
+            pool.submit([&, t] {
+                error.run([&] {
+                    size_t begin = t * task_records;
+                    extractRecords(data.records().subspan(begin, std::min(task_records, data.size() - begin)), parts[t],
+                                   part_rejected[t]);
+                });
+            });
+        }
+        pool.wait();
+        error.rethrow();
+        for (size_t t{0}; t < tasks; ++t) {
+            set.append(parts[t]);
+            rejected += part_rejected[t];
+        }
+    }
+
+    void loadFile(const string& path, ThreadPool& pool, TrainingSet& set, size_t& rejected) {
+        if (path.ends_with(".bin")) {
+            loadPackedFile(path, pool, set, rejected);
+            return;
+        }
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        constexpr size_t block_lines{1 << 18};
+        constexpr size_t task_lines{4096};
+        vector<string> lines;
+        lines.reserve(block_lines);
+        vector<TrainingSet> parts;
+        vector<size_t> part_rejected;
+        auto flush = [&] {
+            size_t tasks = (lines.size() + task_lines - 1) / task_lines;
+            parts.assign(tasks, TrainingSet{});
+            part_rejected.assign(tasks, 0);
+            FirstError error;
+            for (size_t t{0}; t < tasks; ++t) {
+                pool.submit([&, t] {
+                    error.run([&] {
+                        extractLines(lines, t * task_lines, std::min(lines.size(), (t + 1) * task_lines), parts[t],
+                                     part_rejected[t]);
+                    });
+                });
+            }
+            pool.wait();
+            error.rethrow();
+            for (size_t t{0}; t < tasks; ++t) {
+                set.append(parts[t]);
+                rejected += part_rejected[t];
+            }
+            lines.clear();
+        };
+        for (string line; std::getline(in, line);) {
+            if (!line.empty()) {
+                lines.push_back(std::move(line));
+            }
+            if (lines.size() == block_lines) {
+                flush();
+            }
+        }
+        flush();
+    }
+
+    // Mean squared error, and when gradient is non-empty its gradient, split
+    // over the pool. k is in natural-log units: sigmoid(s) = 1 / (1 + e^(-k s)).
+    class ErrorFunction {
+    private:
+        const TrainingSet& set;
+        ThreadPool& pool;
+        size_t chunkCount;
+        vector<vector<double>> partialGradients;
+        vector<double> partialErrors;
+        vector<float> weightsF;
+    public:
+        ErrorFunction(const TrainingSet& set, ThreadPool& pool)
+                : set(set), pool(pool), chunkCount(pool.size() * 4),
+                  partialGradients(chunkCount, vector<double>(eval_features::count)), partialErrors(chunkCount),
+                  weightsF(eval_features::count) {}
+
+        double operator()(const vector<double>& weights, double k, vector<double>* gradient) {
+            std::transform(weights.begin(), weights.end(), weightsF.begin(), [](double w) { return static_cast<float>(w); });
+            size_t n = set.size();
+            for (size_t c{0}; c < chunkCount; ++c) {
+                pool.submit([this, c, n, k, gradient] {
+                    size_t begin = n * c / chunkCount;
+                    size_t end = n * (c + 1) / chunkCount;
+                    const float* w = weightsF.data();
+                    const uint32_t* offsets = set.offsets.data();
+                    const uint16_t* indices = set.indices.data();
+                    const int8_t* coefficients = set.coefficients.data();
+                    double* g = partialGradients[c].data();
+                    if (gradient != nullptr) {
+                        std::fill(partialGradients[c].begin(), partialGradients[c].end(), 0.0);
+                    }
+                    double error{0.0};
+                    for (size_t i{begin}; i < end; ++i) {
+                        float score{0.0f};
+                        for (uint32_t j{offsets[i]}; j < offsets[i + 1]; ++j) {
+                            score += w[indices[j]] * static_cast<float>(coefficients[j]);
+                        }
+                        double sigmoid = 1.0 / (1.0 + std::exp(-k * score));
+                        double diff = sigmoid - set.results[i];
+                        error += diff * diff;
+                        if (gradient != nullptr) {
+                            double d = diff * sigmoid * (1.0 - sigmoid);
+                            for (uint32_t j{offsets[i]}; j < offsets[i + 1]; ++j) {
+                                g[indices[j]] += d * coefficients[j];
+                            }
+                        }
+                    }
+                    partialErrors[c] = error;
+                });
+            }
+            pool.wait();
+            double error{0.0};
+            for (double e : partialErrors) {
+                error += e;
+            }
+            if (gradient != nullptr) {
+                gradient->assign(eval_features::count, 0.0);
+                for (const auto& partial : partialGradients) {
+                    for (int i{0}; i < eval_features::count; ++i) {
+                        (*gradient)[i] += partial[i];
+                    }
+                }
+                for (double& g : *gradient) {
+                    g *= 2.0 * k / static_cast<double>(n);
+                }
+            }
+            return error / static_cast<double>(n);
+        }
+    };
+
+    // Golden section search for the k that fits the current weights best.
+    double fitK(ErrorFunction& error, const vector<double>& weights) {
+        double low{0.0001};
+        double high{0.05};
+        const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+        double a = high - ratio * (high - low);
+        double b = low + ratio * (high - low);
+        double fa = error(weights, a, nullptr);
+        double fb = error(weights, b, nullptr);
+        for (int i{0}; i < 40; ++i) {
+            if (fa < fb) {
+                high = b;
+                b = a;
+                fb = fa;
+                a = high - ratio * (high - low);
+                fa = error(weights, a, nullptr);
+            } else {
+                low = a;
+                a = b;
+                fa = fb;
+                b = low + ratio * (high - low);
+                fb = error(weights, b, nullptr);
+            }
+        }
+        return (low + high) / 2.0;
+    }
+
+    int usage() {
+        std::cerr << "usage: tune_eval --data file [--data file...] [--epochs n] [--lr x] [--k x] [--threads n]\n"
+                     "                 [--init params.txt] [--out params.txt]\n";
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    vector<string> data_files;
+    int epochs{200};
+    double learning_rate{1.0};
+    double k{0.0};
+    size_t threads = std::thread::hardware_concurrency();
+    string init_file;
+    string out_file{"params.txt"};
+    for (int i{1}; i < argc; ++i) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            return usage();
+        }
+        string value = argv[++i];
+        if (arg == "--data") {
+            data_files.push_back(value);
+        } else if (arg == "--epochs") {
+            epochs = std::stoi(value);
+        } else if (arg == "--lr") {
+            learning_rate = std::stod(value);
+        } else if (arg == "--k") {
+            k = std::stod(value);
+        } else if (arg == "--threads") {
+            threads = std::stoul(value);
+        } else if (arg == "--init") {
+            init_file = value;
+        } else if (arg == "--out") {
+            out_file = value;
+        } else {
+            return usage();
+        }
+    }
+    if (data_files.empty()) {
+        return usage();
+    }
+
+    ThreadPool pool(threads);
+    TrainingSet set;
+    size_t rejected{0};
+    auto start = std::chrono::steady_clock::now();
+    try {
+        for (const auto& file : data_files) {
+            loadFile(file, pool, set, rejected);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    double load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("positions=%zu rejected=%zu features=%zu load_seconds=%.2f\n", set.size(), rejected, set.indices.size(), load_seconds);
+    if (set.size() == 0) {
+        return 1;
+    }
+
+    vector<double> weights = evalParamsToVector(init_file.empty() ? EvalParams{} : loadEvalParams(init_file));
+    ErrorFunction error(set, pool);
+    if (k <= 0.0) {
+        k = fitK(error, weights);
+    }
+    std::printf("k=%.6f initial_error=%.6f\n", k, error(weights, k, nullptr));
+
+    // Adam
+    constexpr double beta1{0.9};
+    constexpr double beta2{0.999};
+    constexpr double epsilon{1e-8};
+    vector<double> m(weights.size());
+    vector<double> v(weights.size());
+    vector<double> gradient;
+    for (int epoch{1}; epoch <= epochs; ++epoch) {
+        auto epoch_start = std::chrono::steady_clock::now();
+        double e = error(weights, k, &gradient);
+        for (size_t i{0}; i < weights.size(); ++i) {
+            m[i] = beta1 * m[i] + (1.0 - beta1) * gradient[i];
+            v[i] = beta2 * v[i] + (1.0 - beta2) * gradient[i] * gradient[i];
+            double m_hat = m[i] / (1.0 - std::pow(beta1, epoch));
+            double v_hat = v[i] / (1.0 - std::pow(beta2, epoch));
+            weights[i] -= learning_rate * m_hat / (std::sqrt(v_hat) + epsilon);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_start).count();
+        if (epoch == 1 || epoch % 10 == 0 || epoch == epochs) {
+            std::printf("epoch %d error=%.6f seconds=%.3f\n", epoch, e, seconds);
+            std::fflush(stdout);
+        }
+    }
+    std::printf("final_error=%.6f\n", error(weights, k, nullptr));
+    saveEvalParams(evalParamsFromVector(weights), out_file);
+    std::printf("wrote %s\n", out_file.c_str());
+    return 0;
+}
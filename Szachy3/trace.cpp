@@ -0,0 +1,113 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+
+namespace trace {
+    namespace {
+        // Fields are relaxed atomics so the exporter may read a slot while
+        // its owner overwrites it; such slots are detected and skipped.
+        struct Event {
+            std::atomic<const char*> name{nullptr};
+            std::atomic<uint64_t> start{0};
+            std::atomic<uint64_t> end{0};
+        };
+
+        struct RingBuffer {
+            Event events[ring_capacity];
+            std::atomic<uint64_t> head{0}; // number of spans ever written
+            std::atomic<uint64_t> tail{0}; // spans before tail were cleared
+            int threadId{0};
+        };
+
+        // Buffers are never freed, so spans of finished threads can still be exported.
+        std::atomic<RingBuffer*> buffers[max_threads];
+        std::atomic<int> registered{0};
+        const auto process_start = std::chrono::steady_clock::now();
+
+        RingBuffer* localBuffer() {
+            thread_local RingBuffer* buffer = [] () -> RingBuffer* {
+                int id = registered.fetch_add(1, std::memory_order_relaxed);
+                if (id >= max_threads) {
+                    return nullptr;
+                }
+                auto* b = new RingBuffer;
+                b->threadId = id + 1;
+                buffers[id].store(b, std::memory_order_release);
+                return b;
+            }();
+            return buffer;
+        }
+    }
+
+    void setEnabled(bool enabled) {
+        tracing_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - process_start).count());
+    }
+
+    void record(const char* name, uint64_t start, uint64_t end) {
+        RingBuffer* buffer = localBuffer();
+        if (buffer == nullptr) {
+            return;
+        }
+        uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        Event& e = buffer->events[head & (ring_capacity - 1)];
+        e.name.store(name, std::memory_order_relaxed);
+        e.start.store(start, std::memory_order_relaxed);
+        e.end.store(end, std::memory_order_relaxed);
+        buffer->head.store(head + 1, std::memory_order_release);
+    }
+
+    void clear() {
+        for (auto& slot : buffers) {
+            RingBuffer* buffer = slot.load(std::memory_order_acquire);
+            if (buffer != nullptr) {
+                buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void writeChromeTrace(std::ostream& out) {
+        out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first{true};
+        for (auto& slot : buffers) {
+            RingBuffer* buffer = slot.load(std::memory_order_acquire);
+            if (buffer == nullptr) {
+                continue;
+            }
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t begin = std::max(buffer->tail.load(std::memory_order_relaxed), head > ring_capacity ? head - ring_capacity : 0);
+            for (uint64_t i{begin}; i < head; ++i) {
+                const Event& e = buffer->events[i & (ring_capacity - 1)];
+                const char* name = e.name.load(std::memory_order_relaxed);
+                uint64_t start = e.start.load(std::memory_order_relaxed);
+                uint64_t end = e.end.load(std::memory_order_relaxed);
+                // the owner may have lapped us while we were reading this slot
+                std::atomic_thread_fence(std::memory_order_acquire);
+                uint64_t written = buffer->head.load(std::memory_order_acquire);
+                if (written > i + ring_capacity - 1 || name == nullptr) {
+                    continue;
+                }
+                out << (first ? "" : ",") << "\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                    << ",\"ts\":" << static_cast<double>(start) / 1000.0 << ",\"dur\":" << static_cast<double>(end - start) / 1000.0 << "}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    bool writeChromeTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        writeChromeTrace(out);
+        return static_cast<bool>(out);
+    }
+}
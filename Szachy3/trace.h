@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Optional tracing of scoped spans (board operations, search iterations, GUI
+// frames) exported as Chrome trace_event JSON, viewable in chrome://tracing
+// or Perfetto.
+//
+// Every thread records into its own fixed-size ring buffer; the oldest spans
+// are overwritten when it is full. Recording takes no locks and writers never
+// wait for the exporter. Spans are compiled in only when SZACHY_TRACE is
+// defined, and even then are recorded only while tracing is enabled.
+namespace trace {
+    constexpr size_t ring_capacity{1 << 16}; // spans kept per thread, power of two
+    constexpr int max_threads{256};
+
+    inline std::atomic<bool> tracing_enabled{false};
+
+    void setEnabled(bool enabled);
+
+    [[nodiscard]] inline bool isEnabled() {
+        return tracing_enabled.load(std::memory_order_relaxed);
+    }
+
+    // nanoseconds since process start, from a monotonic clock
+    uint64_t now();
+
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    // Drops everything recorded so far.
+    void clear();
+
+    // Writes all buffered spans as a Chrome trace_event JSON document.
+    void writeChromeTrace(std::ostream& out);
+    bool writeChromeTrace(const std::string& path);
+
+    // name must be a string literal (or otherwise outlive the trace)
+    class Span {
+    private:
+        const char* name;
+        uint64_t start{0};
+    public:
+        explicit Span(const char* name) : name(isEnabled() ? name : nullptr) {
+            if (this->name != nullptr) {
+                start = now();
+            }
+        }
+        ~Span() {
+            if (name != nullptr) {
+                record(name, start, now());
+            }
+        }
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+    };
+}
+
+#ifdef SZACHY_TRACE
+#define TRACE_SCOPE(name) ::trace::Span trace_span(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,130 @@
+#include "training_data.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+PackedPosition PackedPosition::pack(const CompactBoard& board, int score, int ply, GameResult result) {
+    PackedPosition record;
+    record.occupancy = board.occupancy;
+    record.pieces = board.pieces;
+    record.flags = board.flags;
+    record.score = static_cast<int16_t>(std::clamp(score, -32767, 32767));
+    record.ply = static_cast<uint16_t>(std::clamp(ply, 0, 65535));
+    record.result = result;
+    return record;
+}
+
+CompactBoard PackedPosition::board() const {
+    CompactBoard compact;
+    compact.occupancy = occupancy;
+    compact.pieces = pieces;
+    compact.flags = flags;
+    return compact;
+}
+
+TrainingDataWriter::TrainingDataWriter(const string& path) {
+    file = std::fopen(path.c_str(), "ab");
+    if (file == nullptr) {
+        throw std::runtime_error("Cannot open " + path + " for appending");
+    }
+}
+
+TrainingDataWriter::~TrainingDataWriter() {
+    std::fclose(file);
+}
+
+void TrainingDataWriter::append(std::span<const PackedPosition> records) {
+    std::lock_guard lock(mutex);
+    if (std::fwrite(records.data(), sizeof(PackedPosition), records.size(), file) != records.size() || std::fflush(file) != 0) {
+        throw std::runtime_error("Cannot write training data");
+    }
+    written += records.size();
+}
+
+uint64_t TrainingDataWriter::recordsWritten() {
+    std::lock_guard lock(mutex);
+    return written;
+}
+
+TrainingDataWriter::Buffer::Buffer(TrainingDataWriter& writer, size_t capacity) : writer(writer) {
+    records.reserve(capacity);
+}
+
+TrainingDataWriter::Buffer::~Buffer() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // nothing sensible to do in a destructor, the records are lost
+    }
+}
+
+void TrainingDataWriter::Buffer::add(const PackedPosition& record) {
+    records.push_back(record);
+    if (records.size() == records.capacity()) {
+        flush();
+    }
+}
+
+void TrainingDataWriter::Buffer::flush() {
+    if (!records.empty()) {
+        writer.append(records);
+        records.clear();
+    }
+}
+
+MappedTrainingData::MappedTrainingData(const string& path)
+        : file(path), data(static_cast<const PackedPosition*>(file.data())), count(file.size() / sizeof(PackedPosition)) {}
+
+size_t MappedTrainingData::size() const {
+    return count;
+}
+
+const PackedPosition& MappedTrainingData::operator[](size_t i) const {
+    return data[i];
+}
+
+std::span<const PackedPosition> MappedTrainingData::records() const {
+    return {data, count};
+}
+
+void shuffleTrainingData(const string& in, const string& out, uint64_t seed) {
+    // renamed over out once complete and in is unmapped, as Windows cannot
+    // replace a mapped file
+    string temporary = out + ".tmp";
+    {
+        MappedTrainingData input(in);
+        if (input.size() > UINT32_MAX) {
+            throw std::length_error("Too many records to shuffle: " + in);
+        }
+        vector<uint32_t> order(input.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::shuffle(order.begin(), order.end(), std::mt19937_64(seed));
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (file == nullptr) {
+            throw std::runtime_error("Cannot open " + temporary);
+        }
+        vector<PackedPosition> block;
+        block.reserve(4096);
+        bool written{true};
+        for (size_t i{0}; written && i < order.size(); ++i) {
+            block.push_back(input[order[i]]);
+            if (block.size() == block.capacity() || i + 1 == order.size()) {
+                written = std::fwrite(block.data(), sizeof(PackedPosition), block.size(), file) == block.size();
+                block.clear();
+            }
+        }
+        if (std::fclose(file) != 0 || !written) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Cannot write " + temporary);
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, out, error);
+    if (error) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot replace " + out + ": " + error.message());
+    }
+}
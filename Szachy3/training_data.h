@@ -0,0 +1,93 @@
+#ifndef TRAINING_DATA_H
+#define TRAINING_DATA_H
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "mapped_file.h"
+
+static_assert(std::endian::native == std::endian::little, "training data files are little endian");
+
+enum class GameResult : uint8_t {
+    BLACK_WIN,
+    DRAW,
+    WHITE_WIN
+};
+
+// One training position in 32 bytes: a CompactBoard plus the search score
+// and the final result of its game. Files are plain arrays of these records,
+// so they can be mapped, indexed and shuffled without parsing.
+struct PackedPosition {
+    uint64_t occupancy{0};
+    std::array<uint8_t, 16> pieces{};
+    int16_t score{0}; // centipawns from white's point of view
+    uint16_t ply{0};
+    uint8_t flags{0}; // CompactBoard::flags
+    GameResult result{GameResult::DRAW};
+    std::array<uint8_t, 2> reserved{};
+
+    static PackedPosition pack(const CompactBoard& board, int score, int ply, GameResult result);
+    [[nodiscard]] CompactBoard board() const;
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition is a 32 byte on-disk record");
+
+// Appends records to a file. Any number of threads may share one writer;
+// each fills its own Buffer and whole buffers are appended under a lock,
+// so records from different threads never interleave mid-record.
+class TrainingDataWriter {
+private:
+    std::FILE* file{nullptr};
+    std::mutex mutex;
+    uint64_t written{0};
+public:
+    class Buffer {
+    private:
+        TrainingDataWriter& writer;
+        vector<PackedPosition> records;
+    public:
+        explicit Buffer(TrainingDataWriter& writer, size_t capacity = 2048);
+        ~Buffer();
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        void add(const PackedPosition& record);
+        void flush();
+    };
+
+    explicit TrainingDataWriter(const string& path);
+    ~TrainingDataWriter();
+    TrainingDataWriter(const TrainingDataWriter&) = delete;
+    TrainingDataWriter& operator=(const TrainingDataWriter&) = delete;
+
+    void append(std::span<const PackedPosition> records);
+    [[nodiscard]] uint64_t recordsWritten();
+};
+
+// Read-only memory mapping of a training data file. A trailing partial
+// record (from an interrupted writer) is ignored.
+class MappedTrainingData {
+private:
+    MappedFile file;
+    const PackedPosition* data{nullptr};
+    size_t count{0};
+public:
+    explicit MappedTrainingData(const string& path);
+    MappedTrainingData(const MappedTrainingData&) = delete;
+    MappedTrainingData& operator=(const MappedTrainingData&) = delete;
+
+    [[nodiscard]] size_t size() const;
+    const PackedPosition& operator[](size_t i) const;
+    [[nodiscard]] std::span<const PackedPosition> records() const;
+};
+
+// Writes the records of `in` to `out` in a random order, through `out`.tmp,
+// so `out` may be `in`.
+void shuffleTrainingData(const string& in, const string& out, uint64_t seed);
+
+#endif // TRAINING_DATA_H
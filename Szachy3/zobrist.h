@@ -0,0 +1,41 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <array>
+#include <cstdint>
+#include "board.h"
+
+// Random keys used to hash positions incrementally. They are generated at
+// compile time with splitmix64, so every build (and every process talking to
+// another one) agrees on the same keys.
+namespace zobrist {
+    constexpr int colors{2};
+    constexpr int piece_types{static_cast<int>(NO_PIECE)};
+    constexpr int squares{board_width * board_height};
+
+    constexpr uint64_t splitmix64(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    constexpr std::array<uint64_t, colors * piece_types * squares + 1> keys = [] {
+        std::array<uint64_t, colors * piece_types * squares + 1> k{};
+        uint64_t state{0x5A616368ULL};
+        for (auto& key : k) {
+            key = splitmix64(state);
+        }
+        return k;
+    }();
+
+    constexpr uint64_t pieceKey(Color color, PieceType type, int square) {
+        return keys[(static_cast<int>(color) * piece_types + static_cast<int>(type)) * squares + square];
+    }
+
+    constexpr uint64_t sideKey() {
+        return keys[colors * piece_types * squares];
+    }
+}
+
+#endif // ZOBRIST_H